@@ -63,11 +63,24 @@ public:
  */
 class epicsShareClass PVArrayFilter : public PVFilter
 {
+public:
+    /**
+     * A typed kernel that copies len elements between a contiguous
+     * and a strided array, i.e. element start + i*increment.
+     */
+    typedef void (*CopyFunc)(
+        epics::pvData::PVScalarArray & from,
+        epics::pvData::PVScalarArray & to,
+        std::size_t start,
+        std::size_t increment,
+        std::size_t len);
 private:
     long start;
     long increment;
     long end;
     epics::pvData::PVScalarArrayPtr masterArray;
+    CopyFunc gather;
+    CopyFunc scatter;
 
     PVArrayFilter(long start,long increment,long end,const epics::pvData::PVScalarArrayPtr & masterArray);
 public:
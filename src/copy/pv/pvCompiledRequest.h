@@ -0,0 +1,125 @@
+/* pvCompiledRequest.h */
+/*
+ * The License for this software can be found in the file LICENSE that is included with the distribution.
+ */
+
+#ifndef PVCOMPILEDREQUEST_H
+#define PVCOMPILEDREQUEST_H
+
+#if defined(_WIN32) && !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+
+#include <string>
+#include <vector>
+#include <map>
+#include <pv/pvData.h>
+#include <pv/pvPlugin.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace pvCopy{
+
+class CompiledRequest;
+typedef std::tr1::shared_ptr<CompiledRequest> CompiledRequestPtr;
+
+/**
+ * @brief A pvRequest that has been parsed.
+ *
+ * It holds the typed values of the record options, i.e. record._options,
+ * and for each field option structure the name,value pairs together with the plugin for each name.
+ * Instances are never modified after they are created.
+ * CompiledRequest::get keeps a cache, so that a pvRequest with the same content is only parsed once.
+ */
+class epicsShareClass CompiledRequest
+{
+public:
+    POINTER_DEFINITIONS(CompiledRequest);
+    /**
+     * A name=value request option of a field.
+     */
+    struct FieldOption {
+        std::string name;
+        std::string value;
+        /**
+         * The plugin registered for name or null if there is none.
+         */
+        PVPluginPtr pvPlugin;
+    };
+    typedef std::vector<FieldOption> FieldOptionArray;
+    /**
+     * Get the compiled request for a pvRequest.
+     * @param pvRequest The top-level pvRequest structure.
+     * @return The compiled request. It is shared by all pvRequests with the same content.
+     */
+    static CompiledRequestPtr get(epics::pvData::PVStructurePtr const & pvRequest);
+    virtual ~CompiledRequest() {}
+    /**
+     * Get the value of record._options.process.
+     * @param processDefault The value if the option is not present.
+     * @return The value.
+     */
+    bool getProcess(bool processDefault) const
+    {
+        return (process<0) ? processDefault : (process>0);
+    }
+    /**
+     * Get the value of record._options.nProcess.
+     * @return The value or 1 if the option is not present.
+     */
+    int getNProcess() const { return nProcess;}
+    /**
+     * Get the value of record._options.skipUnchanged.
+     * @param skipUnchangedDefault The value if the option is not present.
+     * @return The value.
+     */
+    bool getSkipUnchanged(bool skipUnchangedDefault) const
+    {
+        return (skipUnchanged<0) ? skipUnchangedDefault : (skipUnchanged>0);
+    }
+    /**
+     * Is record._options.queueSize present?
+     * @return (false,true) if it is (not,is) present.
+     */
+    bool hasQueueSize() const { return !queueSizeString.empty();}
+    /**
+     * Is the value of record._options.queueSize an integer?
+     * @return (false,true) if it is (not,is) an integer.
+     */
+    bool isQueueSizeValid() const { return queueSizeValid;}
+    /**
+     * Get the value of record._options.queueSize.
+     * @return The value.
+     */
+    epics::pvData::int32 getQueueSize() const { return queueSize;}
+    /**
+     * Get the value of record._options.queueSize as it appears in the pvRequest.
+     * @return The value.
+     */
+    std::string const & getQueueSizeString() const { return queueSizeString;}
+    /**
+     * Get the options of a field.
+     * @param pvOptions An _options structure of the pvRequest.
+     * @return The options or null if pvOptions is not part of the compiled pvRequest.
+     */
+    const FieldOptionArray * getFieldOptions(
+        epics::pvData::PVStructurePtr const & pvOptions) const;
+private:
+    CompiledRequest();
+    void compile(epics::pvData::PVStructurePtr const & pvStructure);
+    void compileRecordOptions(epics::pvData::PVStructurePtr const & pvOptions);
+
+    epics::pvData::StructureConstPtr requestStructure;
+    std::size_t generation;
+    int process;
+    int nProcess;
+    int skipUnchanged;
+    bool queueSizeValid;
+    epics::pvData::int32 queueSize;
+    std::string queueSizeString;
+    // key is the field offset of the _options structure
+    std::map<std::size_t,FieldOptionArray> fieldOptions;
+};
+
+}}
+#endif  /* PVCOMPILEDREQUEST_H */
@@ -0,0 +1,136 @@
+/* pvCompressPlugin.h */
+/*
+ * The License for this software can be found in the file LICENSE that is included with the distribution.
+ */
+
+#ifndef PVCOMPRESSPLUGIN_H
+#define PVCOMPRESSPLUGIN_H
+
+#if defined(_WIN32) && !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+
+#include <string>
+#include <map>
+#include <pv/lock.h>
+#include <pv/pvData.h>
+#include <pv/pvPlugin.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace pvCopy{
+
+class PVCompressPlugin;
+class PVCompressFilter;
+
+typedef std::tr1::shared_ptr<PVCompressPlugin> PVCompressPluginPtr;
+typedef std::tr1::shared_ptr<PVCompressFilter> PVCompressFilterPtr;
+
+
+/**
+ * @brief A plugin for a filter that compresses an integer PVScalarArray.
+ *
+ * The request is compress=delta.
+ * The copy is a ubyte array that holds the encoded array.
+ * The encoding is:
+ *   The number of elements as a 4 byte little endian unsigned integer.
+ *   Then for each block of up to 128 elements:
+ *   one byte with the number of bits per element followed by the packed elements.
+ * Each element is the difference to the previous element,
+ * zigzag encoded so that small negative differences also need few bits,
+ * and packed least significant bit first.
+ * Slowly varying arrays, like ADC traces, need few bits per element.
+ */
+class epicsShareClass PVCompressPlugin : public PVPlugin
+{
+private:
+    PVCompressPlugin();
+public:
+    POINTER_DEFINITIONS(PVCompressPlugin);
+    virtual ~PVCompressPlugin();
+    /**
+     * Factory
+     */
+    static void create();
+    /**
+     * Create a PVFilter.
+     * @param requestValue The value part of a name=value request option.
+     * @param pvCopy The PVCopy to which the PVFilter will be attached.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached
+     * @return The PVFilter.
+     * Null is returned if master or requestValue is not appropriate for the plugin.
+     */
+    virtual PVFilterPtr create(
+         const std::string & requestValue,
+         const PVCopyPtr & pvCopy,
+         const epics::pvData::PVFieldPtr & master);
+    /**
+     * Get the introspection interface for the copy.
+     * @param requestValue The value part of a name=value request option.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached
+     * @return A ubyte array or null if master or requestValue is not appropriate for the plugin.
+     */
+    virtual epics::pvData::FieldConstPtr getCopyField(
+         const std::string & requestValue,
+         const epics::pvData::PVFieldPtr & master);
+};
+
+/**
+ * @brief  A filter that compresses an integer PVScalarArray into a ubyte array.
+ *
+ * When the copy is written back to master it is decoded.
+ */
+class epicsShareClass PVCompressFilter : public PVFilter
+{
+public:
+    /**
+     * A typed kernel that encodes from into the ubyte array to.
+     */
+    typedef void (*EncodeFunc)(
+        epics::pvData::PVScalarArray & from,
+        epics::pvData::PVScalarArray & to);
+    /**
+     * A typed kernel that decodes the ubyte array from into to.
+     * If from is not a valid encoding to is not changed and std::runtime_error is thrown,
+     * so that a put of the copy gets an error.
+     */
+    typedef void (*DecodeFunc)(
+        epics::pvData::PVScalarArray & from,
+        epics::pvData::PVScalarArray & to);
+private:
+    epics::pvData::PVScalarArrayPtr masterArray;
+    EncodeFunc encode;
+    DecodeFunc decode;
+
+    PVCompressFilter(
+        const epics::pvData::PVScalarArrayPtr & masterArray,
+        EncodeFunc encode,
+        DecodeFunc decode);
+public:
+    POINTER_DEFINITIONS(PVCompressFilter);
+    virtual ~PVCompressFilter();
+    /**
+     * Create a PVCompressFilter.
+     * @param requestValue The value part of a name=value request option.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached.
+     * @return The PVFilter.
+     * A null is returned if master or requestValue is not appropriate for the plugin.
+     */
+    static PVCompressFilterPtr create(const std::string & requestValue,const epics::pvData::PVFieldPtr & master);
+    /**
+     * Perform a filter operation
+     * @param pvCopy The field in the copy PVStructure.
+     * @param bitSet A bitSet for copyPVStructure.
+     * @param toCopy (true,false) means copy (from master to copy,from copy to master)
+     * @return if filter (modified, did not modify) destination.
+     */
+    bool filter(const epics::pvData::PVFieldPtr & pvCopy,const epics::pvData::BitSetPtr & bitSet,bool toCopy);
+    /**
+     * Get the filter name.
+     * @return The name.
+     */
+    std::string getName();
+};
+
+}}
+#endif  /* PVCOMPRESSPLUGIN_H */
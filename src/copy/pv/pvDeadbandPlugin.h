@@ -22,14 +22,20 @@ namespace epics { namespace pvCopy{
 
 class PVDeadbandPlugin;
 class PVDeadbandFilter;
+class PVArrayDeadbandFilter;
+class ScalarDeadbandKernel;
+struct PVFieldKernel;
 
 typedef std::tr1::shared_ptr<PVDeadbandPlugin> PVDeadbandPluginPtr;
 typedef std::tr1::shared_ptr<PVDeadbandFilter> PVDeadbandFilterPtr;
+typedef std::tr1::shared_ptr<PVArrayDeadbandFilter> PVArrayDeadbandFilterPtr;
 
 
 /**
- * @brief  A plugin for a filter that gets a sub array from a PVScalarDeadband.
+ * @brief  A plugin for a deadband filter for a numeric PVScalar or PVScalarArray.
  *
+ * The request is deadband=abs:value or deadband=rel:value,
+ * where rel means value is a percentage of the last reported value.
  * @author mrk
  * @since date 2017.02.23
  */
@@ -59,19 +65,18 @@ public:
 };
 
 /**
- * @brief  A Plugin for a filter that gets a sub array from a PVScalarDeadband.
+ * @brief  A deadband filter for a numeric PVScalar.
+ *
+ * The comparison is done by a kernel for the ScalarType of master, that is selected when the filter is created.
+ * Integer types are compared in integer arithmetic.
  */
 class epicsShareClass PVDeadbandFilter : public PVFilter
 {
 private:
-    bool absolute;
-    double deadband;
-    epics::pvData::PVScalarPtr master;
+    std::tr1::shared_ptr<ScalarDeadbandKernel> deadbandKernel;
     bool firstTime;
-    double lastReportedValue;
-    
 
-    PVDeadbandFilter(bool absolute,double deadband,epics::pvData::PVScalarPtr const & master);
+    PVDeadbandFilter(std::tr1::shared_ptr<ScalarDeadbandKernel> const & deadbandKernel);
 public:
     POINTER_DEFINITIONS(PVDeadbandFilter);
     virtual ~PVDeadbandFilter();
@@ -101,6 +106,66 @@ public:
     std::string getName();
 };
 
+/**
+ * @brief  A deadband filter for a numeric PVScalarArray.
+ *
+ * Each element is compared with the same element of the last reported array.
+ * The update is reported if the length changed or any element moved by at least the deadband.
+ */
+class epicsShareClass PVArrayDeadbandFilter : public PVFilter
+{
+public:
+    /**
+     * A typed kernel that returns true if any element of master differs from the same element
+     * of lastReported by at least deadband (absolute) or deadband percent of lastReported (relative).
+     */
+    typedef bool (*ExceedsFunc)(
+        epics::pvData::PVScalarArray & master,
+        epics::pvData::PVScalarArray & lastReported,
+        double deadband,
+        bool absolute);
+private:
+    bool absolute;
+    double deadband;
+    epics::pvData::PVScalarArrayPtr master;
+    epics::pvData::PVScalarArrayPtr lastReported;
+    const PVFieldKernel * kernel;
+    ExceedsFunc exceeds;
+    bool firstTime;
+
+    PVArrayDeadbandFilter(
+        bool absolute,double deadband,
+        epics::pvData::PVScalarArrayPtr const & master,
+        const PVFieldKernel * kernel,
+        ExceedsFunc exceeds);
+public:
+    POINTER_DEFINITIONS(PVArrayDeadbandFilter);
+    virtual ~PVArrayDeadbandFilter();
+    /**
+     * Create a PVArrayDeadbandFilter.
+     * @param requestValue The value part of a name=value request option.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached.
+     * @return The PVFilter.
+     * A null is returned if master or requestValue is not appropriate for the plugin.
+     */
+    static PVArrayDeadbandFilterPtr create(
+        const std::string & requestValue,
+        const epics::pvData::PVFieldPtr & master);
+    /**
+     * Perform a filter operation
+     * @param pvCopy The field in the copy PVStructure.
+     * @param bitSet A bitSet for copyPVStructure.
+     * @param toCopy (true,false) means copy (from master to copy,from copy to master)
+     * @return if filter (modified, did not modify) destination.
+     */
+    bool filter(const epics::pvData::PVFieldPtr & pvCopy,const epics::pvData::BitSetPtr & bitSet,bool toCopy);
+    /**
+     * Get the filter name.
+     * @return The name.
+     */
+    std::string getName();
+};
+
 }}
 #endif  /* PVDEADBANDPLUGIN_H */
 
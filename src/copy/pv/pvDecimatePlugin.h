@@ -0,0 +1,161 @@
+/* pvDecimatePlugin.h */
+/*
+ * The License for this software can be found in the file LICENSE that is included with the distribution.
+ */
+
+#ifndef PVDECIMATEPLUGIN_H
+#define PVDECIMATEPLUGIN_H
+
+#if defined(_WIN32) && !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+
+#include <string>
+#include <map>
+#include <pv/lock.h>
+#include <pv/pvData.h>
+#include <pv/pvPlugin.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace pvCopy{
+
+class PVDecimatePlugin;
+class PVDecimateFilter;
+class PVSampleFilter;
+
+typedef std::tr1::shared_ptr<PVDecimatePlugin> PVDecimatePluginPtr;
+typedef std::tr1::shared_ptr<PVDecimateFilter> PVDecimateFilterPtr;
+typedef std::tr1::shared_ptr<PVSampleFilter> PVSampleFilterPtr;
+
+
+/**
+ * @brief A plugin for filters that decimate a field.
+ *
+ * The request decimate=minmax:N reduces a numeric PVScalarArray to min, max and mean of bins.
+ * The array is divided into N bins of (almost) equal size.
+ * The copy has the same type as master and has 3 elements for each bin: min, max and mean.
+ * If master has fewer than N elements each element is a bin.
+ *
+ * The request decimate=N delivers the first and then every Nth update of a field that is not a structure.
+ */
+class epicsShareClass PVDecimatePlugin : public PVPlugin
+{
+private:
+    PVDecimatePlugin();
+public:
+    POINTER_DEFINITIONS(PVDecimatePlugin);
+    virtual ~PVDecimatePlugin();
+    /**
+     * Factory
+     */
+    static void create();
+    /**
+     * Create a PVFilter.
+     * @param requestValue The value part of a name=value request option.
+     * @param pvCopy The PVCopy to which the PVFilter will be attached.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached
+     * @return The PVFilter.
+     * Null is returned if master or requestValue is not appropriate for the plugin.
+     */
+    virtual PVFilterPtr create(
+         const std::string & requestValue,
+         const PVCopyPtr & pvCopy,
+         const epics::pvData::PVFieldPtr & master);
+};
+
+/**
+ * @brief  A filter that reduces a numeric PVScalarArray to min, max and mean of bins.
+ *
+ * All filters with the same request for the same master share the result by a PVSharedResult,
+ * so each value of master is only reduced once.
+ * The copy can not be written back to master.
+ */
+class epicsShareClass PVDecimateFilter : public PVFilter
+{
+public:
+    /**
+     * A typed kernel that computes min, max and mean for nbins bins of from.
+     */
+    typedef void (*DecimateFunc)(
+        epics::pvData::PVScalarArray & from,
+        epics::pvData::PVScalarArray & to,
+        std::size_t nbins);
+private:
+    std::size_t nbins;
+    epics::pvData::PVScalarArrayPtr masterArray;
+    DecimateFunc decimate;
+    PVSharedResultPtr sharedResult;
+
+    PVDecimateFilter(
+        std::size_t nbins,
+        const epics::pvData::PVScalarArrayPtr & masterArray,
+        DecimateFunc decimate,
+        const PVSharedResultPtr & sharedResult);
+public:
+    POINTER_DEFINITIONS(PVDecimateFilter);
+    virtual ~PVDecimateFilter();
+    /**
+     * Create a PVDecimateFilter.
+     * @param requestValue The value part of a name=value request option.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached.
+     * @return The PVFilter.
+     * A null is returned if master or requestValue is not appropriate for the plugin.
+     */
+    static PVDecimateFilterPtr create(const std::string & requestValue,const epics::pvData::PVFieldPtr & master);
+    /**
+     * Perform a filter operation
+     * @param pvCopy The field in the copy PVStructure.
+     * @param bitSet A bitSet for copyPVStructure.
+     * @param toCopy (true,false) means copy (from master to copy,from copy to master)
+     * @return if filter (modified, did not modify) destination.
+     */
+    bool filter(const epics::pvData::PVFieldPtr & pvCopy,const epics::pvData::BitSetPtr & bitSet,bool toCopy);
+    /**
+     * Get the filter name.
+     * @return The name.
+     */
+    std::string getName();
+};
+
+/**
+ * @brief  A filter that delivers only every Nth update of a field.
+ *
+ * For the other updates the bit of the field is cleared and the copy is not changed,
+ * so a monitor element with no other changes is not delivered.
+ */
+class epicsShareClass PVSampleFilter : public PVFilter
+{
+private:
+    std::size_t n;
+    std::size_t count;
+
+    PVSampleFilter(std::size_t n);
+public:
+    POINTER_DEFINITIONS(PVSampleFilter);
+    virtual ~PVSampleFilter();
+    /**
+     * Create a PVSampleFilter.
+     * @param requestValue The value part of a name=value request option.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached.
+     * @return The PVFilter.
+     * A null is returned if master or requestValue is not appropriate for the plugin.
+     */
+    static PVSampleFilterPtr create(const std::string & requestValue,const epics::pvData::PVFieldPtr & master);
+    /**
+     * Perform a filter operation
+     * @param pvCopy The field in the copy PVStructure.
+     * @param bitSet A bitSet for copyPVStructure.
+     * @param toCopy (true,false) means copy (from master to copy,from copy to master)
+     * @return if filter (modified, did not modify) destination.
+     */
+    bool filter(const epics::pvData::PVFieldPtr & pvCopy,const epics::pvData::BitSetPtr & bitSet,bool toCopy);
+    /**
+     * Get the filter name.
+     * @return The name.
+     */
+    std::string getName();
+};
+
+}}
+#endif  /* PVDECIMATEPLUGIN_H */
@@ -0,0 +1,79 @@
+/* pvFieldKernel.h */
+/*
+ * The License for this software can be found in the file LICENSE that is included with the distribution.
+ */
+
+#ifndef PVFIELDKERNEL_H
+#define PVFIELDKERNEL_H
+
+#if defined(_WIN32) && !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+
+#include <pv/pvData.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace pvCopy{
+
+/**
+ * @brief Typed operations for a scalar or scalarArray field.
+ *
+ * There is one kernel for each ScalarType of scalar and of scalarArray.
+ * PVCopy looks up the kernel of each field when the PVCopy is created,
+ * so that updating a copy requires no virtual PVField methods and no type switches.
+ * All PVFields passed to the functions must have the type for which the kernel was found.
+ */
+struct epicsShareClass PVFieldKernel
+{
+    /**
+     * Compare two fields.
+     * @param a The first field.
+     * @param b The second field.
+     * @return (false,true) if the fields (differ,are equal).
+     */
+    bool (*equals)(
+        const epics::pvData::PVField & a,
+        const epics::pvData::PVField & b);
+    /**
+     * Copy a field. An array is shared, not copied, just like PVField::copy.
+     * @param to The destination. postPut is called.
+     * @param from The source.
+     */
+    void (*copy)(
+        epics::pvData::PVField & to,
+        const epics::pvData::PVField & from);
+    /**
+     * Get the value of a numeric scalar as a double.
+     * This is null for non numeric scalars and for arrays.
+     */
+    double (*toDouble)(const epics::pvData::PVField & pvField);
+    /**
+     * Put a double into a numeric scalar. postPut is called.
+     * This is null for non numeric scalars and for arrays.
+     */
+    void (*fromDouble)(epics::pvData::PVField & pvField,double value);
+    /**
+     * Copy a range of elements between two arrays of the same length.
+     * The destination is made unique, i.e. no longer shared, before it is modified.
+     * This is null for scalars.
+     * @param to The destination. postPut is called.
+     * @param from The source.
+     * @param first The index of the first element to copy.
+     * @param count The number of elements to copy.
+     */
+    void (*copyRange)(
+        epics::pvData::PVField & to,
+        const epics::pvData::PVField & from,
+        std::size_t first,
+        std::size_t count);
+    /**
+     * Find the kernel for a field.
+     * @param field The introspection interface.
+     * @return The kernel or null if field is not a scalar or scalarArray.
+     */
+    static const PVFieldKernel * find(const epics::pvData::FieldConstPtr & field);
+};
+
+}}
+#endif  /* PVFIELDKERNEL_H */
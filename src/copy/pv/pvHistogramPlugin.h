@@ -0,0 +1,138 @@
+/* pvHistogramPlugin.h */
+/*
+ * The License for this software can be found in the file LICENSE that is included with the distribution.
+ */
+
+#ifndef PVHISTOGRAMPLUGIN_H
+#define PVHISTOGRAMPLUGIN_H
+
+#if defined(_WIN32) && !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+
+#include <string>
+#include <map>
+#include <vector>
+#include <pv/lock.h>
+#include <pv/pvData.h>
+#include <pv/pvPlugin.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace pvCopy{
+
+class PVHistogramPlugin;
+class PVHistogramFilter;
+
+typedef std::tr1::shared_ptr<PVHistogramPlugin> PVHistogramPluginPtr;
+typedef std::tr1::shared_ptr<PVHistogramFilter> PVHistogramFilterPtr;
+
+
+/**
+ * @brief A plugin for a filter that makes a histogram of a numeric PVScalar or PVScalarArray.
+ *
+ * The request is histogram=lo:hi:nbins.
+ * The range [lo,hi) is divided into nbins bins of equal width.
+ * Values outside the range are not counted.
+ * The copy is an int array with the count of each bin.
+ * For an array the histogram is of the elements of the current array.
+ * For a scalar each update adds the value to a histogram that is kept by the filter.
+ */
+class epicsShareClass PVHistogramPlugin : public PVPlugin
+{
+private:
+    PVHistogramPlugin();
+public:
+    POINTER_DEFINITIONS(PVHistogramPlugin);
+    virtual ~PVHistogramPlugin();
+    /**
+     * Factory
+     */
+    static void create();
+    /**
+     * Create a PVFilter.
+     * @param requestValue The value part of a name=value request option.
+     * @param pvCopy The PVCopy to which the PVFilter will be attached.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached
+     * @return The PVFilter.
+     * Null is returned if master or requestValue is not appropriate for the plugin.
+     */
+    virtual PVFilterPtr create(
+         const std::string & requestValue,
+         const PVCopyPtr & pvCopy,
+         const epics::pvData::PVFieldPtr & master);
+    /**
+     * Get the introspection interface for the copy.
+     * @param requestValue The value part of a name=value request option.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached
+     * @return An int array or null if master or requestValue is not appropriate for the plugin.
+     */
+    virtual epics::pvData::FieldConstPtr getCopyField(
+         const std::string & requestValue,
+         const epics::pvData::PVFieldPtr & master);
+};
+
+/**
+ * @brief  A filter that makes a histogram of a numeric PVScalar or PVScalarArray.
+ *
+ * The copy can not be written back to master.
+ */
+class epicsShareClass PVHistogramFilter : public PVFilter
+{
+public:
+    /**
+     * The bins of a histogram.
+     */
+    struct Binning {
+        double lo;
+        double hi;
+        double scale;   // nbins/(hi-lo)
+        std::size_t nbins;
+    };
+    /**
+     * A typed kernel that adds the value or the elements of master to counts,
+     * which has binning.nbins elements.
+     */
+    typedef void (*CountFunc)(
+        epics::pvData::PVField & master,
+        Binning const & binning,
+        epics::pvData::int32 * counts);
+private:
+    epics::pvData::PVFieldPtr master;
+    CountFunc count;
+    Binning binning;
+    bool accumulate;
+    std::vector<epics::pvData::int32> counts;
+
+    PVHistogramFilter(
+        const epics::pvData::PVFieldPtr & master,
+        CountFunc count,
+        Binning const & binning);
+public:
+    POINTER_DEFINITIONS(PVHistogramFilter);
+    virtual ~PVHistogramFilter();
+    /**
+     * Create a PVHistogramFilter.
+     * @param requestValue The value part of a name=value request option.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached.
+     * @return The PVFilter.
+     * A null is returned if master or requestValue is not appropriate for the plugin.
+     */
+    static PVHistogramFilterPtr create(const std::string & requestValue,const epics::pvData::PVFieldPtr & master);
+    /**
+     * Perform a filter operation
+     * @param pvCopy The field in the copy PVStructure.
+     * @param bitSet A bitSet for copyPVStructure.
+     * @param toCopy (true,false) means copy (from master to copy,from copy to master)
+     * @return if filter (modified, did not modify) destination.
+     */
+    bool filter(const epics::pvData::PVFieldPtr & pvCopy,const epics::pvData::BitSetPtr & bitSet,bool toCopy);
+    /**
+     * Get the filter name.
+     * @return The name.
+     */
+    std::string getName();
+};
+
+}}
+#endif  /* PVHISTOGRAMPLUGIN_H */
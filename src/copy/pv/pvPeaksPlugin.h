@@ -0,0 +1,144 @@
+/* pvPeaksPlugin.h */
+/*
+ * The License for this software can be found in the file LICENSE that is included with the distribution.
+ */
+
+#ifndef PVPEAKSPLUGIN_H
+#define PVPEAKSPLUGIN_H
+
+#if defined(_WIN32) && !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+
+#include <string>
+#include <map>
+#include <vector>
+#include <utility>
+#include <pv/lock.h>
+#include <pv/pvData.h>
+#include <pv/pvPlugin.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace pvCopy{
+
+class PVPeaksPlugin;
+class PVPeaksFilter;
+
+typedef std::tr1::shared_ptr<PVPeaksPlugin> PVPeaksPluginPtr;
+typedef std::tr1::shared_ptr<PVPeaksFilter> PVPeaksFilterPtr;
+
+
+/**
+ * @brief A plugin for a filter that finds the peaks of a numeric PVScalarArray.
+ *
+ * The request is peaks=threshold:K:minsep or peaks=threshold:K:minsep:centroid.
+ * A peak is an element that is greater than threshold, not less than the element before it
+ * and greater than the element after it.
+ * The K highest peaks that are at least minsep elements apart are delivered, highest first.
+ * The copy is a structure with fields index (int array), height and centroid (double arrays).
+ * centroid is only filled if requested. It is the centroid, above threshold,
+ * of the elements around the peak that are greater than threshold.
+ */
+class epicsShareClass PVPeaksPlugin : public PVPlugin
+{
+private:
+    PVPeaksPlugin();
+public:
+    POINTER_DEFINITIONS(PVPeaksPlugin);
+    virtual ~PVPeaksPlugin();
+    /**
+     * Factory
+     */
+    static void create();
+    /**
+     * Create a PVFilter.
+     * @param requestValue The value part of a name=value request option.
+     * @param pvCopy The PVCopy to which the PVFilter will be attached.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached
+     * @return The PVFilter.
+     * Null is returned if master or requestValue is not appropriate for the plugin.
+     */
+    virtual PVFilterPtr create(
+         const std::string & requestValue,
+         const PVCopyPtr & pvCopy,
+         const epics::pvData::PVFieldPtr & master);
+    /**
+     * Get the introspection interface for the copy.
+     * @param requestValue The value part of a name=value request option.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached
+     * @return A structure or null if master or requestValue is not appropriate for the plugin.
+     */
+    virtual epics::pvData::FieldConstPtr getCopyField(
+         const std::string & requestValue,
+         const epics::pvData::PVFieldPtr & master);
+};
+
+/**
+ * @brief  A filter that finds the peaks of a numeric PVScalarArray.
+ *
+ * The copy can not be written back to master.
+ */
+class epicsShareClass PVPeaksFilter : public PVFilter
+{
+public:
+    /**
+     * The options of the request.
+     */
+    struct Config {
+        double threshold;
+        std::size_t maxPeaks;
+        std::size_t minSeparation;
+        bool centroid;
+    };
+    /**
+     * The height and index of each peak.
+     */
+    typedef std::vector<std::pair<double,std::size_t> > CandidateArray;
+    /**
+     * A typed kernel that finds the peaks of master and puts them into the fields of copy.
+     * candidates is work space that is kept by the filter.
+     */
+    typedef void (*FindFunc)(
+        epics::pvData::PVScalarArray & master,
+        Config const & config,
+        CandidateArray & candidates,
+        epics::pvData::PVStructure & copy);
+private:
+    epics::pvData::PVScalarArrayPtr master;
+    FindFunc find;
+    Config config;
+    CandidateArray candidates;
+
+    PVPeaksFilter(
+        const epics::pvData::PVScalarArrayPtr & master,
+        FindFunc find,
+        Config const & config);
+public:
+    POINTER_DEFINITIONS(PVPeaksFilter);
+    virtual ~PVPeaksFilter();
+    /**
+     * Create a PVPeaksFilter.
+     * @param requestValue The value part of a name=value request option.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached.
+     * @return The PVFilter.
+     * A null is returned if master or requestValue is not appropriate for the plugin.
+     */
+    static PVPeaksFilterPtr create(const std::string & requestValue,const epics::pvData::PVFieldPtr & master);
+    /**
+     * Perform a filter operation
+     * @param pvCopy The field in the copy PVStructure.
+     * @param bitSet A bitSet for copyPVStructure.
+     * @param toCopy (true,false) means copy (from master to copy,from copy to master)
+     * @return if filter (modified, did not modify) destination.
+     */
+    bool filter(const epics::pvData::PVFieldPtr & pvCopy,const epics::pvData::BitSetPtr & bitSet,bool toCopy);
+    /**
+     * Get the filter name.
+     * @return The name.
+     */
+    std::string getName();
+};
+
+}}
+#endif  /* PVPEAKSPLUGIN_H */
@@ -16,6 +16,7 @@
 #include <string>
 #include <map>
 #include <pv/lock.h>
+#include <pv/timeStamp.h>
 #include <pv/pvStructureCopy.h>
 
 #include <shareLib.h>
@@ -24,10 +25,15 @@ namespace epics { namespace pvCopy{
 
 class PVPlugin;
 class PVFilter;
+class PVFilterV2;
+class PVFilterContext;
 class PVPluginRegistry;
+class PVSharedResult;
 
 typedef std::tr1::shared_ptr<PVPlugin> PVPluginPtr;
 typedef std::tr1::shared_ptr<PVFilter> PVFilterPtr;
+typedef std::tr1::shared_ptr<PVFilterV2> PVFilterV2Ptr;
+typedef std::tr1::shared_ptr<PVSharedResult> PVSharedResultPtr;
 typedef std::map<std::string,PVPluginPtr> PVPluginMap;
 
 
@@ -58,6 +64,21 @@ public:
          const std::string & requestValue,
          const PVCopyPtr & pvCopy,
          const epics::pvData::PVFieldPtr & master) = 0;
+    /**
+     * Get the introspection interface for the copy of a field.
+     * A plugin that gives the copy a type that differs from master overrides this.
+     * PVCopy then never copies the field itself, only the PVFilter updates it.
+     * The other plugin options of the field do not create filters.
+     * @param requestValue The value part of a name=value request option.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached.
+     * @return The introspection interface or null if the copy has the type of master.
+     */
+     virtual epics::pvData::FieldConstPtr getCopyField(
+         const std::string & requestValue,
+         const epics::pvData::PVFieldPtr & master)
+     {
+         return epics::pvData::FieldConstPtr();
+     }
 };
 
 /**
@@ -85,6 +106,133 @@ public:
      */
     virtual std::string getName() = 0;
 };
+/**
+ * @brief  The context of one update of a copy PVStructure.
+ *
+ * PVCopy makes one for each call of updateCopySetBitSet, updateCopyFromBitSet or updateMaster
+ * and passes it to each PVFilterV2.
+ */
+class epicsShareClass PVFilterContext {
+public:
+    /**
+     * Constructor.
+     * @param bitSet The BitSet for the copy PVStructure.
+     */
+    explicit PVFilterContext(epics::pvData::BitSet & bitSet);
+    /**
+     * Get the BitSet for the copy PVStructure.
+     * @return The BitSet.
+     */
+    epics::pvData::BitSet & getBitSet() { return bitSet;}
+    /**
+     * Get the time of the update.
+     * It is read from PVClock by the first call, so all filters of an update get the same time.
+     * @return The time.
+     */
+    const epics::pvData::TimeStamp & getTimeStamp();
+private:
+    epics::pvData::BitSet & bitSet;
+    bool haveTimeStamp;
+    epics::pvData::TimeStamp timeStamp;
+};
+
+/**
+ * @brief  A filter that is given resolved views of its fields.
+ *
+ * PVCopy calls filterView instead of filter.
+ * The views are raw pointers and references, so a call has no shared_ptr copies or casts.
+ * They are only valid during the call.
+ */
+class epicsShareClass PVFilterV2 : public PVFilter {
+public:
+    POINTER_DEFINITIONS(PVFilterV2);
+    /**
+     * A field of master or copy.
+     */
+    struct View {
+        epics::pvData::PVField * field;
+        epics::pvData::Type type;
+        epics::pvData::ScalarType scalarType;  // for a scalar or scalarArray
+        const void * data;                      // for a scalarArray, the elements
+        std::size_t length;                     // for a scalarArray, the number of elements
+        std::size_t offset;                     // the field offset
+        /**
+         * Get a scalar.
+         * @return The field, which must be a scalar with element type T.
+         */
+        template<typename T>
+        epics::pvData::PVScalarValue<T> & scalar() const
+        {
+            return static_cast<epics::pvData::PVScalarValue<T> &>(*field);
+        }
+        /**
+         * Get the elements of a scalarArray.
+         * @return The elements, of which there are length. T must be the element type.
+         */
+        template<typename T>
+        const T * elements() const
+        {
+            return static_cast<const T *>(data);
+        }
+        /**
+         * Get the field.
+         * @return The field, which must be a T.
+         */
+        template<typename T>
+        T & as() const
+        {
+            return static_cast<T &>(*field);
+        }
+    };
+    /**
+     * Constructor.
+     * @param master The field in the master PVStructure to which the PVFilter is attached.
+     */
+    explicit PVFilterV2(const epics::pvData::PVFieldPtr & master);
+    virtual ~PVFilterV2() {}
+    /**
+     * Update copy or master.
+     * @param master The field in master.
+     * @param copy The field in copy. Its offset is the bit in the BitSet of context.
+     * @param context The context of the update.
+     * @param toCopy (true,false) means copy (from master to copy,from copy to master)
+     * @return (true,false) if filter modified destination.
+     */
+    virtual bool filterView(
+        View const & master,
+        View const & copy,
+        PVFilterContext & context,
+        bool toCopy) = 0;
+    /**
+     * The PVFilter interface, for code that calls a filter directly.
+     * It makes the views and a context and calls filterView.
+     */
+    virtual bool filter(const epics::pvData::PVFieldPtr & copy,const epics::pvData::BitSetPtr & bitSet,bool toCopy);
+    /**
+     * Is this a post-copy filter?
+     * PVCopy can run a post-copy filter after the record is unlocked,
+     * with a view of a snapshot of master that was taken while the record was locked.
+     * Such a filter must read master only through the view given to filterView
+     * and must not depend on other fields of master.
+     * See PVCopy for the guarantees.
+     * @return (false,true) if the filter (is not,is) post-copy. The default is false.
+     */
+    virtual bool isPostCopy() { return false;}
+    /**
+     * Make the view of a field.
+     * @param field The field.
+     * @param view The view.
+     */
+    static void getView(epics::pvData::PVField & field,View & view);
+    /**
+     * Get the field in the master PVStructure.
+     * @return The field.
+     */
+    epics::pvData::PVField & getMaster() { return *master;}
+private:
+    epics::pvData::PVFieldPtr master;
+};
+
 /**
  * @brief  A registry for filter plugins for PVCopy.
  *
@@ -103,6 +251,67 @@ public:
      * @return The plugin implementation or null if no pluging by that name has been registered.
      */
     static PVPluginPtr find(const std::string & name);
+    /**
+     * Get the generation of the registry.
+     * It changes each time a plugin is registered,
+     * so that code that caches the result of find can tell when to find again.
+     * @return The generation.
+     */
+    static std::size_t getGeneration();
+};
+
+/**
+ * @brief The result of a filter, shared by all filters with the same options.
+ *
+ * Filters of different PVCopys that are attached to the same scalarArray field of master
+ * by the same plugin with the same request value compute the same copy
+ * from the same value of master.
+ * Each such filter gets the same PVSharedResult.
+ * The first filter that sees a new value of master computes the result and puts it.
+ * The others get it, which shares the arrays of the result and does not copy them.
+ *
+ * A value of master is identified by its array.
+ * The array is never modified while it is in master or in the shared result, it is replaced,
+ * so the same array means the same update.
+ *
+ * Only a filter whose copy depends on nothing but the current value of master can share its result.
+ */
+class epicsShareClass PVSharedResult {
+public:
+    POINTER_DEFINITIONS(PVSharedResult);
+    /**
+     * Find or create the shared result.
+     * @param master The field in the master PVStructure to which the filter is attached.
+     * @param name The name of the plugin.
+     * @param requestValue The value part of the name=value request option.
+     * @return The shared result or null if master is not a scalarArray.
+     */
+    static PVSharedResultPtr find(
+        const epics::pvData::PVFieldPtr & master,
+        const std::string & name,
+        const std::string & requestValue);
+    /**
+     * Get the result for a value of master.
+     * @param master The field in master, or a snapshot of it.
+     * @param copy The field in copy. It is given the result if there is one.
+     * @return (false,true) if copy (was not, was) given the result.
+     */
+    bool getResult(epics::pvData::PVField & master,epics::pvData::PVField & copy);
+    /**
+     * Put the result for a value of master.
+     * @param master The field in master, or a snapshot of it, from which the result was computed.
+     * @param copy The field in copy that has the result.
+     */
+    void putResult(epics::pvData::PVField & master,epics::pvData::PVField const & copy);
+    ~PVSharedResult() {}
+private:
+    PVSharedResult(const epics::pvData::PVFieldPtr & master);
+    epics::pvData::PVFieldPtr master;
+    epics::pvData::PVFieldPtr source;   // shares the array of master that result is for
+    epics::pvData::PVFieldPtr result;
+    const void * data;                  // the elements of source
+    std::size_t length;
+    epics::pvData::Mutex mutex;
 };
 
 }}
@@ -0,0 +1,159 @@
+/* pvQuantilePlugin.h */
+/*
+ * The License for this software can be found in the file LICENSE that is included with the distribution.
+ */
+
+#ifndef PVQUANTILEPLUGIN_H
+#define PVQUANTILEPLUGIN_H
+
+#if defined(_WIN32) && !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+
+#include <string>
+#include <map>
+#include <vector>
+#include <pv/lock.h>
+#include <pv/pvData.h>
+#include <pv/pvPlugin.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace pvCopy{
+
+class PVQuantilePlugin;
+class PVQuantileFilter;
+
+typedef std::tr1::shared_ptr<PVQuantilePlugin> PVQuantilePluginPtr;
+typedef std::tr1::shared_ptr<PVQuantileFilter> PVQuantileFilterPtr;
+
+
+/**
+ * @brief A plugin for a filter that estimates quantiles of a numeric PVScalar or PVScalarArray.
+ *
+ * The request is quantile=p1:p2:...,  for example quantile=0.5:0.99:0.999.
+ * Each p must be greater than 0 and less than 1.
+ * Every update of a scalar, or every element of an array, is a sample.
+ * The copy is a double array with the estimate of each quantile of all samples since the filter was created.
+ * Each quantile is estimated by the P-square algorithm of Jain and Chlamtac,
+ * which has a fixed size state, so the memory does not grow with the number of samples.
+ */
+class epicsShareClass PVQuantilePlugin : public PVPlugin
+{
+private:
+    PVQuantilePlugin();
+public:
+    POINTER_DEFINITIONS(PVQuantilePlugin);
+    virtual ~PVQuantilePlugin();
+    /**
+     * Factory
+     */
+    static void create();
+    /**
+     * Create a PVFilter.
+     * @param requestValue The value part of a name=value request option.
+     * @param pvCopy The PVCopy to which the PVFilter will be attached.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached
+     * @return The PVFilter.
+     * Null is returned if master or requestValue is not appropriate for the plugin.
+     */
+    virtual PVFilterPtr create(
+         const std::string & requestValue,
+         const PVCopyPtr & pvCopy,
+         const epics::pvData::PVFieldPtr & master);
+    /**
+     * Get the introspection interface for the copy.
+     * @param requestValue The value part of a name=value request option.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached
+     * @return A double array or null if master or requestValue is not appropriate for the plugin.
+     */
+    virtual epics::pvData::FieldConstPtr getCopyField(
+         const std::string & requestValue,
+         const epics::pvData::PVFieldPtr & master);
+};
+
+/**
+ * @brief  A filter that estimates quantiles of a numeric PVScalar or PVScalarArray.
+ *
+ * The filter is post-copy, so PVCopy can update the estimators after the record is unlocked.
+ * The copy can not be written back to master.
+ */
+class epicsShareClass PVQuantileFilter : public PVFilterV2
+{
+public:
+    /**
+     * A P-square estimator of one quantile.
+     */
+    struct Estimator {
+        /**
+         * Start estimating.
+         * @param p The quantile.
+         */
+        void init(double p);
+        /**
+         * Add a sample.
+         * @param value The sample.
+         */
+        void add(double value);
+        /**
+         * Get the estimate.
+         * @return The estimate or 0 if there are no samples.
+         */
+        double get() const;
+        double p;
+        double count;
+        double heights[5];
+        double positions[5];
+        double desired[5];
+        double increments[5];
+    };
+    typedef std::vector<Estimator> EstimatorArray;
+    /**
+     * A typed kernel that adds the value or the elements of master to each estimator.
+     */
+    typedef void (*AddFunc)(
+        epics::pvData::PVField & master,
+        EstimatorArray & estimators);
+private:
+    AddFunc add;
+    EstimatorArray estimators;
+
+    PVQuantileFilter(
+        const epics::pvData::PVFieldPtr & master,
+        AddFunc add,
+        std::vector<double> const & quantiles);
+public:
+    POINTER_DEFINITIONS(PVQuantileFilter);
+    virtual ~PVQuantileFilter();
+    /**
+     * Create a PVQuantileFilter.
+     * @param requestValue The value part of a name=value request option.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached.
+     * @return The PVFilter.
+     * A null is returned if master or requestValue is not appropriate for the plugin.
+     */
+    static PVQuantileFilterPtr create(const std::string & requestValue,const epics::pvData::PVFieldPtr & master);
+    /**
+     * Perform a filter operation
+     * @param master The field in master.
+     * @param copy The field in copy.
+     * @param context The context of the update.
+     * @param toCopy (true,false) means copy (from master to copy,from copy to master)
+     * @return if filter (modified, did not modify) destination.
+     */
+    bool filterView(View const & master,View const & copy,PVFilterContext & context,bool toCopy);
+    /**
+     * The estimators must see every update,
+     * but a post-copy filter only sees the last snapshot, so the filter is not post-copy.
+     * @return false.
+     */
+    bool isPostCopy() { return false;}
+    /**
+     * Get the filter name.
+     * @return The name.
+     */
+    std::string getName();
+};
+
+}}
+#endif  /* PVQUANTILEPLUGIN_H */
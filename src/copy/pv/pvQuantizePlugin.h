@@ -0,0 +1,141 @@
+/* pvQuantizePlugin.h */
+/*
+ * The License for this software can be found in the file LICENSE that is included with the distribution.
+ */
+
+#ifndef PVQUANTIZEPLUGIN_H
+#define PVQUANTIZEPLUGIN_H
+
+#if defined(_WIN32) && !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+
+#include <string>
+#include <map>
+#include <pv/lock.h>
+#include <pv/pvData.h>
+#include <pv/pvPlugin.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace pvCopy{
+
+class PVQuantizePlugin;
+class PVQuantizeFilter;
+
+typedef std::tr1::shared_ptr<PVQuantizePlugin> PVQuantizePluginPtr;
+typedef std::tr1::shared_ptr<PVQuantizeFilter> PVQuantizeFilterPtr;
+
+
+/**
+ * @brief A plugin for a filter that converts a numeric PVScalar or PVScalarArray to a narrower type.
+ *
+ * The request is quantize=float, quantize=int16, quantize=int8,
+ * quantize=int16:lo:hi or quantize=int8:lo:hi.
+ * For float the copy is a float scalar or array.
+ * For int16 and int8 the copy is a structure with fields value, scale and offset.
+ * value is a short or byte scalar or array and master is approximately value*scale + offset.
+ * If lo:hi is given the range [lo,hi] is used and values outside of it are clipped,
+ * otherwise the range is the minimum and maximum of each update.
+ * For a scalar lo:hi is required.
+ */
+class epicsShareClass PVQuantizePlugin : public PVPlugin
+{
+private:
+    PVQuantizePlugin();
+public:
+    POINTER_DEFINITIONS(PVQuantizePlugin);
+    virtual ~PVQuantizePlugin();
+    /**
+     * Factory
+     */
+    static void create();
+    /**
+     * Create a PVFilter.
+     * @param requestValue The value part of a name=value request option.
+     * @param pvCopy The PVCopy to which the PVFilter will be attached.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached
+     * @return The PVFilter.
+     * Null is returned if master or requestValue is not appropriate for the plugin.
+     */
+    virtual PVFilterPtr create(
+         const std::string & requestValue,
+         const PVCopyPtr & pvCopy,
+         const epics::pvData::PVFieldPtr & master);
+    /**
+     * Get the introspection interface for the copy.
+     * @param requestValue The value part of a name=value request option.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached
+     * @return The introspection interface or null if master or requestValue is not appropriate for the plugin.
+     */
+    virtual epics::pvData::FieldConstPtr getCopyField(
+         const std::string & requestValue,
+         const epics::pvData::PVFieldPtr & master);
+};
+
+/**
+ * @brief  A filter that converts a numeric PVScalar or PVScalarArray to a narrower type.
+ *
+ * The copy can not be written back to master.
+ */
+class epicsShareClass PVQuantizeFilter : public PVFilter
+{
+public:
+    /**
+     * How values are mapped to the narrower type.
+     */
+    struct Quantization {
+        epics::pvData::ScalarType type;  // pvFloat, pvShort or pvByte
+        double maxCode;                  // 32767 or 127, 0 for pvFloat
+        bool fixedRange;
+        double lo;
+        double hi;
+        double scale;
+        double offset;
+    };
+    /**
+     * A typed kernel that converts master to value.
+     * For an integer type it first sets scale and offset of quantization
+     * unless the range is fixed.
+     */
+    typedef void (*QuantizeFunc)(
+        epics::pvData::PVField & master,
+        epics::pvData::PVField & value,
+        Quantization & quantization);
+private:
+    epics::pvData::PVFieldPtr master;
+    QuantizeFunc quantize;
+    Quantization quantization;
+
+    PVQuantizeFilter(
+        const epics::pvData::PVFieldPtr & master,
+        QuantizeFunc quantize,
+        Quantization const & quantization);
+public:
+    POINTER_DEFINITIONS(PVQuantizeFilter);
+    virtual ~PVQuantizeFilter();
+    /**
+     * Create a PVQuantizeFilter.
+     * @param requestValue The value part of a name=value request option.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached.
+     * @return The PVFilter.
+     * A null is returned if master or requestValue is not appropriate for the plugin.
+     */
+    static PVQuantizeFilterPtr create(const std::string & requestValue,const epics::pvData::PVFieldPtr & master);
+    /**
+     * Perform a filter operation
+     * @param pvCopy The field in the copy PVStructure.
+     * @param bitSet A bitSet for copyPVStructure.
+     * @param toCopy (true,false) means copy (from master to copy,from copy to master)
+     * @return if filter (modified, did not modify) destination.
+     */
+    bool filter(const epics::pvData::PVFieldPtr & pvCopy,const epics::pvData::BitSetPtr & bitSet,bool toCopy);
+    /**
+     * Get the filter name.
+     * @return The name.
+     */
+    std::string getName();
+};
+
+}}
+#endif  /* PVQUANTIZEPLUGIN_H */
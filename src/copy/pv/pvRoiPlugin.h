@@ -0,0 +1,139 @@
+/* pvRoiPlugin.h */
+/*
+ * The License for this software can be found in the file LICENSE that is included with the distribution.
+ */
+
+#ifndef PVROIPLUGIN_H
+#define PVROIPLUGIN_H
+
+#if defined(_WIN32) && !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+
+#include <string>
+#include <map>
+#include <vector>
+#include <pv/lock.h>
+#include <pv/pvData.h>
+#include <pv/pvPlugin.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace pvCopy{
+
+class PVRoiPlugin;
+class PVRoiFilter;
+
+typedef std::tr1::shared_ptr<PVRoiPlugin> PVRoiPluginPtr;
+typedef std::tr1::shared_ptr<PVRoiFilter> PVRoiFilterPtr;
+
+
+/**
+ * @brief A plugin for a filter that crops and bins an image that is stored as a numeric PVScalarArray.
+ *
+ * The request is roi=x:y:w:h or roi=x:y:w:h:bin.
+ * The array holds the image row by row.
+ * The width and height of the image are the numeric scalar fields width and height
+ * of the structure that holds the array.
+ * The region is clipped to the image.
+ * Each bin by bin block of the region is replaced by the mean of its pixels,
+ * and a partial block at the right or bottom edge is dropped.
+ * The copy has the same type as master.
+ * It holds w/bin pixels for each of the h/bin rows, fewer if the region was clipped.
+ */
+class epicsShareClass PVRoiPlugin : public PVPlugin
+{
+private:
+    PVRoiPlugin();
+public:
+    POINTER_DEFINITIONS(PVRoiPlugin);
+    virtual ~PVRoiPlugin();
+    /**
+     * Factory
+     */
+    static void create();
+    /**
+     * Create a PVFilter.
+     * @param requestValue The value part of a name=value request option.
+     * @param pvCopy The PVCopy to which the PVFilter will be attached.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached
+     * @return The PVFilter.
+     * Null is returned if master or requestValue is not appropriate for the plugin.
+     */
+    virtual PVFilterPtr create(
+         const std::string & requestValue,
+         const PVCopyPtr & pvCopy,
+         const epics::pvData::PVFieldPtr & master);
+};
+
+/**
+ * @brief  A filter that crops and bins an image that is stored as a numeric PVScalarArray.
+ *
+ * The copy can not be written back to master.
+ */
+class epicsShareClass PVRoiFilter : public PVFilter
+{
+public:
+    /**
+     * The region of interest and the shape of the image.
+     */
+    struct Region {
+        std::size_t x;
+        std::size_t y;
+        std::size_t w;
+        std::size_t h;
+        std::size_t bin;
+        std::size_t width;
+        std::size_t height;
+    };
+    /**
+     * A typed kernel that puts the binned region of master into copy.
+     * rowSums is work space that is kept by the filter.
+     */
+    typedef void (*RoiFunc)(
+        epics::pvData::PVScalarArray & master,
+        epics::pvData::PVScalarArray & copy,
+        Region const & region,
+        std::vector<double> & rowSums);
+private:
+    epics::pvData::PVScalarArrayPtr master;
+    epics::pvData::PVScalarPtr pvWidth;
+    epics::pvData::PVScalarPtr pvHeight;
+    RoiFunc roi;
+    Region region;
+    std::vector<double> rowSums;
+
+    PVRoiFilter(
+        const epics::pvData::PVScalarArrayPtr & master,
+        const epics::pvData::PVScalarPtr & pvWidth,
+        const epics::pvData::PVScalarPtr & pvHeight,
+        RoiFunc roi,
+        Region const & region);
+public:
+    POINTER_DEFINITIONS(PVRoiFilter);
+    virtual ~PVRoiFilter();
+    /**
+     * Create a PVRoiFilter.
+     * @param requestValue The value part of a name=value request option.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached.
+     * @return The PVFilter.
+     * A null is returned if master or requestValue is not appropriate for the plugin.
+     */
+    static PVRoiFilterPtr create(const std::string & requestValue,const epics::pvData::PVFieldPtr & master);
+    /**
+     * Perform a filter operation
+     * @param pvCopy The field in the copy PVStructure.
+     * @param bitSet A bitSet for copyPVStructure.
+     * @param toCopy (true,false) means copy (from master to copy,from copy to master)
+     * @return if filter (modified, did not modify) destination.
+     */
+    bool filter(const epics::pvData::PVFieldPtr & pvCopy,const epics::pvData::BitSetPtr & bitSet,bool toCopy);
+    /**
+     * Get the filter name.
+     * @return The name.
+     */
+    std::string getName();
+};
+
+}}
+#endif  /* PVROIPLUGIN_H */
@@ -0,0 +1,140 @@
+/* pvSparsePlugin.h */
+/*
+ * The License for this software can be found in the file LICENSE that is included with the distribution.
+ */
+
+#ifndef PVSPARSEPLUGIN_H
+#define PVSPARSEPLUGIN_H
+
+#if defined(_WIN32) && !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+
+#include <string>
+#include <map>
+#include <pv/lock.h>
+#include <pv/pvData.h>
+#include <pv/pvPlugin.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace pvCopy{
+
+class PVSparsePlugin;
+class PVSparseFilter;
+
+typedef std::tr1::shared_ptr<PVSparsePlugin> PVSparsePluginPtr;
+typedef std::tr1::shared_ptr<PVSparseFilter> PVSparseFilterPtr;
+
+
+/**
+ * @brief A plugin for a filter that delivers only the changed elements of a numeric PVScalarArray.
+ *
+ * The request is sparse=density, for example sparse=0.01.
+ * The copy is a structure with fields full, index and value.
+ * full and value are arrays with the type of master and index is an int array.
+ * If the array has the same length as the last delivered array and at most
+ * density times the length of its elements changed, index and value are the positions and new values
+ * of the changed elements and full is empty.
+ * Otherwise full is the array and index and value are empty.
+ * An update that changes no element is not delivered.
+ * If a monitor updates an element again before it was released, the element keeps the
+ * positions of the change it already holds, so no change is lost when the queue is full.
+ */
+class epicsShareClass PVSparsePlugin : public PVPlugin
+{
+private:
+    PVSparsePlugin();
+public:
+    POINTER_DEFINITIONS(PVSparsePlugin);
+    virtual ~PVSparsePlugin();
+    /**
+     * Factory
+     */
+    static void create();
+    /**
+     * Create a PVFilter.
+     * @param requestValue The value part of a name=value request option.
+     * @param pvCopy The PVCopy to which the PVFilter will be attached.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached
+     * @return The PVFilter.
+     * Null is returned if master or requestValue is not appropriate for the plugin.
+     */
+    virtual PVFilterPtr create(
+         const std::string & requestValue,
+         const PVCopyPtr & pvCopy,
+         const epics::pvData::PVFieldPtr & master);
+    /**
+     * Get the introspection interface for the copy.
+     * @param requestValue The value part of a name=value request option.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached
+     * @return A structure or null if master or requestValue is not appropriate for the plugin.
+     */
+    virtual epics::pvData::FieldConstPtr getCopyField(
+         const std::string & requestValue,
+         const epics::pvData::PVFieldPtr & master);
+};
+
+/**
+ * @brief  A filter that delivers only the changed elements of a numeric PVScalarArray.
+ *
+ * The last delivered array shares its data with master, so keeping it does not copy the elements.
+ * The copy can not be written back to master.
+ */
+class epicsShareClass PVSparseFilter : public PVFilter
+{
+public:
+    /**
+     * A typed kernel that compares master with last and puts the changes into the fields of copy.
+     * If full is true, or more than maxChanged elements changed, copy gets the full array.
+     * If merge is true, the index of copy is an undelivered change and its positions are kept.
+     * last is set to master.
+     * @return false if full and merge are false and no element changed.
+     */
+    typedef bool (*DiffFunc)(
+        epics::pvData::PVScalarArray & master,
+        epics::pvData::PVScalarArray & last,
+        epics::pvData::PVStructure & copy,
+        double density,
+        bool full,
+        bool merge);
+private:
+    epics::pvData::PVScalarArrayPtr master;
+    epics::pvData::PVScalarArrayPtr last;
+    DiffFunc diff;
+    double density;
+    bool firstTime;
+    epics::pvData::PVField * lastCopy;
+
+    PVSparseFilter(
+        const epics::pvData::PVScalarArrayPtr & master,
+        DiffFunc diff,
+        double density);
+public:
+    POINTER_DEFINITIONS(PVSparseFilter);
+    virtual ~PVSparseFilter();
+    /**
+     * Create a PVSparseFilter.
+     * @param requestValue The value part of a name=value request option.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached.
+     * @return The PVFilter.
+     * A null is returned if master or requestValue is not appropriate for the plugin.
+     */
+    static PVSparseFilterPtr create(const std::string & requestValue,const epics::pvData::PVFieldPtr & master);
+    /**
+     * Perform a filter operation
+     * @param pvCopy The field in the copy PVStructure.
+     * @param bitSet A bitSet for copyPVStructure.
+     * @param toCopy (true,false) means copy (from master to copy,from copy to master)
+     * @return if filter (modified, did not modify) destination.
+     */
+    bool filter(const epics::pvData::PVFieldPtr & pvCopy,const epics::pvData::BitSetPtr & bitSet,bool toCopy);
+    /**
+     * Get the filter name.
+     * @return The name.
+     */
+    std::string getName();
+};
+
+}}
+#endif  /* PVSPARSEPLUGIN_H */
@@ -0,0 +1,169 @@
+/* pvSpectrumPlugin.h */
+/*
+ * The License for this software can be found in the file LICENSE that is included with the distribution.
+ */
+
+#ifndef PVSPECTRUMPLUGIN_H
+#define PVSPECTRUMPLUGIN_H
+
+#if defined(_WIN32) && !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+
+#include <string>
+#include <map>
+#include <vector>
+#include <complex>
+#include <pv/lock.h>
+#include <pv/pvData.h>
+#include <pv/pvPlugin.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace pvCopy{
+
+class PVSpectrumPlugin;
+class PVSpectrumFilter;
+
+typedef std::tr1::shared_ptr<PVSpectrumPlugin> PVSpectrumPluginPtr;
+typedef std::tr1::shared_ptr<PVSpectrumFilter> PVSpectrumFilterPtr;
+
+
+/**
+ * @brief A plugin for a filter that computes the spectrum of a numeric PVScalarArray.
+ *
+ * The request is spectrum=type or spectrum=type:window.
+ * type is magnitude or power and window is hann or hamming.
+ * The copy is a double array with n/2+1 elements for an array with n elements.
+ * Element k is the magnitude, or the square of the magnitude,
+ * of the discrete Fourier transform at frequency k/n.
+ * The transform is not normalized.
+ */
+class epicsShareClass PVSpectrumPlugin : public PVPlugin
+{
+private:
+    PVSpectrumPlugin();
+public:
+    POINTER_DEFINITIONS(PVSpectrumPlugin);
+    virtual ~PVSpectrumPlugin();
+    /**
+     * Factory
+     */
+    static void create();
+    /**
+     * Create a PVFilter.
+     * @param requestValue The value part of a name=value request option.
+     * @param pvCopy The PVCopy to which the PVFilter will be attached.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached
+     * @return The PVFilter.
+     * Null is returned if master or requestValue is not appropriate for the plugin.
+     */
+    virtual PVFilterPtr create(
+         const std::string & requestValue,
+         const PVCopyPtr & pvCopy,
+         const epics::pvData::PVFieldPtr & master);
+    /**
+     * Get the introspection interface for the copy.
+     * @param requestValue The value part of a name=value request option.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached
+     * @return A double array or null if master or requestValue is not appropriate for the plugin.
+     */
+    virtual epics::pvData::FieldConstPtr getCopyField(
+         const std::string & requestValue,
+         const epics::pvData::PVFieldPtr & master);
+};
+
+/**
+ * @brief  A filter that computes the spectrum of a numeric PVScalarArray.
+ *
+ * The FFT is mixed radix, with butterflies for radix 4, 2 and a generic one for other factors.
+ * If a factor is larger than 64 the generic butterfly would be too slow,
+ * so the transform is done by the chirp z-transform of Bluestein, with FFTs of a power of two length.
+ * An array with an even number of elements is transformed by a complex FFT of half the length.
+ * The plan, twiddle factors, window and work buffers are kept by the filter
+ * and are only computed again when the length of the array changes.
+ * The filter is post-copy, so PVCopy can compute the spectrum after the record is unlocked.
+ * All filters with the same request for the same master share the result by a PVSharedResult.
+ * The copy can not be written back to master.
+ */
+class epicsShareClass PVSpectrumFilter : public PVFilterV2
+{
+public:
+    typedef std::complex<double> Complex;
+    /**
+     * Everything that depends only on the length of the array.
+     */
+    struct Plan {
+        std::size_t length;                  // number of real samples
+        std::size_t nfft;                    // length of the complex FFT
+        std::vector<std::size_t> factors;    // pairs of radix and remaining length
+        std::vector<Complex> twiddles;       // exp(-2*pi*i*k/nfft)
+        std::vector<Complex> realTwiddles;   // exp(-2*pi*i*k/length), for an even length
+        std::vector<double> window;
+        std::vector<double> samples;
+        std::vector<Complex> input;
+        std::vector<Complex> output;
+        std::vector<Complex> scratch;        // for the generic butterfly
+        std::size_t nchirp;                  // length of the chirp z-transform FFTs, 0 if not used
+        std::vector<std::size_t> chirpFactors;
+        std::vector<Complex> chirpTwiddles;  // exp(-2*pi*i*k/nchirp)
+        std::vector<Complex> chirp;          // exp(-pi*i*k*k/nfft)
+        std::vector<Complex> chirpFilter;    // FFT of the conjugate chirp
+        std::vector<Complex> chirpInput;
+        std::vector<Complex> chirpOutput;
+    };
+    /**
+     * A typed kernel that converts the elements of master to double.
+     */
+    typedef void (*LoadFunc)(
+        epics::pvData::PVField & master,
+        std::vector<double> & samples);
+    enum Window {none,hann,hamming};
+private:
+    LoadFunc load;
+    bool power;
+    Window window;
+    Plan plan;
+    PVSharedResultPtr sharedResult;
+
+    PVSpectrumFilter(
+        const epics::pvData::PVFieldPtr & master,
+        LoadFunc load,
+        bool power,
+        Window window,
+        const PVSharedResultPtr & sharedResult);
+    void makePlan(std::size_t length);
+public:
+    POINTER_DEFINITIONS(PVSpectrumFilter);
+    virtual ~PVSpectrumFilter();
+    /**
+     * Create a PVSpectrumFilter.
+     * @param requestValue The value part of a name=value request option.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached.
+     * @return The PVFilter.
+     * A null is returned if master or requestValue is not appropriate for the plugin.
+     */
+    static PVSpectrumFilterPtr create(const std::string & requestValue,const epics::pvData::PVFieldPtr & master);
+    /**
+     * Perform a filter operation
+     * @param master The field in master.
+     * @param copy The field in copy.
+     * @param context The context of the update.
+     * @param toCopy (true,false) means copy (from master to copy,from copy to master)
+     * @return if filter (modified, did not modify) destination.
+     */
+    bool filterView(View const & master,View const & copy,PVFilterContext & context,bool toCopy);
+    /**
+     * The spectrum is computed by runPostCopyFilters.
+     * @return true.
+     */
+    bool isPostCopy() { return true;}
+    /**
+     * Get the filter name.
+     * @return The name.
+     */
+    std::string getName();
+};
+
+}}
+#endif  /* PVSPECTRUMPLUGIN_H */
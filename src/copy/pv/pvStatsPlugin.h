@@ -0,0 +1,148 @@
+/* pvStatsPlugin.h */
+/*
+ * The License for this software can be found in the file LICENSE that is included with the distribution.
+ */
+
+#ifndef PVSTATSPLUGIN_H
+#define PVSTATSPLUGIN_H
+
+#if defined(_WIN32) && !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+
+#include <string>
+#include <map>
+#include <pv/lock.h>
+#include <pv/pvData.h>
+#include <pv/pvPlugin.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace pvCopy{
+
+class PVStatsPlugin;
+class PVStatsFilter;
+
+typedef std::tr1::shared_ptr<PVStatsPlugin> PVStatsPluginPtr;
+typedef std::tr1::shared_ptr<PVStatsFilter> PVStatsFilterPtr;
+
+
+/**
+ * @brief A plugin for a filter that computes statistics of a numeric PVScalar or PVScalarArray.
+ *
+ * The request is stats=samples:N or stats=seconds:T.
+ * The statistics are accumulated over a window of N updates of master,
+ * or over the updates until T seconds have passed since the first update of the window.
+ * N must be at least 1 and T must be greater than 0 and at most 1e9,
+ * otherwise the request gives no filter.
+ * Each element of an array is a value.
+ * The copy is a structure with fields mean, rms, min, max and count,
+ * which is only reported when a window is complete.
+ */
+class epicsShareClass PVStatsPlugin : public PVPlugin
+{
+private:
+    PVStatsPlugin();
+public:
+    POINTER_DEFINITIONS(PVStatsPlugin);
+    virtual ~PVStatsPlugin();
+    /**
+     * Factory
+     */
+    static void create();
+    /**
+     * Create a PVFilter.
+     * @param requestValue The value part of a name=value request option.
+     * @param pvCopy The PVCopy to which the PVFilter will be attached.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached
+     * @return The PVFilter.
+     * Null is returned if master or requestValue is not appropriate for the plugin.
+     */
+    virtual PVFilterPtr create(
+         const std::string & requestValue,
+         const PVCopyPtr & pvCopy,
+         const epics::pvData::PVFieldPtr & master);
+    /**
+     * Get the introspection interface for the copy.
+     * @param requestValue The value part of a name=value request option.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached
+     * @return The statistics structure or null if master or requestValue is not appropriate for the plugin.
+     */
+    virtual epics::pvData::FieldConstPtr getCopyField(
+         const std::string & requestValue,
+         const epics::pvData::PVFieldPtr & master);
+};
+
+/**
+ * @brief  A filter that computes statistics of a numeric PVScalar or PVScalarArray.
+ *
+ * The copy can not be written back to master.
+ */
+class epicsShareClass PVStatsFilter : public PVFilter
+{
+public:
+    /**
+     * The running statistics of a window.
+     */
+    struct Accumulator {
+        Accumulator() { reset();}
+        void reset();
+        epics::pvData::int64 count;
+        double sum;
+        double sumSquares;
+        double min;
+        double max;
+    };
+    /**
+     * A typed kernel that adds the value or the elements of master to an accumulator.
+     */
+    typedef void (*AccumulateFunc)(
+        epics::pvData::PVField & master,
+        Accumulator & accumulator);
+private:
+    epics::pvData::PVFieldPtr master;
+    AccumulateFunc accumulate;
+    std::size_t windowUpdates;
+    epics::pvData::uint64 windowNanoseconds;
+    Accumulator accumulator;
+    std::size_t nupdates;
+    epics::pvData::uint64 windowStart;
+
+    PVStatsFilter(
+        const epics::pvData::PVFieldPtr & master,
+        AccumulateFunc accumulate,
+        std::size_t windowUpdates,
+        epics::pvData::uint64 windowNanoseconds);
+public:
+    POINTER_DEFINITIONS(PVStatsFilter);
+    virtual ~PVStatsFilter();
+    /**
+     * Create a PVStatsFilter.
+     * @param requestValue The value part of a name=value request option.
+     * @param master The field in the master PVStructure to which the PVFilter will be attached.
+     * @return The PVFilter.
+     * A null is returned if master or requestValue is not appropriate for the plugin.
+     */
+    static PVStatsFilterPtr create(const std::string & requestValue,const epics::pvData::PVFieldPtr & master);
+    /**
+     * Get the introspection interface of the copy.
+     * @return The structure with fields mean, rms, min, max and count.
+     */
+    static epics::pvData::StructureConstPtr getStatsStructure();
+    /**
+     * Perform a filter operation
+     * @param pvCopy The field in the copy PVStructure.
+     * @param bitSet A bitSet for copyPVStructure.
+     * @param toCopy (true,false) means copy (from master to copy,from copy to master)
+     * @return if filter (modified, did not modify) destination.
+     */
+    bool filter(const epics::pvData::PVFieldPtr & pvCopy,const epics::pvData::BitSetPtr & bitSet,bool toCopy);
+    /**
+     * Get the filter name.
+     * @return The name.
+     */
+    std::string getName();
+};
+
+}}
+#endif  /* PVSTATSPLUGIN_H */
@@ -17,8 +17,11 @@
 #include <string>
 #include <stdexcept>
 #include <memory>
+#include <map>
+#include <vector>
 #include <pv/pvData.h>
 #include <pv/bitSet.h>
+#include <pv/lock.h>
 
 #include <shareLib.h>
 
@@ -50,6 +53,70 @@ public:
 };
 
 
+class ChangedArrayRanges;
+typedef std::tr1::shared_ptr<ChangedArrayRanges> ChangedArrayRangesPtr;
+
+/**
+ * @brief The ranges of elements of array fields that changed in master.
+ *
+ * An instance is associated with one copy PVStructure.
+ * Each array field of the copy, identified by its offset in the copy, can be tracked.
+ * For a tracked field it holds the ranges of elements that were modified in master
+ * since the field in the copy was last updated.
+ * A field must be untracked when it is modified in master
+ * in a way that is not described by a range.
+ */
+class epicsShareClass ChangedArrayRanges
+{
+public:
+    POINTER_DEFINITIONS(ChangedArrayRanges);
+    /**
+     * A range of array elements.
+     */
+    struct Range {
+        std::size_t first;
+        std::size_t count;
+    };
+    typedef std::vector<Range> RangeArray;
+    /**
+     * The maximum number of ranges kept for a field.
+     * If more are added the ranges are merged into a single range.
+     */
+    static const std::size_t maxRanges = 64;
+    ChangedArrayRanges() {}
+    virtual ~ChangedArrayRanges() {}
+    /**
+     * Start tracking a field with no changed elements.
+     * @param fieldOffset The offset of the field in the copy.
+     */
+    void track(std::size_t fieldOffset);
+    /**
+     * Stop tracking a field.
+     * @param fieldOffset The offset of the field in the copy.
+     */
+    void untrack(std::size_t fieldOffset);
+    /**
+     * Stop tracking all fields.
+     */
+    void untrackAll();
+    /**
+     * Add a range of changed elements.
+     * Nothing is done if the field is not tracked.
+     * @param fieldOffset The offset of the field in the copy.
+     * @param first The index of the first changed element.
+     * @param count The number of changed elements.
+     */
+    void add(std::size_t fieldOffset,std::size_t first,std::size_t count);
+    /**
+     * Get the changed ranges of a field.
+     * @param fieldOffset The offset of the field in the copy.
+     * @return The ranges sorted by first or null if the field is not tracked.
+     */
+    const RangeArray * getRanges(std::size_t fieldOffset) const;
+private:
+    std::map<std::size_t,RangeArray> ranges;
+};
+
 class PVCopy;
 typedef std::tr1::shared_ptr<PVCopy> PVCopyPtr;
 
@@ -59,12 +126,42 @@ typedef std::tr1::shared_ptr<CopyNode> CopyNodePtr;
 struct CopyStructureNode;
 typedef std::tr1::shared_ptr<CopyStructureNode> CopyStructureNodePtr;
 
+class CompiledRequest;
+typedef std::tr1::shared_ptr<CompiledRequest> CompiledRequestPtr;
+
+class PVFilterContext;
+
+struct PostCopySnapshot;
+typedef std::tr1::shared_ptr<PostCopySnapshot> PostCopySnapshotPtr;
+
 
 /**
  * @brief Support for subset of fields in a pvStructure.
  *
  * Class that manages one or more PVStructures that holds an arbitrary subset of the fields
  * in another PVStructure called master.
+ *
+ * A field with a post-copy filter (see PVFilterV2::isPostCopy) can be updated in two steps.
+ * Code that passes a PostCopySnapshot to updateCopySetBitSet or updateCopyFromBitSet
+ * gets a snapshot of the master field taken while the record is locked,
+ * and the filters are not called.
+ * runPostCopyFilters then calls the filters, after the record is unlocked,
+ * with the snapshot in place of master.
+ * The guarantees are:
+ * - A post-copy filter sees the value master had when the snapshot was taken,
+ *   the same point in time as all other fields of the copy.
+ *   An array is shared with master, not copied, and is not changed because
+ *   array values of master are replaced, never modified in place.
+ * - Only the last snapshot is kept. If the copy is updated again before runPostCopyFilters
+ *   the filters never see the earlier value.
+ * - The bit of the field in the BitSet is left as master set it.
+ *   A filter that clears it in runPostCopyFilters does not withdraw an update already made;
+ *   so a filter that suppresses updates should not be post-copy.
+ * - The post-copy filters of a PVCopy are never run at the same time,
+ *   since they are called with a lock that belongs to the PVCopy.
+ * - The time from PVFilterContext is the time runPostCopyFilters is called.
+ * - updateMaster, initCopy and the methods without a PostCopySnapshot call post-copy filters
+ *   with the record locked, as for any other filter.
  */
 class epicsShareClass PVCopy : 
     public std::tr1::enable_shared_from_this<PVCopy>
@@ -154,6 +251,65 @@ public:
     bool updateCopyFromBitSet(
         epics::pvData::PVStructurePtr const  &copyPVStructure,
         epics::pvData::BitSetPtr const  &bitSet);
+    /**
+     * Just like updateCopyFromBitSet except for scalarArray fields without plugins.
+     * If such a field is tracked by arrayRanges and has the same length in copy and master
+     * only the changed ranges of elements are copied.
+     * Each such field that is updated becomes tracked with no changed ranges.
+     * @param copyPVStructure A copy top-level structure.
+     * @param bitSet A bitSet for copyPVStructure.
+     * @param arrayRanges The changed array ranges for copyPVStructure.
+     * @returns (false,true) if client (should not,should) receive changes.
+     */
+    bool updateCopyFromBitSet(
+        epics::pvData::PVStructurePtr const  &copyPVStructure,
+        epics::pvData::BitSetPtr const  &bitSet,
+        ChangedArrayRangesPtr const &arrayRanges);
+    /**
+     * Create a snapshot for the post-copy filters, for one copy PVStructure.
+     * @returns The snapshot or null if no field has a post-copy filter.
+     */
+    PostCopySnapshotPtr createPostCopySnapshot();
+    /**
+     * Like updateCopySetBitSet except that each field with post-copy filters is not updated.
+     * Instead a snapshot of the master field is taken.
+     * @param copyPVStructure A copy top-level structure.
+     * @param bitSet A bitSet for copyPVStructure.
+     * @param snapshot The snapshot for copyPVStructure. If null this is just updateCopySetBitSet.
+     * @returns (false,true) if client (should not,should) receive changes
+     * of the fields without post-copy filters.
+     */
+    bool updateCopySetBitSet(
+        epics::pvData::PVStructurePtr const  &copyPVStructure,
+        epics::pvData::BitSetPtr const  &bitSet,
+        PostCopySnapshotPtr const &snapshot);
+    /**
+     * Like updateCopyFromBitSet except that each field with post-copy filters
+     * that has its bit set is not updated.
+     * Instead a snapshot of the master field is taken.
+     * @param copyPVStructure A copy top-level structure.
+     * @param bitSet A bitSet for copyPVStructure.
+     * @param arrayRanges The changed array ranges for copyPVStructure or null.
+     * @param snapshot The snapshot for copyPVStructure. If null the filters are called now.
+     * @returns (false,true) if client (should not,should) receive changes.
+     */
+    bool updateCopyFromBitSet(
+        epics::pvData::PVStructurePtr const  &copyPVStructure,
+        epics::pvData::BitSetPtr const  &bitSet,
+        ChangedArrayRangesPtr const &arrayRanges,
+        PostCopySnapshotPtr const &snapshot);
+    /**
+     * Call the post-copy filters for each snapshot taken since the last call.
+     * This must be called without the record locked.
+     * @param copyPVStructure A copy top-level structure.
+     * @param bitSet A bitSet for copyPVStructure.
+     * @param snapshot The snapshot for copyPVStructure. Nothing is done if it is null.
+     * @returns (false,true) if a field of copyPVStructure was updated.
+     */
+    bool runPostCopyFilters(
+        epics::pvData::PVStructurePtr const  &copyPVStructure,
+        epics::pvData::BitSetPtr const  &bitSet,
+        PostCopySnapshotPtr const &snapshot);
     /**
      * For each set bit in bitSet
      * set the field in pvMaster to the value of the corresponding field in copyPVStructure
@@ -163,6 +319,20 @@ public:
     void updateMaster(
         epics::pvData::PVStructurePtr const  &copyPVStructure,
         epics::pvData::BitSetPtr const  &bitSet);
+    /**
+     * Just like updateMaster except that,
+     * if skipUnchanged is true, a field of pvMaster that has the value of the field in copyPVStructure
+     * is not written, so that there is no postPut for it.
+     * This is done for each scalar and scalarArray leaf field that is not updated by a filter.
+     * @param copyPVStructure A copy top-level structure.
+     * @param bitSet A bitSet for copyPVStructure.
+     * @param skipUnchanged (false,true) means (write,skip) fields that are unchanged.
+     * @return false if skipUnchanged is true and no field of pvMaster was written.
+     */
+    bool updateMaster(
+        epics::pvData::PVStructurePtr const  &copyPVStructure,
+        epics::pvData::BitSetPtr const  &bitSet,
+        bool skipUnchanged);
     /**
      * Get the options for the field at the specified offset.
      * @param fieldOffset the offset in copy.
@@ -186,34 +356,44 @@ private:
     epics::pvData::PVStructurePtr pvMaster;
     epics::pvData::StructureConstPtr structure;
     CopyNodePtr headNode;
+    CompiledRequestPtr compiledRequest;
     epics::pvData::PVStructurePtr cacheInitStructure;
     epics::pvData::BitSetPtr ignorechangeBitSet;
+    // the nodes with post-copy filters, in the order of the fields of the copy
+    std::vector<CopyNode *> postCopyNodes;
+    epics::pvData::Mutex postCopyMutex;
 
     void traverseMaster(
         CopyNodePtr const &node,
         PVCopyTraverseMasterCallbackPtr const & callback);
-    void updateCopySetBitSet(
-        epics::pvData::PVFieldPtr const &pvCopy,
-        epics::pvData::PVFieldPtr const &pvMaster,
-        epics::pvData::BitSetPtr const &bitSet);
     void updateCopySetBitSet(
         epics::pvData::PVFieldPtr const &pvCopy,
         CopyNodePtr const &node,
-        epics::pvData::BitSetPtr const &bitSet);
+        epics::pvData::BitSetPtr const &bitSet,
+        PVFilterContext & context,
+        PostCopySnapshot *snapshot);
     void updateCopyFromBitSet(
         epics::pvData::PVFieldPtr const &pvCopy,
         CopyNodePtr const &node,
-        epics::pvData::BitSetPtr const &bitSet);
-    void updateMaster(
+        epics::pvData::BitSetPtr const &bitSet,
+        ChangedArrayRanges *arrayRanges,
+        PVFilterContext & context,
+        PostCopySnapshot *snapshot);
+    bool updateMaster(
         epics::pvData::PVFieldPtr const &pvCopy,
         CopyNodePtr const &node,
-        epics::pvData::BitSetPtr const &bitSet);
+        epics::pvData::BitSetPtr const &bitSet,
+        PVFilterContext & context,
+        bool skipUnchanged);
 
     PVCopy(epics::pvData::PVStructurePtr const &pvMaster);
     bool init(epics::pvData::PVStructurePtr const &pvRequest);
     epics::pvData::StructureConstPtr createStructure(
         epics::pvData::PVStructurePtr const &pvMaster,
         epics::pvData::PVStructurePtr const &pvFromRequest);
+    epics::pvData::FieldConstPtr getCopyField(
+        epics::pvData::PVStructurePtr const &pvFromRequest,
+        epics::pvData::PVFieldPtr const &pvMasterField);
     CopyNodePtr createStructureNodes(
         epics::pvData::PVStructurePtr const &pvMasterStructure,
         epics::pvData::PVStructurePtr const &pvFromRequest,
@@ -224,6 +404,12 @@ private:
         epics::pvData::PVFieldPtr const & pvMasterField);
     void traverseMasterInitPlugin();
     void traverseMasterInitPlugin(CopyNodePtr const & node);
+    bool runFilters(
+        CopyNode const & node,
+        epics::pvData::PVFieldPtr const &pvCopy,
+        epics::pvData::BitSetPtr const &bitSet,
+        PVFilterContext & context,
+        bool toCopy);
 
     CopyNodePtr getCopyOffset(
         CopyStructureNodePtr const &structureNode,
@@ -61,18 +61,26 @@ public:
 
 /**
  * @brief  A filter that sets a timeStamp to the current time.
+ *
+ * The current time is the time of the update, from PVFilterContext.
  */
-class epicsShareClass PVTimestampFilter : public PVFilter
+class epicsShareClass PVTimestampFilter : public PVFilterV2
 {
 private:
-    epics::pvData::PVTimeStamp pvTimeStamp;
+    epics::pvData::PVTimeStamp pvTimeStamp;  // attached to master
     epics::pvData::TimeStamp timeStamp;
     bool current;
     bool copy;
-    epics::pvData::PVFieldPtr master;
-    
+    // the offset of the copy and the positions of its fields, npos if a field is missing
+    std::size_t copyOffset;
+    std::size_t secondsIndex;
+    std::size_t nanosecondsIndex;
+    std::size_t userTagIndex;
 
     PVTimestampFilter(bool current,bool copy,epics::pvData::PVFieldPtr const & pvField);
+    void findCopyFields(View const & copyView);
+    void getTimeStamp(epics::pvData::PVStructure & pvStructure,epics::pvData::TimeStamp & timeStamp);
+    void putTimeStamp(epics::pvData::PVStructure & pvStructure,epics::pvData::TimeStamp const & timeStamp);
 public:
     POINTER_DEFINITIONS(PVTimestampFilter);
     virtual ~PVTimestampFilter();
@@ -86,13 +94,13 @@ public:
     static PVTimestampFilterPtr create(const std::string & requestValue,const epics::pvData::PVFieldPtr & master);
     /**
      * Perform a filter operation
-     * @param pvCopy The field in the copy PVStructure.
-     * @param bitSet A bitSet for copyPVStructure.
+     * @param master The timeStamp field in master.
+     * @param copy The timeStamp field in copy.
+     * @param context The context of the update.
      * @param toCopy (true,false) means copy (from master to copy,from copy to master)
      * @return if filter (modified, did not modify) destination.
-     * Null is returned if master or requestValue is not appropriate for the plugin.
      */
-    bool filter(const epics::pvData::PVFieldPtr & pvCopy,const epics::pvData::BitSetPtr & bitSet,bool toCopy);
+    bool filterView(View const & master,View const & copy,PVFilterContext & context,bool toCopy);
     /**
      * Get the filter name.
      * @return The name.
@@ -4,10 +4,9 @@
  */
 
 #include <stdlib.h>
+#include <algorithm>
 #include <pv/pvData.h>
 #include <pv/bitSet.h>
-#include <pv/convert.h>
-#include <pv/pvSubArrayCopy.h>
 #define epicsExportSharedSymbols
 #include <pv/pvArrayPlugin.h>
 
@@ -21,9 +20,75 @@ using namespace epics::pvData;
 
 namespace epics { namespace pvCopy{
 
-static ConvertPtr convert = getConvert();
 static std::string name("array");
 
+/*
+ * Typed kernels that copy every increment'th element.
+ * The destination array is reused, i.e. it keeps its capacity between updates
+ * and is only reallocated if it is shared.
+ */
+template<typename T>
+struct ArrayKernel
+{
+    typedef PVValueArray<T> PVAT;
+
+    // copy[i] = master[start + i*increment] for i<len
+    static void gather(
+        PVScalarArray & masterArray,
+        PVScalarArray & copyArray,
+        size_t start,
+        size_t increment,
+        size_t len)
+    {
+        PVAT & pvTo = static_cast<PVAT &>(copyArray);
+        typename PVAT::const_svector const & from = static_cast<PVAT &>(masterArray).view();
+        typename PVAT::svector to(pvTo.reuse());
+        to.resize(len);
+        const T * src = from.data() + start;
+        T * dst = to.data();
+        if(increment==1) {
+            std::copy(src,src+len,dst);
+        } else {
+            for(size_t i=0; i<len; ++i) dst[i] = src[i*increment];
+        }
+        pvTo.replace(freeze(to));
+    }
+
+    // master[start + i*increment] = copy[i] for i<len
+    static void scatter(
+        PVScalarArray & copyArray,
+        PVScalarArray & masterArray,
+        size_t start,
+        size_t increment,
+        size_t len)
+    {
+        PVAT & pvTo = static_cast<PVAT &>(masterArray);
+        typename PVAT::const_svector const & from = static_cast<PVAT &>(copyArray).view();
+        if(len>from.size()) len = from.size();
+        if(len==0) return;
+        typename PVAT::svector to(pvTo.reuse());
+        size_t last = start + (len-1)*increment;
+        if(to.size()<=last) to.resize(last+1);
+        const T * src = from.data();
+        T * dst = to.data() + start;
+        if(increment==1) {
+            std::copy(src,src+len,dst);
+        } else {
+            for(size_t i=0; i<len; ++i) dst[i*increment] = src[i];
+        }
+        pvTo.replace(freeze(to));
+    }
+};
+
+template<typename T>
+static void setKernels(
+    PVArrayFilter::CopyFunc & gather,
+    PVArrayFilter::CopyFunc & scatter)
+{
+    gather = &ArrayKernel<T>::gather;
+    scatter = &ArrayKernel<T>::scatter;
+}
+
 PVArrayPlugin::PVArrayPlugin()
 {
 }
@@ -108,6 +173,7 @@ PVArrayFilterPtr PVArrayFilter::create(
     } else {
         ok = false;
     }
+    if(increment<1) ok = false;
     if(!ok) {
         PVArrayFilterPtr filter = PVArrayFilterPtr();
         return filter;
@@ -123,8 +189,24 @@ PVArrayFilter::PVArrayFilter(long start,long increment,long end,const PVScalarAr
 : start(start),
   increment(increment),
   end(end),
-  masterArray(masterArray)
+  masterArray(masterArray),
+  gather(0),
+  scatter(0)
 {
+    switch(masterArray->getScalarArray()->getElementType()) {
+    case pvBoolean: setKernels<boolean>(gather,scatter); break;
+    case pvByte: setKernels<int8>(gather,scatter); break;
+    case pvShort: setKernels<int16>(gather,scatter); break;
+    case pvInt: setKernels<int32>(gather,scatter); break;
+    case pvLong: setKernels<int64>(gather,scatter); break;
+    case pvUByte: setKernels<uint8>(gather,scatter); break;
+    case pvUShort: setKernels<uint16>(gather,scatter); break;
+    case pvUInt: setKernels<uint32>(gather,scatter); break;
+    case pvULong: setKernels<uint64>(gather,scatter); break;
+    case pvFloat: setKernels<float>(gather,scatter); break;
+    case pvDouble: setKernels<double>(gather,scatter); break;
+    case pvString: setKernels<string>(gather,scatter); break;
+    }
 }
 
 
@@ -151,36 +233,13 @@ bool PVArrayFilter::filter(const PVFieldPtr & pvCopy,const BitSetPtr & bitSet,bo
     		copyArray->setLength(0);
     		return true;
     	}
-    	long indfrom = start;
-    	long indto = 0;
-    	copyArray->setCapacity(len);
-    	if(increment==1) {
-            copy(*masterArray,indfrom,1,*copyArray,indto,1,len);
-    	} else {
-    	    for(long i=0; i<len; ++i) {
-    	        copy(*masterArray,indfrom,1,*copyArray,indto,1,1);
-    	        indfrom += increment;
-    	         indto += 1;
-    	    }
-    	}
-    	copyArray->setLength(len);
+    	gather(*masterArray,*copyArray,start,increment,len);
     	bitSet->set(pvCopy->getFieldOffset());
     	return true;
     }
     if (end - start >= 0) len = 1 + (end - start) / increment;
     if(len<=0) return true;
-    if(no_elements<=end) masterArray->setLength(end+1);
-    long indfrom = 0;
-    long indto = start;
-    if(increment==1) {
-    	copy(*copyArray,indfrom,1,*masterArray,indto,1,len);
-    } else {
-    	for(long i=0; i<len; ++i) {
-    	    copy(*copyArray,indfrom,1,*masterArray,indto,1,1);
-    	    indfrom += increment;
-    	     indto += 1;
-    	}
-    }
+    scatter(*copyArray,*masterArray,start,increment,len);
     return true;
 }
 
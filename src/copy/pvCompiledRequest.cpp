@@ -0,0 +1,165 @@
+/* pvCompiledRequest.cpp */
+/*
+ * The License for this software can be found in the file LICENSE that is included with the distribution.
+ */
+#include <stdlib.h>
+
+#include <pv/pvData.h>
+#include <pv/lock.h>
+#define epicsExportSharedSymbols
+#include <pv/pvCompiledRequest.h>
+
+using std::string;
+using std::size_t;
+using std::tr1::static_pointer_cast;
+using namespace epics::pvData;
+
+namespace epics { namespace pvCopy{
+
+typedef std::pair<const Structure *,string> CacheKey;
+typedef std::map<CacheKey,CompiledRequestPtr> CompiledRequestMap;
+
+static CompiledRequestMap compiledRequestMap;
+static Mutex mutex;
+// when the cache is full it is emptied
+static const size_t maxCacheSize = 256;
+
+/*
+ * Append the values of all the scalar fields of pvStructure to key.
+ * Together with the introspection interface this identifies the content of a pvRequest.
+ * Returns false if pvStructure has a field that is not a structure or scalar.
+ */
+static bool appendKey(PVStructure const & pvStructure,string & key)
+{
+    PVFieldPtrArray const & pvFields = pvStructure.getPVFields();
+    for(size_t i=0; i<pvFields.size(); ++i) {
+        PVField const & pvField = *pvFields[i];
+        Type type = pvField.getField()->getType();
+        if(type==structure) {
+            if(!appendKey(static_cast<PVStructure const &>(pvField),key)) return false;
+        } else if(type==scalar) {
+            key += static_cast<PVScalar const &>(pvField).getAs<string>();
+            key += '\0';
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool toInt(string const & value,long & result)
+{
+    const char * start = value.c_str();
+    char * end = 0;
+    result = strtol(start,&end,10);
+    return end!=start;
+}
+
+CompiledRequest::CompiledRequest()
+: generation(0),
+  process(-1),
+  nProcess(1),
+  skipUnchanged(-1),
+  queueSizeValid(false),
+  queueSize(0)
+{
+}
+
+CompiledRequestPtr CompiledRequest::get(PVStructurePtr const & pvRequest)
+{
+    string values;
+    bool cacheable = appendKey(*pvRequest,values);
+    CacheKey key(pvRequest->getStructure().get(),values);
+    size_t generation = PVPluginRegistry::getGeneration();
+    if(cacheable) {
+        Lock xx(mutex);
+        CompiledRequestMap::iterator iter = compiledRequestMap.find(key);
+        if(iter!=compiledRequestMap.end() && iter->second->generation==generation) {
+            return iter->second;
+        }
+    }
+    CompiledRequestPtr compiledRequest(new CompiledRequest());
+    compiledRequest->requestStructure = pvRequest->getStructure();
+    compiledRequest->generation = generation;
+    PVStructurePtr pvOptions = pvRequest->getSubField<PVStructure>("record._options");
+    if(pvOptions) compiledRequest->compileRecordOptions(pvOptions);
+    compiledRequest->compile(pvRequest);
+    if(cacheable) {
+        Lock xx(mutex);
+        if(compiledRequestMap.size()>=maxCacheSize) compiledRequestMap.clear();
+        compiledRequestMap[key] = compiledRequest;
+    }
+    return compiledRequest;
+}
+
+const CompiledRequest::FieldOptionArray * CompiledRequest::getFieldOptions(
+    PVStructurePtr const & pvOptions) const
+{
+    std::map<size_t,FieldOptionArray>::const_iterator iter =
+        fieldOptions.find(pvOptions->getFieldOffset());
+    if(iter==fieldOptions.end()) return 0;
+    return &iter->second;
+}
+
+void CompiledRequest::compile(PVStructurePtr const & pvStructure)
+{
+    PVFieldPtrArray const & pvFields = pvStructure->getPVFields();
+    for(size_t i=0; i<pvFields.size(); ++i) {
+        PVFieldPtr const & pvField = pvFields[i];
+        if(pvField->getField()->getType()!=structure) continue;
+        PVStructurePtr pvSubStructure = static_pointer_cast<PVStructure>(pvField);
+        if(pvField->getFieldName().compare("_options")!=0) {
+            compile(pvSubStructure);
+            continue;
+        }
+        PVFieldPtrArray const & pvOptions = pvSubStructure->getPVFields();
+        FieldOptionArray & options = fieldOptions[pvField->getFieldOffset()];
+        options.reserve(pvOptions.size());
+        for(size_t j=0; j<pvOptions.size(); ++j) {
+            PVFieldPtr const & pvOption = pvOptions[j];
+            if(pvOption->getField()->getType()!=scalar) continue;
+            FieldOption option;
+            option.name = pvOption->getFieldName();
+            option.value = static_pointer_cast<PVScalar>(pvOption)->getAs<string>();
+            option.pvPlugin = PVPluginRegistry::find(option.name);
+            options.push_back(option);
+        }
+    }
+}
+
+/*
+ * A boolean record option, which is a string "true" or "false" or a boolean.
+ * The value is -1 if the option is not present.
+ */
+static int getBooleanOption(PVStructurePtr const & pvOptions,string const & name)
+{
+    PVFieldPtr pvField = pvOptions->getSubField(name);
+    if(!pvField || pvField->getField()->getType()!=scalar) return -1;
+    ScalarType scalarType = static_pointer_cast<const Scalar>(
+        pvField->getField())->getScalarType();
+    if(scalarType==pvString) {
+        PVStringPtr pvString = static_pointer_cast<PVString>(pvField);
+        return (pvString->get().compare("true")==0) ? 1 : 0;
+    } else if(scalarType==pvBoolean) {
+        PVBooleanPtr pvBoolean = static_pointer_cast<PVBoolean>(pvField);
+        return pvBoolean->get() ? 1 : 0;
+    }
+    return -1;
+}
+
+void CompiledRequest::compileRecordOptions(PVStructurePtr const & pvOptions)
+{
+    process = getBooleanOption(pvOptions,"process");
+    skipUnchanged = getBooleanOption(pvOptions,"skipUnchanged");
+    long value = 0;
+    PVStringPtr pvString = pvOptions->getSubField<PVString>("nProcess");
+    if(pvString && toInt(pvString->get(),value)) nProcess = value;
+    pvString = pvOptions->getSubField<PVString>("queueSize");
+    if(pvString) {
+        queueSizeString = pvString->get();
+        queueSizeValid = toInt(queueSizeString,value);
+        if(queueSizeValid) queueSize = value;
+    }
+}
+
+}}
@@ -0,0 +1,305 @@
+/* pvCompressPlugin.cpp */
+/*
+ * The License for this software can be found in the file LICENSE that is included with the distribution.
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include <pv/pvData.h>
+#include <pv/bitSet.h>
+#define epicsExportSharedSymbols
+#include <pv/pvCompressPlugin.h>
+
+using std::string;
+using std::size_t;
+using std::tr1::static_pointer_cast;
+using namespace epics::pvData;
+
+namespace epics { namespace pvCopy{
+
+static std::string name("compress");
+
+static const size_t headerSize = 4;
+static const size_t blockSize = 128;
+
+static inline uint64 zigzag(uint64 delta)
+{
+    return (delta << 1) ^ (0 - (delta >> 63));
+}
+
+static inline uint64 unzigzag(uint64 value)
+{
+    return (value >> 1) ^ (0 - (value & 1));
+}
+
+static unsigned bitWidth(uint64 bits)
+{
+    unsigned width = 0;
+    while(bits) {
+        ++width;
+        bits >>= 1;
+    }
+    return width;
+}
+
+static size_t packedSize(size_t n,unsigned width)
+{
+    return (n*width + 7)/8;
+}
+
+/*
+ * Pack the low width bits of each value, least significant bit first.
+ * Returns the number of bytes written, i.e. packedSize(n,width).
+ */
+static size_t pack(const uint64 * values,size_t n,unsigned width,uint8 * dst)
+{
+    if(width==0) return 0;
+    uint8 * start = dst;
+    uint64 acc = 0;
+    unsigned nbits = 0;
+    for(size_t i=0; i<n; ++i) {
+        uint64 value = values[i];
+        acc |= value << nbits;
+        nbits += width;
+        if(nbits>=64) {
+            for(unsigned j=0; j<8; ++j) *dst++ = static_cast<uint8>(acc >> (8*j));
+            nbits -= 64;
+            acc = (nbits==0) ? 0 : value >> (width - nbits);
+        }
+    }
+    for(unsigned j=0; j<nbits; j+=8) {
+        *dst++ = static_cast<uint8>(acc);
+        acc >>= 8;
+    }
+    return dst - start;
+}
+
+static void unpack(const uint8 * src,size_t n,unsigned width,uint64 * values)
+{
+    if(width==0) {
+        std::fill(values,values+n,0);
+        return;
+    }
+    uint64 mask = (width==64) ? ~static_cast<uint64>(0) : (static_cast<uint64>(1) << width) - 1;
+    size_t bitpos = 0;
+    for(size_t i=0; i<n; ++i) {
+        const uint8 * byte = src + (bitpos >> 3);
+        unsigned shift = bitpos & 7;
+        unsigned nbytes = (shift + width + 7)/8;
+        uint64 value = 0;
+        for(unsigned j=0; j<nbytes && j<8; ++j) value |= static_cast<uint64>(byte[j]) << (8*j);
+        value >>= shift;
+        if(nbytes>8) value |= static_cast<uint64>(byte[8]) << (64 - shift);
+        values[i] = value & mask;
+        bitpos += width;
+    }
+}
+
+/*
+ * Check that src holds a complete encoding before master is modified.
+ */
+static bool isValid(const uint8 * src,size_t size,size_t length)
+{
+    size_t pos = headerSize;
+    for(size_t first=0; first<length; first+=blockSize) {
+        size_t n = std::min(blockSize,length-first);
+        if(pos>=size) return false;
+        unsigned width = src[pos++];
+        if(width>64) return false;
+        size_t nbytes = packedSize(n,width);
+        if(size-pos<nbytes) return false;
+        pos += nbytes;
+    }
+    return true;
+}
+
+/*
+ * The elements are converted to uint64, which sign extends signed types.
+ * The differences are computed modulo 2^64,
+ * so that decoding gives back every value of every type.
+ * Within a block the difference and zigzag loop has no dependency between iterations.
+ */
+template<typename T>
+struct CompressKernel
+{
+    typedef PVValueArray<T> PVAT;
+
+    static void encode(PVScalarArray & masterArray,PVScalarArray & copyArray)
+    {
+        typename PVAT::const_svector const & from = static_cast<PVAT &>(masterArray).view();
+        PVUByteArray & pvTo = static_cast<PVUByteArray &>(copyArray);
+        size_t length = from.size();
+        size_t nblocks = (length + blockSize - 1)/blockSize;
+        unsigned maxWidth = std::min(64u,static_cast<unsigned>(8*sizeof(T) + 1));
+        PVUByteArray::svector to(pvTo.reuse());
+        to.resize(headerSize + nblocks*(1 + packedSize(blockSize,maxWidth)));
+        uint8 * dst = to.data();
+        for(size_t j=0; j<headerSize; ++j) dst[j] = static_cast<uint8>(length >> (8*j));
+        size_t pos = headerSize;
+        const T * src = from.data();
+        uint64 previous = 0;
+        uint64 values[blockSize];
+        for(size_t first=0; first<length; first+=blockSize) {
+            size_t n = std::min(blockSize,length-first);
+            const T * block = src + first;
+            values[0] = zigzag(static_cast<uint64>(block[0]) - previous);
+            uint64 bits = values[0];
+            for(size_t i=1; i<n; ++i) {
+                values[i] = zigzag(static_cast<uint64>(block[i]) - static_cast<uint64>(block[i-1]));
+                bits |= values[i];
+            }
+            previous = static_cast<uint64>(block[n-1]);
+            unsigned width = bitWidth(bits);
+            dst[pos++] = static_cast<uint8>(width);
+            pos += pack(values,n,width,dst+pos);
+        }
+        to.resize(pos);
+        pvTo.replace(freeze(to));
+    }
+
+    static void decode(PVScalarArray & copyArray,PVScalarArray & masterArray)
+    {
+        PVUByteArray::const_svector const & from = static_cast<PVUByteArray &>(copyArray).view();
+        size_t size = from.size();
+        if(size<headerSize) throw std::runtime_error("compress: invalid encoding");
+        const uint8 * src = from.data();
+        size_t length = 0;
+        for(size_t j=0; j<headerSize; ++j) length |= static_cast<size_t>(src[j]) << (8*j);
+        // each block has at least its width byte, so the bytes limit the length before it is allocated
+        if(length>(size-headerSize)*blockSize || !isValid(src,size,length)) {
+            throw std::runtime_error("compress: invalid encoding");
+        }
+        PVAT & pvTo = static_cast<PVAT &>(masterArray);
+        typename PVAT::svector to(pvTo.reuse());
+        to.resize(length);
+        T * dst = to.data();
+        size_t pos = headerSize;
+        uint64 previous = 0;
+        uint64 values[blockSize];
+        for(size_t first=0; first<length; first+=blockSize) {
+            size_t n = std::min(blockSize,length-first);
+            unsigned width = src[pos++];
+            unpack(src+pos,n,width,values);
+            pos += packedSize(n,width);
+            for(size_t i=0; i<n; ++i) {
+                previous += unzigzag(values[i]);
+                dst[first+i] = static_cast<T>(previous);
+            }
+        }
+        pvTo.replace(freeze(to));
+    }
+};
+
+template<typename T>
+static void setKernels(
+    PVCompressFilter::EncodeFunc & encode,
+    PVCompressFilter::DecodeFunc & decode)
+{
+    encode = &CompressKernel<T>::encode;
+    decode = &CompressKernel<T>::decode;
+}
+
+static bool findKernels(
+    const std::string & requestValue,
+    const PVFieldPtr & master,
+    PVCompressFilter::EncodeFunc & encode,
+    PVCompressFilter::DecodeFunc & decode)
+{
+    if(requestValue.compare("delta")!=0) return false;
+    if(master->getField()->getType()!=scalarArray) return false;
+    PVScalarArrayPtr masterArray = static_pointer_cast<PVScalarArray>(master);
+    switch(masterArray->getScalarArray()->getElementType()) {
+    case pvByte: setKernels<int8>(encode,decode); return true;
+    case pvShort: setKernels<int16>(encode,decode); return true;
+    case pvInt: setKernels<int32>(encode,decode); return true;
+    case pvLong: setKernels<int64>(encode,decode); return true;
+    case pvUByte: setKernels<uint8>(encode,decode); return true;
+    case pvUShort: setKernels<uint16>(encode,decode); return true;
+    case pvUInt: setKernels<uint32>(encode,decode); return true;
+    case pvULong: setKernels<uint64>(encode,decode); return true;
+    default: return false;
+    }
+}
+
+PVCompressPlugin::PVCompressPlugin()
+{
+}
+
+PVCompressPlugin::~PVCompressPlugin()
+{
+}
+
+void PVCompressPlugin::create()
+{
+     static bool firstTime = true;
+     if(firstTime) {
+         firstTime = false;
+         PVCompressPluginPtr pvPlugin = PVCompressPluginPtr(new PVCompressPlugin());
+         PVPluginRegistry::registerPlugin(name,pvPlugin);
+    }
+}
+
+PVFilterPtr PVCompressPlugin::create(
+     const std::string & requestValue,
+     const PVCopyPtr & pvCopy,
+     const PVFieldPtr & master)
+{
+    return PVCompressFilter::create(requestValue,master);
+}
+
+FieldConstPtr PVCompressPlugin::getCopyField(
+     const std::string & requestValue,
+     const PVFieldPtr & master)
+{
+    PVCompressFilter::EncodeFunc encode = 0;
+    PVCompressFilter::DecodeFunc decode = 0;
+    if(!findKernels(requestValue,master,encode,decode)) return FieldConstPtr();
+    return getFieldCreate()->createScalarArray(pvUByte);
+}
+
+PVCompressFilter::~PVCompressFilter()
+{
+}
+
+PVCompressFilterPtr PVCompressFilter::create(
+     const std::string & requestValue,
+     const PVFieldPtr & master)
+{
+    EncodeFunc encode = 0;
+    DecodeFunc decode = 0;
+    if(!findKernels(requestValue,master,encode,decode)) return PVCompressFilterPtr();
+    PVCompressFilterPtr filter =
+         PVCompressFilterPtr(
+             new PVCompressFilter(
+                 static_pointer_cast<PVScalarArray>(master),encode,decode));
+    return filter;
+}
+
+PVCompressFilter::PVCompressFilter(
+    const PVScalarArrayPtr & masterArray,
+    EncodeFunc encode,
+    DecodeFunc decode)
+: masterArray(masterArray),
+  encode(encode),
+  decode(decode)
+{
+}
+
+bool PVCompressFilter::filter(const PVFieldPtr & pvCopy,const BitSetPtr & bitSet,bool toCopy)
+{
+    PVScalarArrayPtr copyArray = static_pointer_cast<PVScalarArray>(pvCopy);
+    if(toCopy) {
+        encode(*masterArray,*copyArray);
+        bitSet->set(pvCopy->getFieldOffset());
+        return true;
+    }
+    decode(*copyArray,*masterArray);
+    return true;
+}
+
+string PVCompressFilter::getName()
+{
+	return name;
+}
+
+}}
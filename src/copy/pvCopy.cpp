@@ -19,6 +19,8 @@
 #define epicsExportSharedSymbols
 #include <pv/pvPlugin.h>
 #include <pv/pvStructureCopy.h>
+#include <pv/pvFieldKernel.h>
+#include <pv/pvCompiledRequest.h>
 
 using std::tr1::static_pointer_cast;
 using std::tr1::dynamic_pointer_cast;
@@ -47,11 +49,14 @@ static PVCopyPtr NULLPVCopy;
 static StructureConstPtr NULLStructure;
 static PVStructurePtr NULLPVStructure;
 
+static const size_t noPostCopy = static_cast<size_t>(-1);
+
 struct CopyNode {
     CopyNode()
     : isStructure(false),
       structureOffset(0),
-      nfields(0)
+      nfields(0),
+      postCopyIndex(noPostCopy)
     {}
     PVFieldPtr masterPVField;
     bool isStructure;
@@ -59,6 +64,16 @@ struct CopyNode {
     size_t nfields;
     PVStructurePtr options;
     vector<PVFilterPtr> pvFilters;
+    // the PVFilterV2 of each filter, null for a filter that only implements PVFilter
+    vector<PVFilterV2 *> pvFiltersV2;
+    // For a node that is not a structure node:
+    // the kernel of each leaf field of masterPVField in depth first order.
+    // Empty if a plugin gave the copy a type that differs from master.
+    vector<const PVFieldKernel *> kernels;
+    // For a node with post-copy filters:
+    // the index in PVCopy::postCopyNodes and the kernels of the leaf fields of masterPVField.
+    size_t postCopyIndex;
+    vector<const PVFieldKernel *> masterKernels;
 };
     
 static CopyNodePtr NULLCopyNode;
@@ -70,6 +85,227 @@ struct CopyStructureNode : public  CopyNode {
     CopyNodePtrArrayPtr nodes;
 };
 
+struct PostCopySnapshot {
+    // for each node in PVCopy::postCopyNodes
+    // the value of masterPVField when the snapshot was taken
+    // and if the filters have not been called since.
+    vector<PVFieldPtr> masters;
+    vector<bool> pending;
+};
+
+/*
+ * Call each filter of node.
+ * A PVFilterV2 gets views of the master and copy fields and the context of the update.
+ * master is masterPVField of node or a snapshot of it.
+ */
+static bool callFilters(
+    CopyNode const & node,
+    PVField & pvMaster,
+    PVFieldPtr const & pvCopy,
+    BitSetPtr const & bitSet,
+    PVFilterContext & context,
+    bool toCopy)
+{
+    bool result = false;
+    for(size_t i=0; i< node.pvFilters.size(); ++i) {
+        PVFilterV2 * pvFilterV2 = node.pvFiltersV2[i];
+        if(pvFilterV2) {
+            PVFilterV2::View master;
+            PVFilterV2::View copy;
+            PVFilterV2::getView(pvMaster,master);
+            PVFilterV2::getView(*pvCopy,copy);
+            if(pvFilterV2->filterView(master,copy,context,toCopy)) result = true;
+        } else if(node.pvFilters[i]->filter(pvCopy,bitSet,toCopy)) {
+            result = true;
+        }
+    }
+    return result;
+}
+
+/*
+ * Find the kernel for each leaf field of pvField in depth first order.
+ * The kernel is null for a leaf that is not a scalar or scalarArray.
+ */
+static void findKernels(
+    PVFieldPtr const & pvField,
+    vector<const PVFieldKernel *> & kernels)
+{
+    if(pvField->getField()->getType()!=epics::pvData::structure) {
+        kernels.push_back(PVFieldKernel::find(pvField->getField()));
+        return;
+    }
+    PVFieldPtrArray const & pvFields =
+        static_pointer_cast<PVStructure>(pvField)->getPVFields();
+    for(size_t i=0; i<pvFields.size(); ++i) findKernels(pvFields[i],kernels);
+}
+
+/*
+ * Copy each leaf field of from to the same leaf field of to.
+ * to and from have the same introspection interface and
+ * kernel points to the kernels found by findKernels.
+ * If changed is not null only the leaf fields that differ are copied
+ * and the bit for each such field of to is set in changed.
+ */
+static void copyLeaves(
+    PVField & to,
+    PVField const & from,
+    const PVFieldKernel * const * & kernel,
+    BitSet * changed)
+{
+    if(to.getField()->getType()!=epics::pvData::structure) {
+        const PVFieldKernel * pvFieldKernel = *kernel++;
+        if(pvFieldKernel) {
+            if(changed && pvFieldKernel->equals(to,from)) return;
+            pvFieldKernel->copy(to,from);
+        } else {
+            if(changed && to==from) return;
+            to.copy(from);
+        }
+        if(changed) changed->set(to.getFieldOffset());
+        return;
+    }
+    PVFieldPtrArray const & toFields = static_cast<PVStructure &>(to).getPVFields();
+    PVFieldPtrArray const & fromFields =
+        static_cast<PVStructure const &>(from).getPVFields();
+    for(size_t i=0; i<toFields.size(); ++i) {
+        copyLeaves(*toFields[i],*fromFields[i],kernel,changed);
+    }
+}
+
+static void copyLeaves(
+    PVField & to,
+    PVField const & from,
+    CopyNodePtr const & node,
+    BitSet * changed)
+{
+    if(node->kernels.empty()) return;
+    const PVFieldKernel * const * kernel = &node->kernels[0];
+    copyLeaves(to,from,kernel,changed);
+}
+
+/*
+ * Copy each leaf field of from that differs from the same leaf field of to.
+ * A leaf field with the same value is not written, so nothing is posted for it.
+ * Returns true if a leaf field was written.
+ */
+static bool copyChangedLeaves(
+    PVField & to,
+    PVField const & from,
+    const PVFieldKernel * const * & kernel)
+{
+    if(to.getField()->getType()!=epics::pvData::structure) {
+        const PVFieldKernel * pvFieldKernel = *kernel++;
+        if(pvFieldKernel) {
+            if(pvFieldKernel->equals(to,from)) return false;
+            pvFieldKernel->copy(to,from);
+            return true;
+        }
+        if(to==from) return false;
+        to.copy(from);
+        return true;
+    }
+    PVFieldPtrArray const & toFields = static_cast<PVStructure &>(to).getPVFields();
+    PVFieldPtrArray const & fromFields =
+        static_cast<PVStructure const &>(from).getPVFields();
+    bool written = false;
+    for(size_t i=0; i<toFields.size(); ++i) {
+        if(copyChangedLeaves(*toFields[i],*fromFields[i],kernel)) written = true;
+    }
+    return written;
+}
+
+/*
+ * Copy masterPVField of a node with post-copy filters to its snapshot.
+ * An array is shared, not copied.
+ */
+static void takeSnapshot(CopyNode const & node,PostCopySnapshot & snapshot)
+{
+    size_t index = node.postCopyIndex;
+    if(!node.masterKernels.empty()) {
+        const PVFieldKernel * const * kernel = &node.masterKernels[0];
+        copyLeaves(*snapshot.masters[index],*node.masterPVField,kernel,0);
+    }
+    snapshot.pending[index] = true;
+}
+
+/*
+ * Update a scalarArray field of a copy from master.
+ * Only the changed ranges are copied if the field is tracked.
+ */
+static void copyArrayRanges(
+    PVField & pvCopy,
+    PVField const & pvMaster,
+    PVFieldKernel const & kernel,
+    ChangedArrayRanges & arrayRanges)
+{
+    size_t offset = pvCopy.getFieldOffset();
+    const ChangedArrayRanges::RangeArray * ranges = arrayRanges.getRanges(offset);
+    size_t length = static_cast<PVArray const &>(pvMaster).getLength();
+    bool copyAll = (!ranges || static_cast<PVArray &>(pvCopy).getLength()!=length);
+    if(!copyAll) {
+        for(size_t i=0; i<ranges->size(); ++i) {
+            ChangedArrayRanges::Range const & range = (*ranges)[i];
+            if(range.first + range.count > length) copyAll = true;
+        }
+    }
+    if(copyAll) {
+        kernel.copy(pvCopy,pvMaster);
+    } else {
+        for(size_t i=0; i<ranges->size(); ++i) {
+            ChangedArrayRanges::Range const & range = (*ranges)[i];
+            kernel.copyRange(pvCopy,pvMaster,range.first,range.count);
+        }
+    }
+    arrayRanges.track(offset);
+}
+
+void ChangedArrayRanges::track(size_t fieldOffset)
+{
+    ranges[fieldOffset].clear();
+}
+
+void ChangedArrayRanges::untrack(size_t fieldOffset)
+{
+    ranges.erase(fieldOffset);
+}
+
+void ChangedArrayRanges::untrackAll()
+{
+    ranges.clear();
+}
+
+void ChangedArrayRanges::add(size_t fieldOffset,size_t first,size_t count)
+{
+    std::map<size_t,RangeArray>::iterator iter = ranges.find(fieldOffset);
+    if(iter==ranges.end() || count==0) return;
+    RangeArray & array = iter->second;
+    size_t last = first + count;
+    // merge with every range that overlaps or is adjacent
+    RangeArray::iterator iterRange = array.begin();
+    while(iterRange!=array.end() && iterRange->first + iterRange->count < first) ++iterRange;
+    while(iterRange!=array.end() && iterRange->first <= last) {
+        if(iterRange->first < first) first = iterRange->first;
+        if(iterRange->first + iterRange->count > last) last = iterRange->first + iterRange->count;
+        iterRange = array.erase(iterRange);
+    }
+    Range range;
+    range.first = first;
+    range.count = last - first;
+    array.insert(iterRange,range);
+    if(array.size()<=maxRanges) return;
+    range.first = array.front().first;
+    range.count = array.back().first + array.back().count - range.first;
+    array.clear();
+    array.push_back(range);
+}
+
+const ChangedArrayRanges::RangeArray * ChangedArrayRanges::getRanges(size_t fieldOffset) const
+{
+    std::map<size_t,RangeArray>::const_iterator iter = ranges.find(fieldOffset);
+    if(iter==ranges.end()) return 0;
+    return &iter->second;
+}
+
 PVCopyPtr PVCopy::create(
     PVStructurePtr const &pvMaster, 
     PVStructurePtr const &pvRequest, 
@@ -85,6 +321,7 @@ PVCopyPtr PVCopy::create(
         pvStructure = pvRequest->getSubField<PVStructure>("field");
     }
     PVCopyPtr pvCopy = PVCopyPtr(new PVCopy(pvMaster));
+    pvCopy->compiledRequest = CompiledRequest::get(pvRequest);
     bool result = pvCopy->init(pvStructure);
     if(!result) return PVCopyPtr();
     pvCopy->traverseMasterInitPlugin();
@@ -187,7 +424,8 @@ void PVCopy::initCopy(
     for(size_t i=0; i< copyPVStructure->getNumberFields(); ++i) {
         bitSet->set(i,true);
     }
-    updateCopyFromBitSet(copyPVStructure,headNode,bitSet);
+    PVFilterContext context(*bitSet);
+    updateCopyFromBitSet(copyPVStructure,headNode,bitSet,0,context,0);
 }
 
 
@@ -195,7 +433,18 @@ bool PVCopy::updateCopySetBitSet(
     PVStructurePtr const  &copyPVStructure,
     BitSetPtr const  &bitSet)
 {
-    updateCopySetBitSet(copyPVStructure,headNode,bitSet);
+    PVFilterContext context(*bitSet);
+    updateCopySetBitSet(copyPVStructure,headNode,bitSet,context,0);
+    return checkIgnore(copyPVStructure,bitSet);
+}
+
+bool PVCopy::updateCopySetBitSet(
+    PVStructurePtr const  &copyPVStructure,
+    BitSetPtr const  &bitSet,
+    PostCopySnapshotPtr const &snapshot)
+{
+    PVFilterContext context(*bitSet);
+    updateCopySetBitSet(copyPVStructure,headNode,bitSet,context,snapshot.get());
     return checkIgnore(copyPVStructure,bitSet);
 }
 
@@ -208,20 +457,120 @@ bool PVCopy::updateCopyFromBitSet(
             bitSet->set(i,true);
         }
     }
-    updateCopyFromBitSet(copyPVStructure,headNode,bitSet);
+    PVFilterContext context(*bitSet);
+    updateCopyFromBitSet(copyPVStructure,headNode,bitSet,0,context,0);
+    return checkIgnore(copyPVStructure,bitSet);
+}
+
+bool PVCopy::updateCopyFromBitSet(
+    PVStructurePtr const  &copyPVStructure,
+    BitSetPtr const  &bitSet,
+    ChangedArrayRangesPtr const &arrayRanges)
+{
+    if(bitSet->get(0)) {
+        for(size_t i=0; i< copyPVStructure->getNumberFields(); ++i) {
+            bitSet->set(i,true);
+        }
+    }
+    PVFilterContext context(*bitSet);
+    updateCopyFromBitSet(copyPVStructure,headNode,bitSet,arrayRanges.get(),context,0);
+    return checkIgnore(copyPVStructure,bitSet);
+}
+
+bool PVCopy::updateCopyFromBitSet(
+    PVStructurePtr const  &copyPVStructure,
+    BitSetPtr const  &bitSet,
+    ChangedArrayRangesPtr const &arrayRanges,
+    PostCopySnapshotPtr const &snapshot)
+{
+    if(bitSet->get(0)) {
+        for(size_t i=0; i< copyPVStructure->getNumberFields(); ++i) {
+            bitSet->set(i,true);
+        }
+    }
+    PVFilterContext context(*bitSet);
+    updateCopyFromBitSet(copyPVStructure,headNode,bitSet,arrayRanges.get(),context,snapshot.get());
     return checkIgnore(copyPVStructure,bitSet);
 }
 
+PostCopySnapshotPtr PVCopy::createPostCopySnapshot()
+{
+    if(postCopyNodes.empty()) return PostCopySnapshotPtr();
+    PostCopySnapshotPtr snapshot(new PostCopySnapshot());
+    size_t num = postCopyNodes.size();
+    snapshot->masters.resize(num);
+    snapshot->pending.resize(num,false);
+    for(size_t i=0; i<num; ++i) {
+        snapshot->masters[i] =
+            getPVDataCreate()->createPVField(postCopyNodes[i]->masterPVField->getField());
+    }
+    return snapshot;
+}
+
+bool PVCopy::runPostCopyFilters(
+    PVStructurePtr const  &copyPVStructure,
+    BitSetPtr const  &bitSet,
+    PostCopySnapshotPtr const &snapshot)
+{
+    if(!snapshot) return false;
+    Lock xx(postCopyMutex);
+    PVFilterContext context(*bitSet);
+    bool result = false;
+    for(size_t i=0; i<postCopyNodes.size(); ++i) {
+        if(!snapshot->pending[i]) continue;
+        snapshot->pending[i] = false;
+        CopyNode const & node = *postCopyNodes[i];
+        PVField & pvMaster = *snapshot->masters[i];
+        PVFieldPtr pvCopy = copyPVStructure->getSubField(node.structureOffset);
+        if(!callFilters(node,pvMaster,pvCopy,bitSet,context,true) && !node.kernels.empty()) {
+            // no filter updated the copy, which has the type of master
+            const PVFieldKernel * const * kernel = &node.kernels[0];
+            copyLeaves(*pvCopy,pvMaster,kernel,bitSet.get());
+        }
+        if(bitSet->get(node.structureOffset)) result = true;
+    }
+    return result;
+}
+
 void PVCopy::updateMaster(
     PVStructurePtr const  &copyPVStructure,
     BitSetPtr const  &bitSet)
+{
+    updateMaster(copyPVStructure,bitSet,false);
+}
+
+bool PVCopy::updateMaster(
+    PVStructurePtr const  &copyPVStructure,
+    BitSetPtr const  &bitSet,
+    bool skipUnchanged)
 {
     if(bitSet->get(0)) {
         for(size_t i=0; i< copyPVStructure->getNumberFields(); ++i) {
             bitSet->set(i,true);
         }
     }
-    updateMaster(copyPVStructure,headNode,bitSet);
+    PVFilterContext context(*bitSet);
+    bool written = updateMaster(copyPVStructure,headNode,bitSet,context,skipUnchanged);
+    return written || !skipUnchanged;
+}
+
+/*
+ * The filters of a node with post-copy filters are called with postCopyMutex locked,
+ * so that they are never called by two threads at the same time.
+ */
+bool PVCopy::runFilters(
+    CopyNode const & node,
+    PVFieldPtr const & pvCopy,
+    BitSetPtr const & bitSet,
+    PVFilterContext & context,
+    bool toCopy)
+{
+    if(node.pvFilters.empty()) return false;
+    if(node.postCopyIndex==noPostCopy) {
+        return callFilters(node,*node.masterPVField,pvCopy,bitSet,context,toCopy);
+    }
+    Lock xx(postCopyMutex);
+    return callFilters(node,*node.masterPVField,pvCopy,bitSet,context,toCopy);
 }
 
 
@@ -276,45 +625,28 @@ void PVCopy::traverseMaster(
     }
 }
 
-void PVCopy::updateCopySetBitSet(
-    PVFieldPtr const & pvCopy,
-    PVFieldPtr const & pvMaster,
-    BitSetPtr const & bitSet)
-{
-    if(pvCopy->getField()->getType()!=epics::pvData::structure) {
-        if(*pvCopy==*pvMaster) return;
-        pvCopy->copy(*pvMaster);
-        bitSet->set(pvCopy->getFieldOffset());
-        return;
-    }
-    PVStructurePtr pvCopyStructure = static_pointer_cast<PVStructure>(pvCopy);
-    PVFieldPtrArray const & pvCopyFields = pvCopyStructure->getPVFields();
-    for(size_t i=0; i<pvCopyFields.size(); ++i) {
-        PVFieldPtr master = getMasterPVField(pvCopyFields[i]->getFieldOffset());
-        updateCopySetBitSet(pvCopyFields[i],master,bitSet);
-    }
-}
-
 void PVCopy::updateCopySetBitSet(
     PVFieldPtr const & pvCopy,
     CopyNodePtr const & node,
-    BitSetPtr const & bitSet)
+    BitSetPtr const & bitSet,
+    PVFilterContext & context,
+    PostCopySnapshot * snapshot)
 {
-    bool result = false;
-    for(size_t i=0; i< node->pvFilters.size(); ++i) {
-        PVFilterPtr pvFilter = node->pvFilters[i];
-        if(pvFilter->filter(pvCopy,bitSet,true)) result = true;
+    if(snapshot && node->postCopyIndex!=noPostCopy) {
+        takeSnapshot(*node,*snapshot);
+        return;
     }
+    bool result = runFilters(*node,pvCopy,bitSet,context,true);
     if(!node->isStructure) {
         if(result) return;
-        updateCopySetBitSet(pvCopy,node->masterPVField,bitSet);
+        copyLeaves(*pvCopy,*node->masterPVField,node,bitSet.get());
         return;
     }
     CopyStructureNodePtr structureNode = static_pointer_cast<CopyStructureNode>(node);
     PVStructurePtr pvCopyStructure = static_pointer_cast<PVStructure>(pvCopy);
     PVFieldPtrArray const & pvCopyFields = pvCopyStructure->getPVFields();
     for(size_t i=0; i<pvCopyFields.size(); ++i) {
-        updateCopySetBitSet(pvCopyFields[i],(*structureNode->nodes)[i],bitSet);
+        updateCopySetBitSet(pvCopyFields[i],(*structureNode->nodes)[i],bitSet,context,snapshot);
     }
 }
 
@@ -322,20 +654,26 @@ void PVCopy::updateCopySetBitSet(
 void PVCopy::updateCopyFromBitSet(
     PVFieldPtr const & pvCopy,
     CopyNodePtr const & node,
-    BitSetPtr const & bitSet)
+    BitSetPtr const & bitSet,
+    ChangedArrayRanges *arrayRanges,
+    PVFilterContext & context,
+    PostCopySnapshot * snapshot)
 {
     bool result = false;
     bool update = bitSet->get(pvCopy->getFieldOffset());
-    if(update) {
-        for(size_t i=0; i< node->pvFilters.size(); ++i) {
-            PVFilterPtr pvFilter = node->pvFilters[i];
-            if(pvFilter->filter(pvCopy,bitSet,true)) result = true;
-        }
+    if(update && snapshot && node->postCopyIndex!=noPostCopy) {
+        takeSnapshot(*node,*snapshot);
+        return;
     }
+    if(update) result = runFilters(*node,pvCopy,bitSet,context,true);
     if(!node->isStructure) {
         if(result) return;
-        PVFieldPtr pvMaster = node->masterPVField;
-        pvCopy->copy(*pvMaster);
+        if(arrayRanges && node->pvFilters.empty() && node->kernels.size()==1
+        && node->kernels[0] && node->kernels[0]->copyRange) {
+            copyArrayRanges(*pvCopy,*node->masterPVField,*node->kernels[0],*arrayRanges);
+            return;
+        }
+        copyLeaves(*pvCopy,*node->masterPVField,node,0);
         return;
     }
     CopyStructureNodePtr structureNode = static_pointer_cast<CopyStructureNode>(node);
@@ -346,38 +684,42 @@ void PVCopy::updateCopyFromBitSet(
     PVStructurePtr pvCopyStructure = static_pointer_cast<PVStructure>(pvCopy);
     PVFieldPtrArray const & pvCopyFields = pvCopyStructure->getPVFields();
     for(size_t i=0; i<pvCopyFields.size(); ++i) {
-        updateCopyFromBitSet(pvCopyFields[i],(*structureNode->nodes)[i],bitSet);
+        updateCopyFromBitSet(pvCopyFields[i],(*structureNode->nodes)[i],bitSet,arrayRanges,context,snapshot);
     }
 }
-void PVCopy::updateMaster(
+bool PVCopy::updateMaster(
     PVFieldPtr const & pvCopy,
     CopyNodePtr const & node,
-    BitSetPtr const & bitSet)
+    BitSetPtr const & bitSet,
+    PVFilterContext & context,
+    bool skipUnchanged)
 {
     bool result = false;
     bool update = bitSet->get(pvCopy->getFieldOffset());
-    if(update) {
-        for(size_t i=0; i< node->pvFilters.size(); ++i) {
-            PVFilterPtr pvFilter = node->pvFilters[i];
-            if(pvFilter->filter(pvCopy,bitSet,false)) result = true;
-        }
-    }
+    if(update) result = runFilters(*node,pvCopy,bitSet,context,false);
     if(!node->isStructure) {
-        if(result) return;
-        PVFieldPtr pvMaster = node->masterPVField;
-        pvMaster->copy(*pvCopy);
-        return;
+        if(result) return true;
+        if(skipUnchanged && !node->kernels.empty()) {
+            const PVFieldKernel * const * kernel = &node->kernels[0];
+            return copyChangedLeaves(*node->masterPVField,*pvCopy,kernel);
+        }
+        copyLeaves(*node->masterPVField,*pvCopy,node,0);
+        return true;
     }
     CopyStructureNodePtr structureNode = static_pointer_cast<CopyStructureNode>(node);
     size_t offset = structureNode->structureOffset;
     size_t nextSet = bitSet->nextSetBit(offset);
-    if(nextSet==string::npos) return;
-    if(offset>=pvCopy->getNextFieldOffset()) return;  
+    if(nextSet==string::npos) return false;
+    if(offset>=pvCopy->getNextFieldOffset()) return false;
     PVStructurePtr pvCopyStructure = static_pointer_cast<PVStructure>(pvCopy);
     PVFieldPtrArray const & pvCopyFields = pvCopyStructure->getPVFields();
+    bool written = false;
     for(size_t i=0; i<pvCopyFields.size(); ++i) {
-        updateMaster(pvCopyFields[i],(*structureNode->nodes)[i],bitSet);
+        if(updateMaster(pvCopyFields[i],(*structureNode->nodes)[i],bitSet,context,skipUnchanged)) {
+            written = true;
+        }
     }
+    return written;
 }
 
 PVCopy::PVCopy(
@@ -410,6 +752,7 @@ bool PVCopy::init(epics::pvData::PVStructurePtr const &pvRequest)
         node->structureOffset = 0;
         node->masterPVField = pvMasterStructure;
         node->nfields = pvMasterStructure->getNumberFields();
+        findKernels(pvMasterStructure,node->kernels);
         return true;
     }
     structure = createStructure(pvMasterStructure,pvRequest);
@@ -461,13 +804,33 @@ StructureConstPtr PVCopy::createStructure(
             }
         }
         fieldNames.push_back(fieldName);
-        fields.push_back(field);
+        fields.push_back(getCopyField(
+            static_pointer_cast<PVStructure>(pvFromRequestFields[i]),
+            pvMasterField));
     }
     size_t numsubfields = fields.size();
     if(numsubfields==0) return NULLStructure;
     return getFieldCreate()->createStructure(fieldNames, fields);
 }
 
+FieldConstPtr PVCopy::getCopyField(
+    PVStructurePtr const &pvFromRequest,
+    PVFieldPtr const &pvMasterField)
+{
+    PVStructurePtr pvOptions = pvFromRequest->getSubField<PVStructure>("_options");
+    if(pvOptions) {
+        const CompiledRequest::FieldOptionArray * options =
+            compiledRequest->getFieldOptions(pvOptions);
+        for(size_t i=0; options && i<options->size(); ++i) {
+            CompiledRequest::FieldOption const & option = (*options)[i];
+            if(!option.pvPlugin) continue;
+            FieldConstPtr field = option.pvPlugin->getCopyField(option.value,pvMasterField);
+            if(field) return field;
+        }
+    }
+    return pvMasterField->getField();
+}
+
 CopyNodePtr PVCopy::createStructureNodes(
     PVStructurePtr const &pvMasterStructure,
     PVStructurePtr const &pvFromRequest,
@@ -504,6 +867,10 @@ CopyNodePtr PVCopy::createStructureNodes(
         node->masterPVField = pvMasterField;
         node->nfields = copyPVField->getNumberFields();
         node->structureOffset = copyPVField->getFieldOffset();
+        // if a plugin changed the type of the copy only its filter updates the copy
+        if(*copyPVField->getField()==*pvMasterField->getField()) {
+            findKernels(pvMasterField,node->kernels);
+        }
         nodes->push_back(node);
     }
     CopyStructureNodePtr structureNode(new CopyStructureNode());
@@ -521,25 +888,55 @@ void PVCopy::initPlugin(
     PVStructurePtr const & pvOptions,
     PVFieldPtr const & pvMasterField)
 {
-    PVFieldPtrArray const & pvFields = pvOptions->getPVFields();
-    size_t num = pvFields.size();
+    const CompiledRequest::FieldOptionArray * options =
+        compiledRequest->getFieldOptions(pvOptions);
+    if(!options) return;
+    size_t num = options->size();
+    // if a plugin changed the type of the copy, as getCopyField found, only its filter is created,
+    // since the other filters expect a copy with the type of master
+    size_t copyTypeOption = num;
+    if(!node->isStructure) {
+        for(size_t i=0; i<num; ++i) {
+            CompiledRequest::FieldOption const & option = (*options)[i];
+            if(option.pvPlugin && option.pvPlugin->getCopyField(option.value,pvMasterField)) {
+                copyTypeOption = i;
+                break;
+            }
+        }
+    }
     vector<PVFilterPtr> pvFilters(num);
     size_t numfilter = 0;
     for(size_t i=0; i<num; ++i) {
-         PVStringPtr pvOption = static_pointer_cast<PVString>(pvFields[i]);
-         string name = pvOption->getFieldName();
-         string value = pvOption->get();
-         PVPluginPtr pvPlugin = PVPluginRegistry::find(name);
+         CompiledRequest::FieldOption const & option = (*options)[i];
+         PVPluginPtr const & pvPlugin = option.pvPlugin;
          if(!pvPlugin) {
-            if(name.compare("ignore")==0) setIgnore(node);
+            if(option.name.compare("ignore")==0) setIgnore(node);
             continue;
         }
-        pvFilters[numfilter] = pvPlugin->create(value,shared_from_this(),pvMasterField);
+        if(copyTypeOption<num && i!=copyTypeOption) continue;
+        pvFilters[numfilter] = pvPlugin->create(option.value,shared_from_this(),pvMasterField);
         if(pvFilters[numfilter]) ++numfilter;
     }
     if(numfilter==0) return;
     node->pvFilters.resize(numfilter);
-    for(size_t i=0; i<numfilter; ++i) node->pvFilters[i] = pvFilters[i];
+    node->pvFiltersV2.resize(numfilter);
+    bool postCopy = !node->isStructure;
+    bool anyPostCopy = false;
+    for(size_t i=0; i<numfilter; ++i) {
+        node->pvFilters[i] = pvFilters[i];
+        PVFilterV2 * pvFilterV2 = dynamic_cast<PVFilterV2 *>(pvFilters[i].get());
+        node->pvFiltersV2[i] = pvFilterV2;
+        // a filter that is not a PVFilterV2 reads master itself, so it can not be deferred
+        if(!pvFilterV2) {
+            postCopy = false;
+        } else if(pvFilterV2->isPostCopy()) {
+            anyPostCopy = true;
+        }
+    }
+    if(!postCopy || !anyPostCopy) return;
+    node->postCopyIndex = postCopyNodes.size();
+    postCopyNodes.push_back(node.get());
+    findKernels(pvMasterField,node->masterKernels);
 }
 
 void PVCopy::traverseMasterInitPlugin()
@@ -3,12 +3,14 @@
  * The License for this software can be found in the file LICENSE that is included with the distribution.
  */
 #include <stdlib.h>
+#include <math.h>
 
 #include <pv/pvData.h>
 #include <pv/bitSet.h>
 #include <pv/convert.h>
 #include <pv/pvSubArrayCopy.h>
 #define epicsExportSharedSymbols
+#include <pv/pvFieldKernel.h>
 #include <pv/pvDeadbandPlugin.h>
 
 using std::string;
@@ -21,9 +23,155 @@ using namespace epics::pvData;
 
 namespace epics { namespace pvCopy{
 
-static ConvertPtr convert = getConvert();
 static std::string name("deadband");
 
+/*
+ * Parse abs:value or rel:value.
+ */
+static bool parseRequest(const std::string & requestValue,bool & absolute,double & deadband)
+{
+    size_t ind = requestValue.find(':');
+    if(ind==string::npos) return false;
+    string type = requestValue.substr(0,ind);
+    if(type.compare("abs")==0) {
+        absolute = true;
+    } else if(type.compare("rel")==0) {
+        absolute = false;
+    } else {
+        return false;
+    }
+    deadband = atof(requestValue.c_str()+ind+1);
+    return deadband!=0.0;
+}
+
+/*
+ * The loop does not stop at the first element that exceeds the deadband,
+ * so that it has no branches.
+ */
+template<typename T>
+static bool anyExceeds(
+    PVScalarArray & masterArray,
+    PVScalarArray & lastArray,
+    double deadband,
+    bool absolute)
+{
+    typedef PVValueArray<T> PVAT;
+    typename PVAT::const_svector const & values = static_cast<PVAT &>(masterArray).view();
+    typename PVAT::const_svector const & last = static_cast<PVAT &>(lastArray).view();
+    size_t length = values.size();
+    if(last.size()!=length) return true;
+    const T * value = values.data();
+    const T * previous = last.data();
+    if(value==previous) return false;
+    int count = 0;
+    if(absolute) {
+        for(size_t i=0; i<length; ++i) {
+            double diff = static_cast<double>(value[i]) - static_cast<double>(previous[i]);
+            diff = (diff<0.0) ? -diff : diff;
+            count |= (diff>=deadband);
+        }
+    } else {
+        double factor = deadband/100.0;
+        for(size_t i=0; i<length; ++i) {
+            double reference = static_cast<double>(previous[i]);
+            double diff = static_cast<double>(value[i]) - reference;
+            diff = (diff<0.0) ? -diff : diff;
+            reference = (reference<0.0) ? -reference : reference;
+            // an element that was 0 exceeds the deadband if it changed at all
+            count |= (diff>=reference*factor) & (diff>0.0);
+        }
+    }
+    return count!=0;
+}
+
+/*
+ * The typed part of PVDeadbandFilter.
+ * update copies master to copy and returns true if the value must be reported.
+ */
+class ScalarDeadbandKernel
+{
+public:
+    virtual ~ScalarDeadbandKernel() {}
+    virtual bool update(PVField & copy,bool firstTime) = 0;
+};
+
+/*
+ * The distance between two values and the threshold for a deadband.
+ * Integers use uint64, which holds the distance between any two values of any integer type.
+ */
+template<typename T>
+struct Distance
+{
+    typedef uint64 type;
+    static uint64 get(T a,T b)
+    {
+        return (a>=b) ? static_cast<uint64>(a) - static_cast<uint64>(b)
+                      : static_cast<uint64>(b) - static_cast<uint64>(a);
+    }
+    static uint64 threshold(double deadband)
+    {
+        if(deadband<=0.0) return 0;
+        if(deadband>=18446744073709551615.0) return ~static_cast<uint64>(0);
+        return static_cast<uint64>(ceil(deadband));
+    }
+};
+
+template<typename T>
+struct FloatDistance
+{
+    typedef double type;
+    static double get(T a,T b)
+    {
+        double diff = static_cast<double>(a) - static_cast<double>(b);
+        return (diff<0.0) ? -diff : diff;
+    }
+    static double threshold(double deadband) { return deadband;}
+};
+
+template<> struct Distance<float> : public FloatDistance<float> {};
+template<> struct Distance<double> : public FloatDistance<double> {};
+
+/*
+ * The threshold only changes when a value is reported,
+ * so for a relative deadband it is computed then, by a multiplication.
+ * An update that is not reported is a subtraction and a compare.
+ */
+template<typename T>
+class TypedDeadbandKernel : public ScalarDeadbandKernel
+{
+public:
+    TypedDeadbandKernel(PVScalarPtr const & master,bool absolute,double deadband)
+    : master(static_pointer_cast<PVScalarValue<T> >(master)),
+      absolute(absolute),
+      deadband(deadband),
+      factor(deadband/100.0),
+      lastReported(0),
+      threshold(0)
+    {}
+    virtual bool update(PVField & copy,bool firstTime)
+    {
+        T value = master->get();
+        static_cast<PVScalarValue<T> &>(copy).put(value);
+        if(!firstTime && (value==lastReported || Distance<T>::get(value,lastReported)<threshold)) return false;
+        lastReported = value;
+        if(absolute) {
+            threshold = Distance<T>::threshold(deadband);
+        } else {
+            double reference = static_cast<double>(value);
+            if(reference<0.0) reference = -reference;
+            threshold = Distance<T>::threshold(reference*factor);
+        }
+        return true;
+    }
+private:
+    std::tr1::shared_ptr<PVScalarValue<T> > master;
+    bool absolute;
+    double deadband;
+    double factor;
+    T lastReported;
+    typename Distance<T>::type threshold;
+};
+
 PVDeadbandPlugin::PVDeadbandPlugin()
 {
 }
@@ -47,6 +195,9 @@ PVFilterPtr PVDeadbandPlugin::create(
      const PVCopyPtr & pvCopy,
      const PVFieldPtr & master)
 {
+    if(master->getField()->getType()==scalarArray) {
+        return PVArrayDeadbandFilter::create(requestValue,master);
+    }
     return PVDeadbandFilter::create(requestValue,master);
 }
 
@@ -61,34 +212,34 @@ PVDeadbandFilterPtr PVDeadbandFilter::create(
     FieldConstPtr field =master->getField();
     Type type = field->getType();
     if(type!=scalar) return PVDeadbandFilterPtr();
-    ScalarConstPtr scalar = static_pointer_cast<const Scalar>(field);
-    if(!ScalarTypeFunc::isNumeric(scalar->getScalarType())) return PVDeadbandFilterPtr();
     bool absolute = false;
-    if(requestValue.find("abs")>=0) {
-        absolute = true;
-    } else if(requestValue.find("rel")>=0) {
-        absolute = false;
-    } else {
-        return PVDeadbandFilterPtr();
+    double deadband = 0.0;
+    if(!parseRequest(requestValue,absolute,deadband)) return PVDeadbandFilterPtr();
+    PVScalarPtr pvScalar = static_pointer_cast<PVScalar>(master);
+    ScalarDeadbandKernel * kernel = 0;
+    switch(static_pointer_cast<const Scalar>(field)->getScalarType()) {
+    case pvByte: kernel = new TypedDeadbandKernel<int8>(pvScalar,absolute,deadband); break;
+    case pvShort: kernel = new TypedDeadbandKernel<int16>(pvScalar,absolute,deadband); break;
+    case pvInt: kernel = new TypedDeadbandKernel<int32>(pvScalar,absolute,deadband); break;
+    case pvLong: kernel = new TypedDeadbandKernel<int64>(pvScalar,absolute,deadband); break;
+    case pvUByte: kernel = new TypedDeadbandKernel<uint8>(pvScalar,absolute,deadband); break;
+    case pvUShort: kernel = new TypedDeadbandKernel<uint16>(pvScalar,absolute,deadband); break;
+    case pvUInt: kernel = new TypedDeadbandKernel<uint32>(pvScalar,absolute,deadband); break;
+    case pvULong: kernel = new TypedDeadbandKernel<uint64>(pvScalar,absolute,deadband); break;
+    case pvFloat: kernel = new TypedDeadbandKernel<float>(pvScalar,absolute,deadband); break;
+    case pvDouble: kernel = new TypedDeadbandKernel<double>(pvScalar,absolute,deadband); break;
+    default: return PVDeadbandFilterPtr();
     }
-    size_t ind = requestValue.find(':');
-    if(ind==string::npos) return PVDeadbandFilterPtr();
-    string svalue = requestValue.substr(ind+1);
-    double deadband = atof(svalue.c_str());
-    if(deadband==0.0) return PVDeadbandFilterPtr();
     PVDeadbandFilterPtr filter =
          PVDeadbandFilterPtr(
-             new PVDeadbandFilter(
-                 absolute,deadband,static_pointer_cast<PVScalar>(master))); 
+             new PVDeadbandFilter(std::tr1::shared_ptr<ScalarDeadbandKernel>(kernel)));
     return filter;
 }
 
-PVDeadbandFilter::PVDeadbandFilter(bool absolute,double deadband,PVScalarPtr const & master)
-: absolute(absolute),
-  deadband(deadband),
-  master(master),
-  firstTime(true),
-  lastReportedValue(0.0) 
+PVDeadbandFilter::PVDeadbandFilter(
+    std::tr1::shared_ptr<ScalarDeadbandKernel> const & deadbandKernel)
+: deadbandKernel(deadbandKernel),
+  firstTime(true)
 {
 }
 
@@ -96,31 +247,14 @@ PVDeadbandFilter::PVDeadbandFilter(bool absolute,double deadband,PVScalarPtr con
 bool PVDeadbandFilter::filter(const PVFieldPtr & pvCopy,const BitSetPtr & bitSet,bool toCopy)
 {
     if(!toCopy) return false;
-    double value = convert->toDouble(master);
-    double diff = value - lastReportedValue;
-    if(diff<0.0) diff = - diff;
-    bool report = true;
-    if(firstTime) {
-        firstTime = false;
-    } else if(absolute) {
-        if(diff<deadband) report = false;
+    bool report = deadbandKernel->update(*pvCopy,firstTime);
+    firstTime = false;
+    if(report) {
+        bitSet->set(pvCopy->getFieldOffset());
     } else {
-        double last = lastReportedValue;
-        if(last<0.0) last = -last;
-        if(last>1e-20) {
-            double percent = (diff/last)*100.0;
-            if(percent<deadband) report = false;
-         }
-     }
-     PVScalarPtr copy = static_pointer_cast<PVScalar>(pvCopy);
-     convert->fromDouble(copy,value);
-     if(report) {
-         lastReportedValue = value;
-         bitSet->set(pvCopy->getFieldOffset());
-     } else {
-         bitSet->clear(pvCopy->getFieldOffset());
-     }
-     return true;
+        bitSet->clear(pvCopy->getFieldOffset());
+    }
+    return true;
 }
 
 string PVDeadbandFilter::getName()
@@ -128,5 +262,77 @@ string PVDeadbandFilter::getName()
 	return name;
 }
 
+PVArrayDeadbandFilter::~PVArrayDeadbandFilter()
+{
+}
+
+PVArrayDeadbandFilterPtr PVArrayDeadbandFilter::create(
+     const std::string & requestValue,
+     const PVFieldPtr & master)
+{
+    FieldConstPtr field = master->getField();
+    if(field->getType()!=scalarArray) return PVArrayDeadbandFilterPtr();
+    ExceedsFunc exceedsFunc = 0;
+    switch(static_pointer_cast<const ScalarArray>(field)->getElementType()) {
+    case pvByte: exceedsFunc = &anyExceeds<int8>; break;
+    case pvShort: exceedsFunc = &anyExceeds<int16>; break;
+    case pvInt: exceedsFunc = &anyExceeds<int32>; break;
+    case pvLong: exceedsFunc = &anyExceeds<int64>; break;
+    case pvUByte: exceedsFunc = &anyExceeds<uint8>; break;
+    case pvUShort: exceedsFunc = &anyExceeds<uint16>; break;
+    case pvUInt: exceedsFunc = &anyExceeds<uint32>; break;
+    case pvULong: exceedsFunc = &anyExceeds<uint64>; break;
+    case pvFloat: exceedsFunc = &anyExceeds<float>; break;
+    case pvDouble: exceedsFunc = &anyExceeds<double>; break;
+    default: return PVArrayDeadbandFilterPtr();
+    }
+    bool absolute = false;
+    double deadband = 0.0;
+    if(!parseRequest(requestValue,absolute,deadband)) return PVArrayDeadbandFilterPtr();
+    PVArrayDeadbandFilterPtr filter =
+         PVArrayDeadbandFilterPtr(
+             new PVArrayDeadbandFilter(
+                 absolute,deadband,static_pointer_cast<PVScalarArray>(master),
+                 PVFieldKernel::find(field),exceedsFunc));
+    return filter;
+}
+
+PVArrayDeadbandFilter::PVArrayDeadbandFilter(
+    bool absolute,double deadband,
+    PVScalarArrayPtr const & master,
+    const PVFieldKernel * kernel,
+    ExceedsFunc exceeds)
+: absolute(absolute),
+  deadband(deadband),
+  master(master),
+  lastReported(getPVDataCreate()->createPVScalarArray(
+      master->getScalarArray()->getElementType())),
+  kernel(kernel),
+  exceeds(exceeds),
+  firstTime(true)
+{
+}
+
+bool PVArrayDeadbandFilter::filter(const PVFieldPtr & pvCopy,const BitSetPtr & bitSet,bool toCopy)
+{
+    if(!toCopy) return false;
+    bool report = firstTime || exceeds(*master,*lastReported,deadband,absolute);
+    firstTime = false;
+    // the copy kernel shares the array data, it does not copy the elements
+    kernel->copy(*pvCopy,*master);
+    if(report) {
+        kernel->copy(*lastReported,*master);
+        bitSet->set(pvCopy->getFieldOffset());
+    } else {
+        bitSet->clear(pvCopy->getFieldOffset());
+    }
+    return true;
+}
+
+string PVArrayDeadbandFilter::getName()
+{
+	return name;
+}
+
 }}
 
@@ -0,0 +1,195 @@
+/* pvDecimatePlugin.cpp */
+/*
+ * The License for this software can be found in the file LICENSE that is included with the distribution.
+ */
+
+#include <stdlib.h>
+#include <pv/pvData.h>
+#include <pv/bitSet.h>
+#define epicsExportSharedSymbols
+#include <pv/pvDecimatePlugin.h>
+
+using std::string;
+using std::size_t;
+using std::tr1::static_pointer_cast;
+using namespace epics::pvData;
+
+namespace epics { namespace pvCopy{
+
+static std::string name("decimate");
+
+/*
+ * For each bin: min, max and mean.
+ * The sum uses four independent partial sums,
+ * so that the loop is not one long chain of dependent additions.
+ */
+template<typename T>
+static void minMaxMean(PVScalarArray & masterArray,PVScalarArray & copyArray,size_t nbins)
+{
+    typedef PVValueArray<T> PVAT;
+    PVAT & pvTo = static_cast<PVAT &>(copyArray);
+    typename PVAT::const_svector const & from = static_cast<PVAT &>(masterArray).view();
+    size_t length = from.size();
+    size_t bins = (nbins<length) ? nbins : length;
+    typename PVAT::svector to(pvTo.reuse());
+    to.resize(3*bins);
+    const T * src = from.data();
+    T * dst = to.data();
+    for(size_t bin=0; bin<bins; ++bin) {
+        size_t first = (bin*length)/bins;
+        size_t last = ((bin+1)*length)/bins;
+        T minValue = src[first];
+        T maxValue = src[first];
+        for(size_t i=first; i<last; ++i) {
+            minValue = (src[i]<minValue) ? src[i] : minValue;
+            maxValue = (src[i]>maxValue) ? src[i] : maxValue;
+        }
+        double sum[4] = {0.0,0.0,0.0,0.0};
+        size_t i = first;
+        for(; i+4<=last; i+=4) {
+            for(size_t k=0; k<4; ++k) sum[k] += static_cast<double>(src[i+k]);
+        }
+        for(; i<last; ++i) sum[0] += static_cast<double>(src[i]);
+        dst[3*bin] = minValue;
+        dst[3*bin+1] = maxValue;
+        dst[3*bin+2] = static_cast<T>(((sum[0] + sum[1]) + (sum[2] + sum[3]))/(last-first));
+    }
+    pvTo.replace(freeze(to));
+}
+
+PVDecimatePlugin::PVDecimatePlugin()
+{
+}
+
+PVDecimatePlugin::~PVDecimatePlugin()
+{
+}
+
+void PVDecimatePlugin::create()
+{
+     static bool firstTime = true;
+     if(firstTime) {
+         firstTime = false;
+         PVDecimatePluginPtr pvPlugin = PVDecimatePluginPtr(new PVDecimatePlugin());
+         PVPluginRegistry::registerPlugin(name,pvPlugin);
+    }
+}
+
+PVFilterPtr PVDecimatePlugin::create(
+     const std::string & requestValue,
+     const PVCopyPtr & pvCopy,
+     const PVFieldPtr & master)
+{
+    if(requestValue.find(':')==string::npos) {
+        return PVSampleFilter::create(requestValue,master);
+    }
+    return PVDecimateFilter::create(requestValue,master);
+}
+
+PVDecimateFilter::~PVDecimateFilter()
+{
+}
+
+PVDecimateFilterPtr PVDecimateFilter::create(
+     const std::string & requestValue,
+     const PVFieldPtr & master)
+{
+    if(master->getField()->getType()!=scalarArray) return PVDecimateFilterPtr();
+    PVScalarArrayPtr masterArray = static_pointer_cast<PVScalarArray>(master);
+    DecimateFunc decimateFunc = 0;
+    switch(masterArray->getScalarArray()->getElementType()) {
+    case pvByte: decimateFunc = &minMaxMean<int8>; break;
+    case pvShort: decimateFunc = &minMaxMean<int16>; break;
+    case pvInt: decimateFunc = &minMaxMean<int32>; break;
+    case pvLong: decimateFunc = &minMaxMean<int64>; break;
+    case pvUByte: decimateFunc = &minMaxMean<uint8>; break;
+    case pvUShort: decimateFunc = &minMaxMean<uint16>; break;
+    case pvUInt: decimateFunc = &minMaxMean<uint32>; break;
+    case pvULong: decimateFunc = &minMaxMean<uint64>; break;
+    case pvFloat: decimateFunc = &minMaxMean<float>; break;
+    case pvDouble: decimateFunc = &minMaxMean<double>; break;
+    default: return PVDecimateFilterPtr();
+    }
+    size_t ind = requestValue.find(':');
+    if(ind==string::npos) return PVDecimateFilterPtr();
+    if(requestValue.substr(0,ind).compare("minmax")!=0) return PVDecimateFilterPtr();
+    const char * value = requestValue.c_str()+ind+1;
+    char * end = 0;
+    long nbins = strtol(value,&end,10);
+    if(end==value || *end!='\0' || nbins<1) return PVDecimateFilterPtr();
+    PVDecimateFilterPtr filter =
+         PVDecimateFilterPtr(
+             new PVDecimateFilter(nbins,masterArray,decimateFunc,
+                 PVSharedResult::find(master,name,requestValue)));
+    return filter;
+}
+
+PVDecimateFilter::PVDecimateFilter(
+    size_t nbins,
+    const PVScalarArrayPtr & masterArray,
+    DecimateFunc decimate,
+    const PVSharedResultPtr & sharedResult)
+: nbins(nbins),
+  masterArray(masterArray),
+  decimate(decimate),
+  sharedResult(sharedResult)
+{
+}
+
+bool PVDecimateFilter::filter(const PVFieldPtr & pvCopy,const BitSetPtr & bitSet,bool toCopy)
+{
+    if(!toCopy) return true;
+    if(!sharedResult->getResult(*masterArray,*pvCopy)) {
+        decimate(*masterArray,*static_pointer_cast<PVScalarArray>(pvCopy),nbins);
+        sharedResult->putResult(*masterArray,*pvCopy);
+    }
+    bitSet->set(pvCopy->getFieldOffset());
+    return true;
+}
+
+string PVDecimateFilter::getName()
+{
+	return name;
+}
+
+PVSampleFilter::~PVSampleFilter()
+{
+}
+
+PVSampleFilterPtr PVSampleFilter::create(
+     const std::string & requestValue,
+     const PVFieldPtr & master)
+{
+    if(master->getField()->getType()==structure) return PVSampleFilterPtr();
+    const char * value = requestValue.c_str();
+    char * end = 0;
+    long n = strtol(value,&end,10);
+    if(end==value || *end!='\0' || n<1) return PVSampleFilterPtr();
+    PVSampleFilterPtr filter =
+         PVSampleFilterPtr(
+             new PVSampleFilter(n));
+    return filter;
+}
+
+PVSampleFilter::PVSampleFilter(size_t n)
+: n(n),
+  count(0)
+{
+}
+
+bool PVSampleFilter::filter(const PVFieldPtr & pvCopy,const BitSetPtr & bitSet,bool toCopy)
+{
+    if(!toCopy) return false;
+    bool report = (count==0);
+    if(++count>=n) count = 0;
+    if(report) return false;
+    bitSet->clear(pvCopy->getFieldOffset());
+    return true;
+}
+
+string PVSampleFilter::getName()
+{
+	return name;
+}
+
+}}
@@ -0,0 +1,144 @@
+/* pvFieldKernel.cpp */
+/*
+ * The License for this software can be found in the file LICENSE that is included with the distribution.
+ */
+#include <algorithm>
+
+#include <pv/pvData.h>
+#define epicsExportSharedSymbols
+#include <pv/pvFieldKernel.h>
+
+using std::size_t;
+using namespace epics::pvData;
+
+namespace epics { namespace pvCopy{
+
+static const size_t chunkSize = 256;
+
+/*
+ * The elements are compared a chunk at a time.
+ * The loop over a chunk counts differences without branches so that the compiler can vectorize it,
+ * and the comparison stops at the first chunk that differs.
+ */
+template<typename T>
+static bool equalElements(const T * a,const T * b,size_t length)
+{
+    for(size_t first=0; first<length; first+=chunkSize) {
+        size_t n = std::min(chunkSize,length-first);
+        const T * chunkA = a + first;
+        const T * chunkB = b + first;
+        size_t ndiff = 0;
+        for(size_t i=0; i<n; ++i) ndiff += (chunkA[i]!=chunkB[i]) ? 1 : 0;
+        if(ndiff>0) return false;
+    }
+    return true;
+}
+
+template<typename T>
+struct ScalarKernel
+{
+    typedef PVScalarValue<T> PVT;
+    static bool equals(const PVField & a,const PVField & b)
+    {
+        return static_cast<const PVT &>(a).get()==static_cast<const PVT &>(b).get();
+    }
+    static void copy(PVField & to,const PVField & from)
+    {
+        static_cast<PVT &>(to).put(static_cast<const PVT &>(from).get());
+    }
+    static double toDouble(const PVField & pvField)
+    {
+        return static_cast<double>(static_cast<const PVT &>(pvField).get());
+    }
+    static void fromDouble(PVField & pvField,double value)
+    {
+        static_cast<PVT &>(pvField).put(static_cast<T>(value));
+    }
+};
+
+template<typename T>
+struct ScalarArrayKernel
+{
+    typedef PVValueArray<T> PVAT;
+    typedef typename PVAT::const_svector const_svector;
+    static bool equals(const PVField & a,const PVField & b)
+    {
+        const_svector const & va = static_cast<const PVAT &>(a).view();
+        const_svector const & vb = static_cast<const PVAT &>(b).view();
+        if(va.size()!=vb.size()) return false;
+        if(va.data()==vb.data()) return true;
+        return equalElements(va.data(),vb.data(),va.size());
+    }
+    static void copy(PVField & to,const PVField & from)
+    {
+        static_cast<PVAT &>(to).replace(static_cast<const PVAT &>(from).view());
+    }
+    static void copyRange(PVField & to,const PVField & from,size_t first,size_t count)
+    {
+        PVAT & pvTo = static_cast<PVAT &>(to);
+        const_svector const & vfrom = static_cast<const PVAT &>(from).view();
+        typename PVAT::svector vto(pvTo.reuse());
+        std::copy(vfrom.begin()+first,vfrom.begin()+first+count,vto.begin()+first);
+        pvTo.replace(freeze(vto));
+    }
+};
+
+#define PVFIELDKERNEL_NUMERIC(T) \
+    { &ScalarKernel<T>::equals, &ScalarKernel<T>::copy, \
+      &ScalarKernel<T>::toDouble, &ScalarKernel<T>::fromDouble, 0 }
+#define PVFIELDKERNEL_OTHER(T) \
+    { &ScalarKernel<T>::equals, &ScalarKernel<T>::copy, 0, 0, 0 }
+#define PVFIELDKERNEL_ARRAY(T) \
+    { &ScalarArrayKernel<T>::equals, &ScalarArrayKernel<T>::copy, 0, 0, \
+      &ScalarArrayKernel<T>::copyRange }
+
+// indexed by ScalarType
+static const PVFieldKernel scalarKernels[] = {
+    PVFIELDKERNEL_OTHER(boolean),
+    PVFIELDKERNEL_NUMERIC(int8),
+    PVFIELDKERNEL_NUMERIC(int16),
+    PVFIELDKERNEL_NUMERIC(int32),
+    PVFIELDKERNEL_NUMERIC(int64),
+    PVFIELDKERNEL_NUMERIC(uint8),
+    PVFIELDKERNEL_NUMERIC(uint16),
+    PVFIELDKERNEL_NUMERIC(uint32),
+    PVFIELDKERNEL_NUMERIC(uint64),
+    PVFIELDKERNEL_NUMERIC(float),
+    PVFIELDKERNEL_NUMERIC(double),
+    PVFIELDKERNEL_OTHER(std::string)
+};
+
+static const PVFieldKernel scalarArrayKernels[] = {
+    PVFIELDKERNEL_ARRAY(boolean),
+    PVFIELDKERNEL_ARRAY(int8),
+    PVFIELDKERNEL_ARRAY(int16),
+    PVFIELDKERNEL_ARRAY(int32),
+    PVFIELDKERNEL_ARRAY(int64),
+    PVFIELDKERNEL_ARRAY(uint8),
+    PVFIELDKERNEL_ARRAY(uint16),
+    PVFIELDKERNEL_ARRAY(uint32),
+    PVFIELDKERNEL_ARRAY(uint64),
+    PVFIELDKERNEL_ARRAY(float),
+    PVFIELDKERNEL_ARRAY(double),
+    PVFIELDKERNEL_ARRAY(std::string)
+};
+
+#undef PVFIELDKERNEL_NUMERIC
+#undef PVFIELDKERNEL_OTHER
+#undef PVFIELDKERNEL_ARRAY
+
+const PVFieldKernel * PVFieldKernel::find(const FieldConstPtr & field)
+{
+    switch(field->getType()) {
+    case scalar:
+        return &scalarKernels[
+            static_cast<const Scalar *>(field.get())->getScalarType()];
+    case scalarArray:
+        return &scalarArrayKernels[
+            static_cast<const ScalarArray *>(field.get())->getElementType()];
+    default:
+        return 0;
+    }
+}
+
+}}
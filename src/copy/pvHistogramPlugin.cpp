@@ -0,0 +1,230 @@
+/* pvHistogramPlugin.cpp */
+/*
+ * The License for this software can be found in the file LICENSE that is included with the distribution.
+ */
+
+#include <stdlib.h>
+#include <algorithm>
+#include <limits>
+
+#include <pv/pvData.h>
+#include <pv/bitSet.h>
+#define epicsExportSharedSymbols
+#include <pv/pvHistogramPlugin.h>
+
+using std::string;
+using std::size_t;
+using std::vector;
+using std::tr1::static_pointer_cast;
+using namespace epics::pvData;
+
+namespace epics { namespace pvCopy{
+
+static std::string name("histogram");
+
+static const size_t chunkSize = 256;
+
+/*
+ * The bin of each value of a chunk is computed first, by a loop without branches.
+ * A value outside [lo,hi) gets bin nbins,
+ * which is not part of the histogram. Only the increments are done one at a time.
+ */
+template<typename T>
+static void countValues(
+    const T * values,
+    size_t length,
+    PVHistogramFilter::Binning const & binning,
+    int32 * counts)
+{
+    uint32 bins[chunkSize];
+    double lo = binning.lo;
+    double hi = binning.hi;
+    double scale = binning.scale;
+    uint32 nbins = static_cast<uint32>(binning.nbins);
+    uint32 last = nbins - 1;
+    for(size_t first=0; first<length; first+=chunkSize) {
+        size_t n = std::min(chunkSize,length-first);
+        const T * chunk = values + first;
+        for(size_t i=0; i<n; ++i) {
+            double value = static_cast<double>(chunk[i]);
+            bool inRange = (value>=lo) && (value<hi);
+            double position = inRange ? (value - lo)*scale : 0.0;
+            uint32 bin = static_cast<uint32>(position);
+            bin = (bin>last) ? last : bin;
+            bins[i] = inRange ? bin : nbins;
+        }
+        for(size_t i=0; i<n; ++i) {
+            if(bins[i]<nbins) ++counts[bins[i]];
+        }
+    }
+}
+
+template<typename T>
+static void countScalar(
+    PVField & master,
+    PVHistogramFilter::Binning const & binning,
+    int32 * counts)
+{
+    T value = static_cast<PVScalarValue<T> &>(master).get();
+    countValues(&value,1,binning,counts);
+}
+
+template<typename T>
+static void countArray(
+    PVField & master,
+    PVHistogramFilter::Binning const & binning,
+    int32 * counts)
+{
+    typedef PVValueArray<T> PVAT;
+    typename PVAT::const_svector const & values = static_cast<PVAT &>(master).view();
+    countValues(values.data(),values.size(),binning,counts);
+}
+
+template<typename T>
+static PVHistogramFilter::CountFunc getCount(bool isArray)
+{
+    return isArray ? &countArray<T> : &countScalar<T>;
+}
+
+static PVHistogramFilter::CountFunc findCount(const PVFieldPtr & master)
+{
+    FieldConstPtr field = master->getField();
+    ScalarType scalarType;
+    if(field->getType()==scalar) {
+        scalarType = static_pointer_cast<const Scalar>(field)->getScalarType();
+    } else if(field->getType()==scalarArray) {
+        scalarType = static_pointer_cast<const ScalarArray>(field)->getElementType();
+    } else {
+        return 0;
+    }
+    bool isArray = (field->getType()==scalarArray);
+    switch(scalarType) {
+    case pvByte: return getCount<int8>(isArray);
+    case pvShort: return getCount<int16>(isArray);
+    case pvInt: return getCount<int32>(isArray);
+    case pvLong: return getCount<int64>(isArray);
+    case pvUByte: return getCount<uint8>(isArray);
+    case pvUShort: return getCount<uint16>(isArray);
+    case pvUInt: return getCount<uint32>(isArray);
+    case pvULong: return getCount<uint64>(isArray);
+    case pvFloat: return getCount<float>(isArray);
+    case pvDouble: return getCount<double>(isArray);
+    default: return 0;
+    }
+}
+
+/*
+ * Parse lo:hi:nbins.
+ */
+static bool parseRequest(const std::string & requestValue,PVHistogramFilter::Binning & binning)
+{
+    const char * value = requestValue.c_str();
+    char * end = 0;
+    binning.lo = strtod(value,&end);
+    if(end==value || *end!=':') return false;
+    value = end + 1;
+    binning.hi = strtod(value,&end);
+    if(end==value || *end!=':') return false;
+    value = end + 1;
+    long nbins = strtol(value,&end,10);
+    if(end==value || *end!='\0') return false;
+    if(nbins<1 || nbins>1000000 || !(binning.hi>binning.lo)) return false;
+    binning.nbins = nbins;
+    binning.scale = nbins/(binning.hi - binning.lo);
+    // a range too small, or too large, for its scale to be a finite double is refused
+    double scale = binning.scale;
+    if(!(scale>0.0 && scale<=std::numeric_limits<double>::max())) return false;
+    return true;
+}
+
+PVHistogramPlugin::PVHistogramPlugin()
+{
+}
+
+PVHistogramPlugin::~PVHistogramPlugin()
+{
+}
+
+void PVHistogramPlugin::create()
+{
+     static bool firstTime = true;
+     if(firstTime) {
+         firstTime = false;
+         PVHistogramPluginPtr pvPlugin = PVHistogramPluginPtr(new PVHistogramPlugin());
+         PVPluginRegistry::registerPlugin(name,pvPlugin);
+    }
+}
+
+PVFilterPtr PVHistogramPlugin::create(
+     const std::string & requestValue,
+     const PVCopyPtr & pvCopy,
+     const PVFieldPtr & master)
+{
+    return PVHistogramFilter::create(requestValue,master);
+}
+
+FieldConstPtr PVHistogramPlugin::getCopyField(
+     const std::string & requestValue,
+     const PVFieldPtr & master)
+{
+    PVHistogramFilter::Binning binning;
+    if(!findCount(master)) return FieldConstPtr();
+    if(!parseRequest(requestValue,binning)) return FieldConstPtr();
+    return getFieldCreate()->createScalarArray(pvInt);
+}
+
+PVHistogramFilter::~PVHistogramFilter()
+{
+}
+
+PVHistogramFilterPtr PVHistogramFilter::create(
+     const std::string & requestValue,
+     const PVFieldPtr & master)
+{
+    CountFunc count = findCount(master);
+    if(!count) return PVHistogramFilterPtr();
+    Binning binning;
+    if(!parseRequest(requestValue,binning)) return PVHistogramFilterPtr();
+    PVHistogramFilterPtr filter =
+         PVHistogramFilterPtr(
+             new PVHistogramFilter(master,count,binning));
+    return filter;
+}
+
+PVHistogramFilter::PVHistogramFilter(
+    const PVFieldPtr & master,
+    CountFunc count,
+    Binning const & binning)
+: master(master),
+  count(count),
+  binning(binning),
+  accumulate(master->getField()->getType()==scalar)
+{
+    if(accumulate) counts.resize(binning.nbins,0);
+}
+
+bool PVHistogramFilter::filter(const PVFieldPtr & pvCopy,const BitSetPtr & bitSet,bool toCopy)
+{
+    if(!toCopy) return true;
+    PVIntArray & copyArray = static_cast<PVIntArray &>(*pvCopy);
+    PVIntArray::svector to(copyArray.reuse());
+    if(accumulate) {
+        count(*master,binning,&counts[0]);
+        to.resize(binning.nbins);
+        std::copy(counts.begin(),counts.end(),to.begin());
+    } else {
+        to.resize(binning.nbins);
+        std::fill(to.begin(),to.end(),0);
+        count(*master,binning,to.data());
+    }
+    copyArray.replace(freeze(to));
+    bitSet->set(pvCopy->getFieldOffset());
+    return true;
+}
+
+string PVHistogramFilter::getName()
+{
+	return name;
+}
+
+}}
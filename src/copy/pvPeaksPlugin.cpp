@@ -0,0 +1,272 @@
+/* pvPeaksPlugin.cpp */
+/*
+ * The License for this software can be found in the file LICENSE that is included with the distribution.
+ */
+
+#include <stdlib.h>
+#include <algorithm>
+
+#include <pv/pvData.h>
+#include <pv/bitSet.h>
+#define epicsExportSharedSymbols
+#include <pv/pvPeaksPlugin.h>
+
+using std::string;
+using std::size_t;
+using std::tr1::static_pointer_cast;
+using namespace epics::pvData;
+
+namespace epics { namespace pvCopy{
+
+typedef PVPeaksFilter::Config Config;
+typedef PVPeaksFilter::CandidateArray CandidateArray;
+
+static std::string name("peaks");
+
+static const size_t chunkSize = 256;
+
+static bool higher(
+    std::pair<double,size_t> const & left,
+    std::pair<double,size_t> const & right)
+{
+    if(left.first!=right.first) return left.first>right.first;
+    return left.second<right.second;
+}
+
+/*
+ * The local maxima of a chunk are flagged first, by a loop without branches.
+ * Only the flagged elements are collected.
+ */
+template<typename T>
+static void scanPeaks(const T * src,size_t length,double threshold,CandidateArray & candidates)
+{
+    candidates.clear();
+    if(length==0) return;
+    if(length==1) {
+        if(static_cast<double>(src[0])>threshold) {
+            candidates.push_back(std::make_pair(static_cast<double>(src[0]),size_t(0)));
+        }
+        return;
+    }
+    if(static_cast<double>(src[0])>threshold && src[0]>src[1]) {
+        candidates.push_back(std::make_pair(static_cast<double>(src[0]),size_t(0)));
+    }
+    uint8 flags[chunkSize];
+    for(size_t first=1; first<length-1; first+=chunkSize) {
+        size_t n = std::min(chunkSize,length-1-first);
+        const T * chunk = src + first;
+        for(size_t k=0; k<n; ++k) {
+            T value = chunk[k];
+            flags[k] = (static_cast<double>(value)>threshold)
+                & (value>=chunk[k-1])
+                & (value>chunk[k+1]);
+        }
+        for(size_t k=0; k<n; ++k) {
+            if(flags[k]) {
+                candidates.push_back(std::make_pair(static_cast<double>(chunk[k]),first+k));
+            }
+        }
+    }
+    size_t last = length - 1;
+    if(static_cast<double>(src[last])>threshold && src[last]>=src[last-1]) {
+        candidates.push_back(std::make_pair(static_cast<double>(src[last]),last));
+    }
+}
+
+/*
+ * Keep the highest candidates that are at least minSeparation apart.
+ */
+static void selectPeaks(Config const & config,CandidateArray & candidates)
+{
+    std::sort(candidates.begin(),candidates.end(),higher);
+    size_t npeaks = 0;
+    for(size_t i=0; i<candidates.size() && npeaks<config.maxPeaks; ++i) {
+        size_t index = candidates[i].second;
+        bool separated = true;
+        for(size_t j=0; separated && j<npeaks; ++j) {
+            size_t other = candidates[j].second;
+            size_t distance = (index>other) ? index - other : other - index;
+            separated = (distance>=config.minSeparation);
+        }
+        if(separated) candidates[npeaks++] = candidates[i];
+    }
+    candidates.resize(npeaks);
+}
+
+template<typename T>
+static double centroid(const T * src,size_t length,size_t peak,double threshold)
+{
+    size_t first = peak;
+    size_t last = peak;
+    while(first>0 && static_cast<double>(src[first-1])>threshold) --first;
+    while(last+1<length && static_cast<double>(src[last+1])>threshold) ++last;
+    double sum = 0.0;
+    double moment = 0.0;
+    for(size_t i=first; i<=last; ++i) {
+        double weight = static_cast<double>(src[i]) - threshold;
+        sum += weight;
+        moment += weight*i;
+    }
+    return (sum>0.0) ? moment/sum : static_cast<double>(peak);
+}
+
+template<typename T>
+static void findPeaks(
+    PVScalarArray & master,
+    Config const & config,
+    CandidateArray & candidates,
+    PVStructure & copy)
+{
+    typedef PVValueArray<T> PVAT;
+    typename PVAT::const_svector const & from = static_cast<PVAT &>(master).view();
+    const T * src = from.data();
+    size_t length = from.size();
+    scanPeaks(src,length,config.threshold,candidates);
+    selectPeaks(config,candidates);
+    size_t npeaks = candidates.size();
+    PVFieldPtrArray const & pvFields = copy.getPVFields();
+    PVIntArray & pvIndex = static_cast<PVIntArray &>(*pvFields[0]);
+    PVDoubleArray & pvHeight = static_cast<PVDoubleArray &>(*pvFields[1]);
+    PVDoubleArray & pvCentroid = static_cast<PVDoubleArray &>(*pvFields[2]);
+    PVIntArray::svector index(pvIndex.reuse());
+    PVDoubleArray::svector height(pvHeight.reuse());
+    PVDoubleArray::svector centroids(pvCentroid.reuse());
+    index.resize(npeaks);
+    height.resize(npeaks);
+    centroids.resize(config.centroid ? npeaks : 0);
+    for(size_t i=0; i<npeaks; ++i) {
+        height[i] = candidates[i].first;
+        index[i] = static_cast<int32>(candidates[i].second);
+        if(config.centroid) centroids[i] = centroid(src,length,candidates[i].second,config.threshold);
+    }
+    pvIndex.replace(freeze(index));
+    pvHeight.replace(freeze(height));
+    pvCentroid.replace(freeze(centroids));
+}
+
+static PVPeaksFilter::FindFunc findFind(const PVFieldPtr & master)
+{
+    FieldConstPtr field = master->getField();
+    if(field->getType()!=scalarArray) return 0;
+    ScalarType scalarType = static_pointer_cast<const ScalarArray>(field)->getElementType();
+    switch(scalarType) {
+    case pvByte: return &findPeaks<int8>;
+    case pvShort: return &findPeaks<int16>;
+    case pvInt: return &findPeaks<int32>;
+    case pvLong: return &findPeaks<int64>;
+    case pvUByte: return &findPeaks<uint8>;
+    case pvUShort: return &findPeaks<uint16>;
+    case pvUInt: return &findPeaks<uint32>;
+    case pvULong: return &findPeaks<uint64>;
+    case pvFloat: return &findPeaks<float>;
+    case pvDouble: return &findPeaks<double>;
+    default: return 0;
+    }
+}
+
+/*
+ * Parse threshold:K:minsep or threshold:K:minsep:centroid.
+ */
+static bool parseRequest(const std::string & requestValue,Config & config)
+{
+    const char * value = requestValue.c_str();
+    char * end = 0;
+    config.threshold = strtod(value,&end);
+    if(end==value || *end!=':') return false;
+    value = end + 1;
+    long maxPeaks = strtol(value,&end,10);
+    if(end==value || *end!=':' || maxPeaks<1) return false;
+    value = end + 1;
+    long minSeparation = strtol(value,&end,10);
+    if(end==value || minSeparation<0) return false;
+    config.maxPeaks = maxPeaks;
+    config.minSeparation = minSeparation;
+    config.centroid = false;
+    if(*end=='\0') return true;
+    if(string(end).compare(":centroid")!=0) return false;
+    config.centroid = true;
+    return true;
+}
+
+PVPeaksPlugin::PVPeaksPlugin()
+{
+}
+
+PVPeaksPlugin::~PVPeaksPlugin()
+{
+}
+
+void PVPeaksPlugin::create()
+{
+     static bool firstTime = true;
+     if(firstTime) {
+         firstTime = false;
+         PVPeaksPluginPtr pvPlugin = PVPeaksPluginPtr(new PVPeaksPlugin());
+         PVPluginRegistry::registerPlugin(name,pvPlugin);
+    }
+}
+
+PVFilterPtr PVPeaksPlugin::create(
+     const std::string & requestValue,
+     const PVCopyPtr & pvCopy,
+     const PVFieldPtr & master)
+{
+    return PVPeaksFilter::create(requestValue,master);
+}
+
+FieldConstPtr PVPeaksPlugin::getCopyField(
+     const std::string & requestValue,
+     const PVFieldPtr & master)
+{
+    Config config;
+    if(!findFind(master)) return FieldConstPtr();
+    if(!parseRequest(requestValue,config)) return FieldConstPtr();
+    return getFieldCreate()->createFieldBuilder()->
+        addArray("index",pvInt)->
+        addArray("height",pvDouble)->
+        addArray("centroid",pvDouble)->
+        createStructure();
+}
+
+PVPeaksFilter::~PVPeaksFilter()
+{
+}
+
+PVPeaksFilterPtr PVPeaksFilter::create(
+     const std::string & requestValue,
+     const PVFieldPtr & master)
+{
+    FindFunc find = findFind(master);
+    if(!find) return PVPeaksFilterPtr();
+    Config config;
+    if(!parseRequest(requestValue,config)) return PVPeaksFilterPtr();
+    PVPeaksFilterPtr filter =
+         PVPeaksFilterPtr(
+             new PVPeaksFilter(static_pointer_cast<PVScalarArray>(master),find,config));
+    return filter;
+}
+
+PVPeaksFilter::PVPeaksFilter(
+    const PVScalarArrayPtr & master,
+    FindFunc find,
+    Config const & config)
+: master(master),
+  find(find),
+  config(config)
+{
+}
+
+bool PVPeaksFilter::filter(const PVFieldPtr & pvCopy,const BitSetPtr & bitSet,bool toCopy)
+{
+    if(!toCopy) return true;
+    find(*master,config,candidates,*static_pointer_cast<PVStructure>(pvCopy));
+    bitSet->set(pvCopy->getFieldOffset());
+    return true;
+}
+
+string PVPeaksFilter::getName()
+{
+	return name;
+}
+
+}}
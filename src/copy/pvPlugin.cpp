@@ -3,35 +3,265 @@
  * The License for this software can be found in the file LICENSE that is included with the distribution.
  */
 
+#include <algorithm>
+#include <vector>
+#include <map>
+
+#include <epicsAtomic.h>
 #include <pv/pvData.h>
 #define epicsExportSharedSymbols
 #include <pv/pvStructureCopy.h>
 #include <pv/pvPlugin.h>
+#include <pv/pvFieldKernel.h>
+#include <pv/pvClock.h>
 
+using std::string;
+using std::size_t;
+using std::vector;
 using namespace epics::pvData;
 
 namespace epics { namespace pvCopy{ 
 
-typedef std::map<std::string,PVPluginPtr> PVPluginMap;
+PVFilterContext::PVFilterContext(BitSet & bitSet)
+: bitSet(bitSet),
+  haveTimeStamp(false)
+{
+}
+
+const TimeStamp & PVFilterContext::getTimeStamp()
+{
+    if(!haveTimeStamp) {
+        epics::pvDatabase::PVClock::getCurrent(timeStamp);
+        haveTimeStamp = true;
+    }
+    return timeStamp;
+}
+
+PVFilterV2::PVFilterV2(const PVFieldPtr & master)
+: master(master)
+{
+}
 
-static PVPluginMap pluginMap;
-static Mutex mutex;
+bool PVFilterV2::filter(const PVFieldPtr & copy,const BitSetPtr & bitSet,bool toCopy)
+{
+    View masterView;
+    View copyView;
+    getView(*master,masterView);
+    getView(*copy,copyView);
+    PVFilterContext context(*bitSet);
+    return filterView(masterView,copyView,context,toCopy);
+}
+
+template<typename T>
+static void getElements(PVField & field,PVFilterV2::View & view)
+{
+    typedef PVValueArray<T> PVAT;
+    typename PVAT::const_svector const & values = static_cast<PVAT &>(field).view();
+    view.data = values.data();
+    view.length = values.size();
+}
+
+void PVFilterV2::getView(PVField & field,View & view)
+{
+    const Field & introspection = *field.getField();
+    view.field = &field;
+    view.type = introspection.getType();
+    view.scalarType = pvBoolean;
+    view.data = 0;
+    view.length = 0;
+    view.offset = field.getFieldOffset();
+    if(view.type==scalar) {
+        view.scalarType = static_cast<const Scalar &>(introspection).getScalarType();
+        return;
+    }
+    if(view.type!=scalarArray) return;
+    view.scalarType = static_cast<const ScalarArray &>(introspection).getElementType();
+    switch(view.scalarType) {
+    case pvBoolean: getElements<boolean>(field,view); break;
+    case pvByte: getElements<int8>(field,view); break;
+    case pvShort: getElements<int16>(field,view); break;
+    case pvInt: getElements<int32>(field,view); break;
+    case pvLong: getElements<int64>(field,view); break;
+    case pvUByte: getElements<uint8>(field,view); break;
+    case pvUShort: getElements<uint16>(field,view); break;
+    case pvUInt: getElements<uint32>(field,view); break;
+    case pvULong: getElements<uint64>(field,view); break;
+    case pvFloat: getElements<float>(field,view); break;
+    case pvDouble: getElements<double>(field,view); break;
+    case pvString: getElements<string>(field,view); break;
+    }
+}
+
+/*
+ * The registry is an immutable snapshot that is replaced each time a plugin is registered.
+ * find reads the current snapshot without locking.
+ * Since a reader can still use a replaced snapshot, snapshots are never deleted.
+ * Plugins are only registered at startup so this is a few small objects.
+ */
+struct PluginEntry {
+    size_t hash;
+    string name;
+    PVPluginPtr pvPlugin;
+    bool operator<(PluginEntry const & other) const { return hash<other.hash;}
+};
+
+struct PluginSnapshot {
+    PluginSnapshot() : generation(0) {}
+    vector<PluginEntry> entries;  // sorted by hash
+    size_t generation;
+};
+
+static EpicsAtomicPtrT currentSnapshot = 0;
+static vector<PluginSnapshot *> snapshots;
+static Mutex mutex;  // serializes registerPlugin
+
+// FNV-1a
+static size_t hashName(string const & name)
+{
+    size_t hash = static_cast<size_t>(2166136261u);
+    for(size_t i=0; i<name.size(); ++i) {
+        hash ^= static_cast<unsigned char>(name[i]);
+        hash *= static_cast<size_t>(16777619u);
+    }
+    return hash;
+}
+
+static const PluginSnapshot * getSnapshot()
+{
+    const PluginSnapshot * snapshot =
+        static_cast<const PluginSnapshot *>(epicsAtomicGetPtrT(&currentSnapshot));
+    epicsAtomicReadMemoryBarrier();
+    return snapshot;
+}
+
+static const PluginEntry * findEntry(
+    const PluginSnapshot * snapshot,
+    size_t hash,
+    string const & name)
+{
+    if(!snapshot) return 0;
+    vector<PluginEntry> const & entries = snapshot->entries;
+    PluginEntry key;
+    key.hash = hash;
+    vector<PluginEntry>::const_iterator iter =
+        std::lower_bound(entries.begin(),entries.end(),key);
+    for(; iter!=entries.end() && iter->hash==hash; ++iter) {
+        if(iter->name==name) return &*iter;
+    }
+    return 0;
+}
 
 void PVPluginRegistry::registerPlugin(const std::string & name,const PVPluginPtr & pvPlugin)
 {
     Lock xx(mutex);
-    PVPluginMap::iterator iter = pluginMap.find(name);
-    if(iter!=pluginMap.end()) throw std::logic_error("plugin already registered");
-    pluginMap.insert(PVPluginMap::value_type(name,pvPlugin));
+    const PluginSnapshot * current = getSnapshot();
+    size_t hash = hashName(name);
+    if(findEntry(current,hash,name)) throw std::logic_error("plugin already registered");
+    PluginSnapshot * snapshot = new PluginSnapshot();
+    if(current) {
+        snapshot->entries = current->entries;
+        snapshot->generation = current->generation;
+    }
+    PluginEntry entry;
+    entry.hash = hash;
+    entry.name = name;
+    entry.pvPlugin = pvPlugin;
+    snapshot->entries.insert(
+        std::upper_bound(snapshot->entries.begin(),snapshot->entries.end(),entry),
+        entry);
+    ++snapshot->generation;
+    snapshots.push_back(snapshot);
+    epicsAtomicWriteMemoryBarrier();
+    epicsAtomicSetPtrT(&currentSnapshot,snapshot);
 }
 
 PVPluginPtr PVPluginRegistry::find(const std::string & name)
 {
-    Lock xx(mutex);
-    PVPluginMap::iterator iter = pluginMap.find(name);
-    if(iter!=pluginMap.end()) return (*iter).second;
+    const PluginEntry * entry = findEntry(getSnapshot(),hashName(name),name);
+    if(entry) return entry->pvPlugin;
     return PVPluginPtr();
 }
 
-}}
+std::size_t PVPluginRegistry::getGeneration()
+{
+    const PluginSnapshot * snapshot = getSnapshot();
+    return snapshot ? snapshot->generation : 0;
+}
+
+/*
+ * The shared results are kept by the filters.
+ * The map only has weak pointers, an expired entry is replaced by the next find.
+ * Since a live entry holds master, the address of master can not be reused while it is in the map.
+ */
+typedef std::pair<PVField *,string> SharedResultKey;
+typedef std::map<SharedResultKey,std::tr1::weak_ptr<PVSharedResult> > SharedResultMap;
+static SharedResultMap sharedResults;
+static Mutex sharedResultMutex;
+
+PVSharedResult::PVSharedResult(const PVFieldPtr & master)
+: master(master),
+  data(0),
+  length(0)
+{
+}
+
+PVSharedResultPtr PVSharedResult::find(
+    const PVFieldPtr & master,
+    const string & name,
+    const string & requestValue)
+{
+    if(master->getField()->getType()!=scalarArray) return PVSharedResultPtr();
+    SharedResultKey key(master.get(),name + "=" + requestValue);
+    Lock xx(sharedResultMutex);
+    PVSharedResultPtr sharedResult(sharedResults[key].lock());
+    if(sharedResult) return sharedResult;
+    // remove expired entries so that the map does not grow
+    SharedResultMap::iterator iter = sharedResults.begin();
+    while(iter!=sharedResults.end()) {
+        if(iter->second.expired()) {
+            sharedResults.erase(iter++);
+        } else {
+            ++iter;
+        }
+    }
+    sharedResult = PVSharedResultPtr(new PVSharedResult(master));
+    sharedResults[key] = sharedResult;
+    return sharedResult;
+}
 
+bool PVSharedResult::getResult(PVField & master,PVField & copy)
+{
+    PVFilterV2::View view;
+    PVFilterV2::getView(master,view);
+    Lock xx(mutex);
+    if(!result || view.data!=data || view.length!=length) return false;
+    const PVFieldKernel * kernel = PVFieldKernel::find(copy.getField());
+    if(kernel) {
+        kernel->copy(copy,*result);
+    } else {
+        copy.copy(*result);
+    }
+    return true;
+}
+
+void PVSharedResult::putResult(PVField & master,PVField const & copy)
+{
+    PVFilterV2::View view;
+    PVFilterV2::getView(master,view);
+    Lock xx(mutex);
+    if(!result) {
+        source = getPVDataCreate()->createPVField(master.getField());
+        result = getPVDataCreate()->createPVField(copy.getField());
+    }
+    PVFieldKernel::find(master.getField())->copy(*source,master);
+    const PVFieldKernel * kernel = PVFieldKernel::find(copy.getField());
+    if(kernel) {
+        kernel->copy(*result,copy);
+    } else {
+        result->copy(copy);
+    }
+    data = view.data;
+    length = view.length;
+}
+
+}}
@@ -0,0 +1,258 @@
+/* pvQuantilePlugin.cpp */
+/*
+ * The License for this software can be found in the file LICENSE that is included with the distribution.
+ */
+
+#include <stdlib.h>
+#include <algorithm>
+
+#include <pv/pvData.h>
+#include <pv/bitSet.h>
+#define epicsExportSharedSymbols
+#include <pv/pvQuantilePlugin.h>
+
+using std::string;
+using std::size_t;
+using std::vector;
+using std::tr1::static_pointer_cast;
+using namespace epics::pvData;
+
+namespace epics { namespace pvCopy{
+
+static std::string name("quantile");
+
+static const size_t maxQuantiles = 32;
+
+/*
+ * Five markers: the minimum, p/2, p, (1+p)/2 and the maximum.
+ * The positions are 0 based.
+ */
+void PVQuantileFilter::Estimator::init(double p)
+{
+    this->p = p;
+    count = 0.0;
+    for(int i=0; i<5; ++i) {
+        heights[i] = 0.0;
+        positions[i] = i;
+    }
+    desired[0] = 0.0;
+    desired[1] = 2.0*p;
+    desired[2] = 4.0*p;
+    desired[3] = 2.0 + 2.0*p;
+    desired[4] = 4.0;
+    increments[0] = 0.0;
+    increments[1] = p/2.0;
+    increments[2] = p;
+    increments[3] = (1.0 + p)/2.0;
+    increments[4] = 1.0;
+}
+
+void PVQuantileFilter::Estimator::add(double value)
+{
+    if(value!=value) return;  // NaN
+    if(count<5.0) {
+        heights[static_cast<int>(count)] = value;
+        count += 1.0;
+        if(count==5.0) std::sort(heights,heights+5);
+        return;
+    }
+    count += 1.0;
+    int k = 0;
+    if(value<heights[0]) {
+        heights[0] = value;
+        k = 0;
+    } else if(value>=heights[4]) {
+        heights[4] = value;
+        k = 3;
+    } else {
+        k = 0;
+        while(k<3 && value>=heights[k+1]) ++k;
+    }
+    for(int i=k+1; i<5; ++i) positions[i] += 1.0;
+    for(int i=0; i<5; ++i) desired[i] += increments[i];
+    for(int i=1; i<4; ++i) {
+        double d = desired[i] - positions[i];
+        if((d>=1.0 && positions[i+1]-positions[i]>1.0)
+        || (d<=-1.0 && positions[i-1]-positions[i]<-1.0)) {
+            double sign = (d>0.0) ? 1.0 : -1.0;
+            // parabolic prediction
+            double height = heights[i] + sign/(positions[i+1]-positions[i-1])
+                * ((positions[i]-positions[i-1]+sign)*(heights[i+1]-heights[i])/(positions[i+1]-positions[i])
+                 + (positions[i+1]-positions[i]-sign)*(heights[i]-heights[i-1])/(positions[i]-positions[i-1]));
+            if(!(heights[i-1]<height && height<heights[i+1])) {
+                // linear prediction
+                int j = (sign>0.0) ? i+1 : i-1;
+                height = heights[i] + sign*(heights[j]-heights[i])/(positions[j]-positions[i]);
+            }
+            heights[i] = height;
+            positions[i] += sign;
+        }
+    }
+}
+
+double PVQuantileFilter::Estimator::get() const
+{
+    if(count>=5.0) return heights[2];
+    int n = static_cast<int>(count);
+    if(n==0) return 0.0;
+    double sorted[5];
+    std::copy(heights,heights+n,sorted);
+    std::sort(sorted,sorted+n);
+    int index = static_cast<int>(p*(n-1) + 0.5);
+    return sorted[index];
+}
+
+template<typename T>
+static void addScalar(PVField & master,PVQuantileFilter::EstimatorArray & estimators)
+{
+    double value = static_cast<double>(static_cast<PVScalarValue<T> &>(master).get());
+    for(size_t j=0; j<estimators.size(); ++j) estimators[j].add(value);
+}
+
+template<typename T>
+static void addArray(PVField & master,PVQuantileFilter::EstimatorArray & estimators)
+{
+    typedef PVValueArray<T> PVAT;
+    typename PVAT::const_svector const & values = static_cast<PVAT &>(master).view();
+    for(size_t j=0; j<estimators.size(); ++j) {
+        PVQuantileFilter::Estimator & estimator = estimators[j];
+        for(size_t i=0; i<values.size(); ++i) estimator.add(static_cast<double>(values[i]));
+    }
+}
+
+template<typename T>
+static PVQuantileFilter::AddFunc getAdd(bool isArray)
+{
+    return isArray ? &addArray<T> : &addScalar<T>;
+}
+
+static PVQuantileFilter::AddFunc findAdd(const PVFieldPtr & master)
+{
+    FieldConstPtr field = master->getField();
+    ScalarType scalarType;
+    if(field->getType()==scalar) {
+        scalarType = static_pointer_cast<const Scalar>(field)->getScalarType();
+    } else if(field->getType()==scalarArray) {
+        scalarType = static_pointer_cast<const ScalarArray>(field)->getElementType();
+    } else {
+        return 0;
+    }
+    bool isArray = (field->getType()==scalarArray);
+    switch(scalarType) {
+    case pvByte: return getAdd<int8>(isArray);
+    case pvShort: return getAdd<int16>(isArray);
+    case pvInt: return getAdd<int32>(isArray);
+    case pvLong: return getAdd<int64>(isArray);
+    case pvUByte: return getAdd<uint8>(isArray);
+    case pvUShort: return getAdd<uint16>(isArray);
+    case pvUInt: return getAdd<uint32>(isArray);
+    case pvULong: return getAdd<uint64>(isArray);
+    case pvFloat: return getAdd<float>(isArray);
+    case pvDouble: return getAdd<double>(isArray);
+    default: return 0;
+    }
+}
+
+/*
+ * Parse p1:p2:...
+ */
+static bool parseRequest(const std::string & requestValue,vector<double> & quantiles)
+{
+    quantiles.clear();
+    const char * value = requestValue.c_str();
+    while(true) {
+        char * end = 0;
+        double p = strtod(value,&end);
+        if(end==value || !(p>0.0 && p<1.0)) return false;
+        quantiles.push_back(p);
+        if(quantiles.size()>maxQuantiles) return false;
+        if(*end=='\0') return true;
+        if(*end!=':') return false;
+        value = end + 1;
+    }
+}
+
+PVQuantilePlugin::PVQuantilePlugin()
+{
+}
+
+PVQuantilePlugin::~PVQuantilePlugin()
+{
+}
+
+void PVQuantilePlugin::create()
+{
+     static bool firstTime = true;
+     if(firstTime) {
+         firstTime = false;
+         PVQuantilePluginPtr pvPlugin = PVQuantilePluginPtr(new PVQuantilePlugin());
+         PVPluginRegistry::registerPlugin(name,pvPlugin);
+    }
+}
+
+PVFilterPtr PVQuantilePlugin::create(
+     const std::string & requestValue,
+     const PVCopyPtr & pvCopy,
+     const PVFieldPtr & master)
+{
+    return PVQuantileFilter::create(requestValue,master);
+}
+
+FieldConstPtr PVQuantilePlugin::getCopyField(
+     const std::string & requestValue,
+     const PVFieldPtr & master)
+{
+    vector<double> quantiles;
+    if(!findAdd(master)) return FieldConstPtr();
+    if(!parseRequest(requestValue,quantiles)) return FieldConstPtr();
+    return getFieldCreate()->createScalarArray(pvDouble);
+}
+
+PVQuantileFilter::~PVQuantileFilter()
+{
+}
+
+PVQuantileFilterPtr PVQuantileFilter::create(
+     const std::string & requestValue,
+     const PVFieldPtr & master)
+{
+    AddFunc add = findAdd(master);
+    if(!add) return PVQuantileFilterPtr();
+    vector<double> quantiles;
+    if(!parseRequest(requestValue,quantiles)) return PVQuantileFilterPtr();
+    PVQuantileFilterPtr filter =
+         PVQuantileFilterPtr(
+             new PVQuantileFilter(master,add,quantiles));
+    return filter;
+}
+
+PVQuantileFilter::PVQuantileFilter(
+    const PVFieldPtr & master,
+    AddFunc add,
+    vector<double> const & quantiles)
+: PVFilterV2(master),
+  add(add),
+  estimators(quantiles.size())
+{
+    for(size_t i=0; i<quantiles.size(); ++i) estimators[i].init(quantiles[i]);
+}
+
+bool PVQuantileFilter::filterView(View const & master,View const & copy,PVFilterContext & context,bool toCopy)
+{
+    if(!toCopy) return true;
+    add(*master.field,estimators);
+    PVDoubleArray & copyArray = copy.as<PVDoubleArray>();
+    PVDoubleArray::svector to(copyArray.reuse());
+    to.resize(estimators.size());
+    for(size_t i=0; i<estimators.size(); ++i) to[i] = estimators[i].get();
+    copyArray.replace(freeze(to));
+    context.getBitSet().set(copy.offset);
+    return true;
+}
+
+string PVQuantileFilter::getName()
+{
+	return name;
+}
+
+}}
@@ -0,0 +1,274 @@
+/* pvQuantizePlugin.cpp */
+/*
+ * The License for this software can be found in the file LICENSE that is included with the distribution.
+ */
+
+#include <stdlib.h>
+#include <algorithm>
+
+#include <pv/pvData.h>
+#include <pv/bitSet.h>
+#define epicsExportSharedSymbols
+#include <pv/pvQuantizePlugin.h>
+
+using std::string;
+using std::size_t;
+using std::tr1::static_pointer_cast;
+using namespace epics::pvData;
+
+namespace epics { namespace pvCopy{
+
+typedef PVQuantizeFilter::Quantization Quantization;
+
+static std::string name("quantize");
+
+static void setRange(Quantization & quantization,double lo,double hi)
+{
+    double span = hi - lo;
+    quantization.offset = lo + span/2.0;
+    quantization.scale = (span>0.0) ? span/(2.0*quantization.maxCode) : 1.0;
+}
+
+/*
+ * value is the nearest code to (master - offset)/scale, clipped to [-maxCode,maxCode].
+ * The loops have no branches.
+ */
+template<typename T,typename D>
+static void convertValues(const T * src,size_t length,D * dest,Quantization & quantization)
+{
+    if(quantization.maxCode==0.0) {
+        for(size_t i=0; i<length; ++i) dest[i] = static_cast<D>(src[i]);
+        return;
+    }
+    if(!quantization.fixedRange) {
+        if(length==0) {
+            setRange(quantization,0.0,0.0);
+            return;
+        }
+        T minValue = src[0];
+        T maxValue = src[0];
+        for(size_t i=1; i<length; ++i) {
+            minValue = (src[i]<minValue) ? src[i] : minValue;
+            maxValue = (src[i]>maxValue) ? src[i] : maxValue;
+        }
+        setRange(quantization,static_cast<double>(minValue),static_cast<double>(maxValue));
+    }
+    double offset = quantization.offset;
+    double inverse = 1.0/quantization.scale;
+    double limit = quantization.maxCode;
+    for(size_t i=0; i<length; ++i) {
+        double code = (static_cast<double>(src[i]) - offset)*inverse;
+        code = (code==code) ? code : 0.0;  // NaN
+        code = (code<-limit) ? -limit : code;
+        code = (code>limit) ? limit : code;
+        code += (code>=0.0) ? 0.5 : -0.5;
+        dest[i] = static_cast<D>(code);
+    }
+}
+
+template<typename T,typename D>
+static void quantizeScalar(PVField & master,PVField & value,Quantization & quantization)
+{
+    T from = static_cast<PVScalarValue<T> &>(master).get();
+    D to = 0;
+    convertValues(&from,1,&to,quantization);
+    static_cast<PVScalarValue<D> &>(value).put(to);
+}
+
+template<typename T,typename D>
+static void quantizeArray(PVField & master,PVField & value,Quantization & quantization)
+{
+    typedef PVValueArray<T> PVAT;
+    typedef PVValueArray<D> PVAD;
+    typename PVAT::const_svector const & from = static_cast<PVAT &>(master).view();
+    PVAD & copyArray = static_cast<PVAD &>(value);
+    typename PVAD::svector to(copyArray.reuse());
+    to.resize(from.size());
+    convertValues(from.data(),from.size(),to.data(),quantization);
+    copyArray.replace(freeze(to));
+}
+
+template<typename T>
+static PVQuantizeFilter::QuantizeFunc getQuantize(bool isArray,ScalarType type)
+{
+    switch(type) {
+    case pvFloat: return isArray ? &quantizeArray<T,float> : &quantizeScalar<T,float>;
+    case pvShort: return isArray ? &quantizeArray<T,int16> : &quantizeScalar<T,int16>;
+    case pvByte: return isArray ? &quantizeArray<T,int8> : &quantizeScalar<T,int8>;
+    default: return 0;
+    }
+}
+
+/*
+ * A scalar has the range of its one value, which would always give code 0,
+ * so int16 and int8 require lo:hi for a scalar.
+ */
+static PVQuantizeFilter::QuantizeFunc findQuantize(const PVFieldPtr & master,Quantization const & quantization)
+{
+    FieldConstPtr field = master->getField();
+    ScalarType type = quantization.type;
+    ScalarType scalarType;
+    if(field->getType()==scalar) {
+        if(quantization.maxCode!=0.0 && !quantization.fixedRange) return 0;
+        scalarType = static_pointer_cast<const Scalar>(field)->getScalarType();
+    } else if(field->getType()==scalarArray) {
+        scalarType = static_pointer_cast<const ScalarArray>(field)->getElementType();
+    } else {
+        return 0;
+    }
+    bool isArray = (field->getType()==scalarArray);
+    switch(scalarType) {
+    case pvByte: return getQuantize<int8>(isArray,type);
+    case pvShort: return getQuantize<int16>(isArray,type);
+    case pvInt: return getQuantize<int32>(isArray,type);
+    case pvLong: return getQuantize<int64>(isArray,type);
+    case pvUByte: return getQuantize<uint8>(isArray,type);
+    case pvUShort: return getQuantize<uint16>(isArray,type);
+    case pvUInt: return getQuantize<uint32>(isArray,type);
+    case pvULong: return getQuantize<uint64>(isArray,type);
+    case pvFloat: return getQuantize<float>(isArray,type);
+    case pvDouble: return getQuantize<double>(isArray,type);
+    default: return 0;
+    }
+}
+
+/*
+ * Parse float, int16, int8, int16:lo:hi or int8:lo:hi.
+ */
+static bool parseRequest(const std::string & requestValue,Quantization & quantization)
+{
+    size_t ind = requestValue.find(':');
+    string type = requestValue.substr(0,ind);
+    quantization.fixedRange = false;
+    quantization.lo = 0.0;
+    quantization.hi = 0.0;
+    quantization.scale = 1.0;
+    quantization.offset = 0.0;
+    if(type.compare("float")==0) {
+        quantization.type = pvFloat;
+        quantization.maxCode = 0.0;
+        return ind==string::npos;
+    }
+    if(type.compare("int16")==0) {
+        quantization.type = pvShort;
+        quantization.maxCode = 32767.0;
+    } else if(type.compare("int8")==0) {
+        quantization.type = pvByte;
+        quantization.maxCode = 127.0;
+    } else {
+        return false;
+    }
+    if(ind==string::npos) return true;
+    const char * value = requestValue.c_str() + ind + 1;
+    char * end = 0;
+    quantization.lo = strtod(value,&end);
+    if(end==value || *end!=':') return false;
+    value = end + 1;
+    quantization.hi = strtod(value,&end);
+    if(end==value || *end!='\0') return false;
+    if(!(quantization.hi>quantization.lo)) return false;
+    quantization.fixedRange = true;
+    setRange(quantization,quantization.lo,quantization.hi);
+    return true;
+}
+
+PVQuantizePlugin::PVQuantizePlugin()
+{
+}
+
+PVQuantizePlugin::~PVQuantizePlugin()
+{
+}
+
+void PVQuantizePlugin::create()
+{
+     static bool firstTime = true;
+     if(firstTime) {
+         firstTime = false;
+         PVQuantizePluginPtr pvPlugin = PVQuantizePluginPtr(new PVQuantizePlugin());
+         PVPluginRegistry::registerPlugin(name,pvPlugin);
+    }
+}
+
+PVFilterPtr PVQuantizePlugin::create(
+     const std::string & requestValue,
+     const PVCopyPtr & pvCopy,
+     const PVFieldPtr & master)
+{
+    return PVQuantizeFilter::create(requestValue,master);
+}
+
+FieldConstPtr PVQuantizePlugin::getCopyField(
+     const std::string & requestValue,
+     const PVFieldPtr & master)
+{
+    Quantization quantization;
+    if(!parseRequest(requestValue,quantization)) return FieldConstPtr();
+    if(!findQuantize(master,quantization)) return FieldConstPtr();
+    bool isArray = (master->getField()->getType()==scalarArray);
+    FieldCreatePtr fieldCreate = getFieldCreate();
+    if(quantization.type==pvFloat) {
+        if(isArray) return fieldCreate->createScalarArray(pvFloat);
+        return fieldCreate->createScalar(pvFloat);
+    }
+    FieldBuilderPtr builder = fieldCreate->createFieldBuilder();
+    if(isArray) {
+        builder->addArray("value",quantization.type);
+    } else {
+        builder->add("value",quantization.type);
+    }
+    return builder->
+        add("scale",pvDouble)->
+        add("offset",pvDouble)->
+        createStructure();
+}
+
+PVQuantizeFilter::~PVQuantizeFilter()
+{
+}
+
+PVQuantizeFilterPtr PVQuantizeFilter::create(
+     const std::string & requestValue,
+     const PVFieldPtr & master)
+{
+    Quantization quantization;
+    if(!parseRequest(requestValue,quantization)) return PVQuantizeFilterPtr();
+    QuantizeFunc quantize = findQuantize(master,quantization);
+    if(!quantize) return PVQuantizeFilterPtr();
+    PVQuantizeFilterPtr filter =
+         PVQuantizeFilterPtr(
+             new PVQuantizeFilter(master,quantize,quantization));
+    return filter;
+}
+
+PVQuantizeFilter::PVQuantizeFilter(
+    const PVFieldPtr & master,
+    QuantizeFunc quantize,
+    Quantization const & quantization)
+: master(master),
+  quantize(quantize),
+  quantization(quantization)
+{
+}
+
+bool PVQuantizeFilter::filter(const PVFieldPtr & pvCopy,const BitSetPtr & bitSet,bool toCopy)
+{
+    if(!toCopy) return true;
+    if(quantization.type==pvFloat) {
+        quantize(*master,*pvCopy,quantization);
+    } else {
+        PVFieldPtrArray const & pvFields = static_pointer_cast<PVStructure>(pvCopy)->getPVFields();
+        quantize(*master,*pvFields[0],quantization);
+        static_cast<PVDouble &>(*pvFields[1]).put(quantization.scale);
+        static_cast<PVDouble &>(*pvFields[2]).put(quantization.offset);
+    }
+    bitSet->set(pvCopy->getFieldOffset());
+    return true;
+}
+
+string PVQuantizeFilter::getName()
+{
+	return name;
+}
+
+}}
@@ -0,0 +1,221 @@
+/* pvRoiPlugin.cpp */
+/*
+ * The License for this software can be found in the file LICENSE that is included with the distribution.
+ */
+
+#include <stdlib.h>
+#include <algorithm>
+
+#include <pv/pvData.h>
+#include <pv/bitSet.h>
+#define epicsExportSharedSymbols
+#include <pv/pvRoiPlugin.h>
+
+using std::string;
+using std::size_t;
+using std::vector;
+using std::tr1::static_pointer_cast;
+using namespace epics::pvData;
+
+namespace epics { namespace pvCopy{
+
+typedef PVRoiFilter::Region Region;
+
+static std::string name("roi");
+
+/*
+ * The image is read one row at a time, so each input row is touched once and in order.
+ * The bin rows of an output row are summed into rowSums, first along the row
+ * and then across the bin columns of each output pixel.
+ * The inner loops run along a row.
+ */
+template<typename T>
+static void binRegion(
+    PVScalarArray & master,
+    PVScalarArray & copy,
+    Region const & region,
+    vector<double> & rowSums)
+{
+    typedef PVValueArray<T> PVAT;
+    typename PVAT::const_svector const & from = static_cast<PVAT &>(master).view();
+    PVAT & pvTo = static_cast<PVAT &>(copy);
+    size_t width = region.width;
+    size_t height = (width>0) ? std::min(region.height,from.size()/width) : 0;
+    size_t x = std::min(region.x,width);
+    size_t y = std::min(region.y,height);
+    size_t w = std::min(region.w,width - x);
+    size_t h = std::min(region.h,height - y);
+    size_t bin = region.bin;
+    size_t outWidth = w/bin;
+    size_t outHeight = h/bin;
+    typename PVAT::svector to(pvTo.reuse());
+    to.resize(outWidth*outHeight);
+    const T * src = from.data();
+    T * dest = to.data();
+    if(bin==1) {
+        for(size_t row=0; row<outHeight; ++row) {
+            std::copy(src + (y + row)*width + x,src + (y + row)*width + x + outWidth,dest + row*outWidth);
+        }
+        pvTo.replace(freeze(to));
+        return;
+    }
+    size_t inWidth = outWidth*bin;
+    rowSums.resize(inWidth);
+    double * sums = inWidth>0 ? &rowSums[0] : 0;
+    double scale = 1.0/(bin*bin);
+    for(size_t row=0; row<outHeight; ++row) {
+        std::fill(rowSums.begin(),rowSums.end(),0.0);
+        for(size_t k=0; k<bin; ++k) {
+            const T * line = src + (y + row*bin + k)*width + x;
+            for(size_t i=0; i<inWidth; ++i) sums[i] += static_cast<double>(line[i]);
+        }
+        T * out = dest + row*outWidth;
+        for(size_t col=0; col<outWidth; ++col) {
+            double sum = 0.0;
+            const double * block = sums + col*bin;
+            for(size_t k=0; k<bin; ++k) sum += block[k];
+            out[col] = static_cast<T>(sum*scale);
+        }
+    }
+    pvTo.replace(freeze(to));
+}
+
+static PVRoiFilter::RoiFunc findRoi(const PVFieldPtr & master)
+{
+    FieldConstPtr field = master->getField();
+    if(field->getType()!=scalarArray) return 0;
+    ScalarType scalarType = static_pointer_cast<const ScalarArray>(field)->getElementType();
+    switch(scalarType) {
+    case pvByte: return &binRegion<int8>;
+    case pvShort: return &binRegion<int16>;
+    case pvInt: return &binRegion<int32>;
+    case pvLong: return &binRegion<int64>;
+    case pvUByte: return &binRegion<uint8>;
+    case pvUShort: return &binRegion<uint16>;
+    case pvUInt: return &binRegion<uint32>;
+    case pvULong: return &binRegion<uint64>;
+    case pvFloat: return &binRegion<float>;
+    case pvDouble: return &binRegion<double>;
+    default: return 0;
+    }
+}
+
+static PVScalarPtr findShape(const PVFieldPtr & master,const string & fieldName)
+{
+    PVStructure * parent = master->getParent();
+    if(!parent) return PVScalarPtr();
+    PVScalarPtr pvScalar = parent->getSubField<PVScalar>(fieldName);
+    if(!pvScalar) return PVScalarPtr();
+    ScalarType scalarType = pvScalar->getScalar()->getScalarType();
+    if(scalarType==pvBoolean || scalarType==pvString) return PVScalarPtr();
+    return pvScalar;
+}
+
+/*
+ * Parse x:y:w:h or x:y:w:h:bin.
+ */
+static bool parseRequest(const std::string & requestValue,Region & region)
+{
+    long values[5] = {0,0,0,0,1};
+    const char * value = requestValue.c_str();
+    size_t nvalues = 0;
+    bool complete = false;
+    while(!complete && nvalues<5) {
+        char * end = 0;
+        values[nvalues] = strtol(value,&end,10);
+        if(end==value || values[nvalues]<0) return false;
+        ++nvalues;
+        complete = (*end=='\0');
+        if(!complete && *end!=':') return false;
+        value = end + 1;
+    }
+    if(!complete || nvalues<4 || values[4]<1) return false;
+    region.x = values[0];
+    region.y = values[1];
+    region.w = values[2];
+    region.h = values[3];
+    region.bin = values[4];
+    region.width = 0;
+    region.height = 0;
+    return true;
+}
+
+PVRoiPlugin::PVRoiPlugin()
+{
+}
+
+PVRoiPlugin::~PVRoiPlugin()
+{
+}
+
+void PVRoiPlugin::create()
+{
+     static bool firstTime = true;
+     if(firstTime) {
+         firstTime = false;
+         PVRoiPluginPtr pvPlugin = PVRoiPluginPtr(new PVRoiPlugin());
+         PVPluginRegistry::registerPlugin(name,pvPlugin);
+    }
+}
+
+PVFilterPtr PVRoiPlugin::create(
+     const std::string & requestValue,
+     const PVCopyPtr & pvCopy,
+     const PVFieldPtr & master)
+{
+    return PVRoiFilter::create(requestValue,master);
+}
+
+PVRoiFilter::~PVRoiFilter()
+{
+}
+
+PVRoiFilterPtr PVRoiFilter::create(
+     const std::string & requestValue,
+     const PVFieldPtr & master)
+{
+    RoiFunc roi = findRoi(master);
+    if(!roi) return PVRoiFilterPtr();
+    PVScalarPtr pvWidth = findShape(master,"width");
+    PVScalarPtr pvHeight = findShape(master,"height");
+    if(!pvWidth || !pvHeight) return PVRoiFilterPtr();
+    Region region;
+    if(!parseRequest(requestValue,region)) return PVRoiFilterPtr();
+    PVRoiFilterPtr filter =
+         PVRoiFilterPtr(
+             new PVRoiFilter(static_pointer_cast<PVScalarArray>(master),pvWidth,pvHeight,roi,region));
+    return filter;
+}
+
+PVRoiFilter::PVRoiFilter(
+    const PVScalarArrayPtr & master,
+    const PVScalarPtr & pvWidth,
+    const PVScalarPtr & pvHeight,
+    RoiFunc roi,
+    Region const & region)
+: master(master),
+  pvWidth(pvWidth),
+  pvHeight(pvHeight),
+  roi(roi),
+  region(region)
+{
+}
+
+bool PVRoiFilter::filter(const PVFieldPtr & pvCopy,const BitSetPtr & bitSet,bool toCopy)
+{
+    if(!toCopy) return true;
+    double width = pvWidth->getAs<double>();
+    double height = pvHeight->getAs<double>();
+    region.width = (width>0.0) ? static_cast<size_t>(width) : 0;
+    region.height = (height>0.0) ? static_cast<size_t>(height) : 0;
+    roi(*master,*static_pointer_cast<PVScalarArray>(pvCopy),region,rowSums);
+    bitSet->set(pvCopy->getFieldOffset());
+    return true;
+}
+
+string PVRoiFilter::getName()
+{
+	return name;
+}
+
+}}
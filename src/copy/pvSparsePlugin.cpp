@@ -0,0 +1,217 @@
+/* pvSparsePlugin.cpp */
+/*
+ * The License for this software can be found in the file LICENSE that is included with the distribution.
+ */
+
+#include <stdlib.h>
+
+#include <pv/pvData.h>
+#include <pv/bitSet.h>
+#define epicsExportSharedSymbols
+#include <pv/pvSparsePlugin.h>
+
+using std::string;
+using std::size_t;
+using std::tr1::static_pointer_cast;
+using namespace epics::pvData;
+
+namespace epics { namespace pvCopy{
+
+static std::string name("sparse");
+
+/*
+ * The changed elements are counted first, by a loop without branches.
+ * Only a sparse update collects them.
+ * If merge is true, the index of copy is a change that was not delivered,
+ * so its positions are delivered again, with the new values.
+ */
+template<typename T>
+static bool diffArray(
+    PVScalarArray & master,
+    PVScalarArray & last,
+    PVStructure & copy,
+    double density,
+    bool full,
+    bool merge)
+{
+    typedef PVValueArray<T> PVAT;
+    PVAT & pvLast = static_cast<PVAT &>(last);
+    typename PVAT::const_svector from(static_cast<PVAT &>(master).view());
+    typename PVAT::const_svector previous(pvLast.view());
+    PVFieldPtrArray const & pvFields = copy.getPVFields();
+    PVAT & pvFull = static_cast<PVAT &>(*pvFields[0]);
+    PVIntArray & pvIndex = static_cast<PVIntArray &>(*pvFields[1]);
+    PVAT & pvValue = static_cast<PVAT &>(*pvFields[2]);
+    size_t length = from.size();
+    size_t maxChanged = static_cast<size_t>(density*length);
+    if(!full && previous.size()!=length) full = true;
+    if(!full && merge && pvFull.getLength()>0) full = true;
+    size_t nchanged = 0;
+    if(!full && from.data()!=previous.data()) {
+        const T * src = from.data();
+        const T * old = previous.data();
+        for(size_t i=0; i<length; ++i) nchanged += (src[i]!=old[i]) ? 1 : 0;
+    }
+    if(!full && nchanged==0) return merge;
+    PVIntArray::const_svector pending;
+    if(merge) pending = pvIndex.view();
+    if(!full) {
+        const T * src = from.data();
+        const T * old = previous.data();
+        for(size_t k=0; k<pending.size(); ++k) {
+            size_t i = pending[k];
+            nchanged += (src[i]==old[i]) ? 1 : 0;
+        }
+        if(nchanged>maxChanged) full = true;
+    }
+    pvLast.replace(from);
+    if(full) {
+        pvFull.replace(from);
+        pvIndex.replace(PVIntArray::const_svector());
+        pvValue.replace(typename PVAT::const_svector());
+        return true;
+    }
+    PVIntArray::svector index(nchanged);
+    typename PVAT::svector values(pvValue.reuse());
+    values.resize(nchanged);
+    const T * src = from.data();
+    const T * old = previous.data();
+    for(size_t i=0, j=0, k=0; j<nchanged; ++i) {
+        bool isPending = k<pending.size() && static_cast<size_t>(pending[k])==i;
+        if(isPending) ++k;
+        if(!isPending && src[i]==old[i]) continue;
+        index[j] = static_cast<int32>(i);
+        values[j] = src[i];
+        ++j;
+    }
+    pvFull.replace(typename PVAT::const_svector());
+    pvIndex.replace(freeze(index));
+    pvValue.replace(freeze(values));
+    return true;
+}
+
+static PVSparseFilter::DiffFunc findDiff(const PVFieldPtr & master)
+{
+    FieldConstPtr field = master->getField();
+    if(field->getType()!=scalarArray) return 0;
+    ScalarType scalarType = static_pointer_cast<const ScalarArray>(field)->getElementType();
+    switch(scalarType) {
+    case pvByte: return &diffArray<int8>;
+    case pvShort: return &diffArray<int16>;
+    case pvInt: return &diffArray<int32>;
+    case pvLong: return &diffArray<int64>;
+    case pvUByte: return &diffArray<uint8>;
+    case pvUShort: return &diffArray<uint16>;
+    case pvUInt: return &diffArray<uint32>;
+    case pvULong: return &diffArray<uint64>;
+    case pvFloat: return &diffArray<float>;
+    case pvDouble: return &diffArray<double>;
+    default: return 0;
+    }
+}
+
+static bool parseRequest(const std::string & requestValue,double & density)
+{
+    const char * value = requestValue.c_str();
+    char * end = 0;
+    density = strtod(value,&end);
+    if(end==value || *end!='\0') return false;
+    return density>=0.0 && density<=1.0;
+}
+
+PVSparsePlugin::PVSparsePlugin()
+{
+}
+
+PVSparsePlugin::~PVSparsePlugin()
+{
+}
+
+void PVSparsePlugin::create()
+{
+     static bool firstTime = true;
+     if(firstTime) {
+         firstTime = false;
+         PVSparsePluginPtr pvPlugin = PVSparsePluginPtr(new PVSparsePlugin());
+         PVPluginRegistry::registerPlugin(name,pvPlugin);
+    }
+}
+
+PVFilterPtr PVSparsePlugin::create(
+     const std::string & requestValue,
+     const PVCopyPtr & pvCopy,
+     const PVFieldPtr & master)
+{
+    return PVSparseFilter::create(requestValue,master);
+}
+
+FieldConstPtr PVSparsePlugin::getCopyField(
+     const std::string & requestValue,
+     const PVFieldPtr & master)
+{
+    double density = 0.0;
+    if(!findDiff(master)) return FieldConstPtr();
+    if(!parseRequest(requestValue,density)) return FieldConstPtr();
+    ScalarType elementType = static_pointer_cast<const ScalarArray>(master->getField())->getElementType();
+    return getFieldCreate()->createFieldBuilder()->
+        addArray("full",elementType)->
+        addArray("index",pvInt)->
+        addArray("value",elementType)->
+        createStructure();
+}
+
+PVSparseFilter::~PVSparseFilter()
+{
+}
+
+PVSparseFilterPtr PVSparseFilter::create(
+     const std::string & requestValue,
+     const PVFieldPtr & master)
+{
+    DiffFunc diff = findDiff(master);
+    if(!diff) return PVSparseFilterPtr();
+    double density = 0.0;
+    if(!parseRequest(requestValue,density)) return PVSparseFilterPtr();
+    PVSparseFilterPtr filter =
+         PVSparseFilterPtr(
+             new PVSparseFilter(static_pointer_cast<PVScalarArray>(master),diff,density));
+    return filter;
+}
+
+PVSparseFilter::PVSparseFilter(
+    const PVScalarArrayPtr & master,
+    DiffFunc diff,
+    double density)
+: master(master),
+  last(getPVDataCreate()->createPVScalarArray(
+      master->getScalarArray()->getElementType())),
+  diff(diff),
+  density(density),
+  firstTime(true),
+  lastCopy(0)
+{
+}
+
+bool PVSparseFilter::filter(const PVFieldPtr & pvCopy,const BitSetPtr & bitSet,bool toCopy)
+{
+    if(!toCopy) return true;
+    // a monitor refills an element that was not released, with its bit still set
+    bool merge = !firstTime && pvCopy.get()==lastCopy && bitSet->get(pvCopy->getFieldOffset());
+    bool report = diff(*master,*last,*static_pointer_cast<PVStructure>(pvCopy),density,firstTime,merge);
+    firstTime = false;
+    if(report) {
+        bitSet->set(pvCopy->getFieldOffset());
+        lastCopy = pvCopy.get();
+    } else {
+        bitSet->clear(pvCopy->getFieldOffset());
+        lastCopy = 0;
+    }
+    return true;
+}
+
+string PVSparseFilter::getName()
+{
+	return name;
+}
+
+}}
@@ -0,0 +1,436 @@
+/* pvSpectrumPlugin.cpp */
+/*
+ * The License for this software can be found in the file LICENSE that is included with the distribution.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+
+#include <pv/pvData.h>
+#include <pv/bitSet.h>
+#define epicsExportSharedSymbols
+#include <pv/pvSpectrumPlugin.h>
+
+using std::string;
+using std::size_t;
+using std::vector;
+using std::tr1::static_pointer_cast;
+using namespace epics::pvData;
+
+namespace epics { namespace pvCopy{
+
+typedef PVSpectrumFilter::Complex Complex;
+
+static std::string name("spectrum");
+
+static const double twoPi = 6.283185307179586476925286766559;
+
+// a length with a larger prime factor is transformed by the chirp z-transform
+static const size_t maxGenericFactor = 64;
+
+/*
+ * Factors of 4 first, then 2, then odd factors.
+ * Each radix is followed by the length that remains after it.
+ */
+static void factorize(size_t n,vector<size_t> & factors)
+{
+    factors.clear();
+    size_t p = 4;
+    while(n>1) {
+        while(n%p!=0) {
+            switch(p) {
+            case 4: p = 2; break;
+            case 2: p = 3; break;
+            default: p += 2; break;
+            }
+            if(p*p>n) p = n;
+        }
+        n /= p;
+        factors.push_back(p);
+        factors.push_back(n);
+    }
+}
+
+static void butterfly2(Complex * out,size_t fstride,const Complex * twiddles,size_t m)
+{
+    Complex * out2 = out + m;
+    for(size_t k=0; k<m; ++k) {
+        Complex t = out2[k]*twiddles[k*fstride];
+        out2[k] = out[k] - t;
+        out[k] += t;
+    }
+}
+
+static void butterfly4(Complex * out,size_t fstride,const Complex * twiddles,size_t m)
+{
+    for(size_t k=0; k<m; ++k) {
+        Complex s0 = out[k+m]*twiddles[k*fstride];
+        Complex s1 = out[k+2*m]*twiddles[2*k*fstride];
+        Complex s2 = out[k+3*m]*twiddles[3*k*fstride];
+        Complex s5 = out[k] - s1;
+        out[k] += s1;
+        Complex s3 = s0 + s2;
+        Complex s4 = s0 - s2;
+        out[k+2*m] = out[k] - s3;
+        out[k] += s3;
+        out[k+m] = Complex(s5.real() + s4.imag(),s5.imag() - s4.real());
+        out[k+3*m] = Complex(s5.real() - s4.imag(),s5.imag() + s4.real());
+    }
+}
+
+static void butterflyGeneric(
+    Complex * out,
+    size_t fstride,
+    const Complex * twiddles,
+    size_t nfft,
+    size_t m,
+    size_t p,
+    Complex * scratch)
+{
+    for(size_t u=0; u<m; ++u) {
+        for(size_t q=0, k=u; q<p; ++q, k+=m) scratch[q] = out[k];
+        for(size_t q1=0, k=u; q1<p; ++q1, k+=m) {
+            size_t index = 0;
+            Complex sum = scratch[0];
+            for(size_t q=1; q<p; ++q) {
+                index += fstride*k;
+                if(index>=nfft) index %= nfft;
+                sum += scratch[q]*twiddles[index];
+            }
+            out[k] = sum;
+        }
+    }
+}
+
+/*
+ * Decimation in time. The input is read with stride fstride,
+ * the sub transforms are done first and then combined by the butterflies.
+ */
+static void fft(
+    Complex * out,
+    const Complex * in,
+    size_t fstride,
+    const size_t * factors,
+    const Complex * twiddles,
+    size_t nfft,
+    Complex * scratch)
+{
+    size_t p = factors[0];
+    size_t m = factors[1];
+    Complex * begin = out;
+    Complex * end = out + p*m;
+    if(m==1) {
+        for(; out!=end; ++out, in+=fstride) *out = *in;
+    } else {
+        for(; out!=end; out+=m, in+=fstride) {
+            fft(out,in,fstride*p,factors+2,twiddles,nfft,scratch);
+        }
+    }
+    out = begin;
+    switch(p) {
+    case 2: butterfly2(out,fstride,twiddles,m); break;
+    case 4: butterfly4(out,fstride,twiddles,m); break;
+    default: butterflyGeneric(out,fstride,twiddles,nfft,m,p,scratch); break;
+    }
+}
+
+/*
+ * The chirp z-transform of Bluestein.
+ * The transform of length nfft is a convolution with the chirp,
+ * which is done by FFTs of the power of two length nchirp.
+ * The inverse FFT is the conjugate of the FFT of the conjugate.
+ */
+static void chirpTransform(PVSpectrumFilter::Plan & plan)
+{
+    size_t nfft = plan.nfft;
+    size_t nchirp = plan.nchirp;
+    const Complex * input = &plan.input[0];
+    Complex * output = &plan.output[0];
+    const Complex * chirp = &plan.chirp[0];
+    const Complex * filter = &plan.chirpFilter[0];
+    const Complex * twiddles = &plan.chirpTwiddles[0];
+    const size_t * factors = &plan.chirpFactors[0];
+    Complex * a = &plan.chirpInput[0];
+    Complex * b = &plan.chirpOutput[0];
+    for(size_t k=0; k<nfft; ++k) a[k] = input[k]*chirp[k];
+    for(size_t k=nfft; k<nchirp; ++k) a[k] = Complex(0.0,0.0);
+    fft(b,a,1,factors,twiddles,nchirp,0);
+    for(size_t k=0; k<nchirp; ++k) a[k] = std::conj(b[k]*filter[k]);
+    fft(b,a,1,factors,twiddles,nchirp,0);
+    for(size_t k=0; k<nfft; ++k) output[k] = std::conj(b[k])*chirp[k];
+}
+
+template<typename T>
+static void loadArray(PVField & master,vector<double> & samples)
+{
+    typedef PVValueArray<T> PVAT;
+    typename PVAT::const_svector const & values = static_cast<PVAT &>(master).view();
+    size_t length = values.size();
+    samples.resize(length);
+    const T * src = values.data();
+    double * dest = length>0 ? &samples[0] : 0;
+    for(size_t i=0; i<length; ++i) dest[i] = static_cast<double>(src[i]);
+}
+
+static PVSpectrumFilter::LoadFunc findLoad(const PVFieldPtr & master)
+{
+    FieldConstPtr field = master->getField();
+    if(field->getType()!=scalarArray) return 0;
+    ScalarType scalarType = static_pointer_cast<const ScalarArray>(field)->getElementType();
+    switch(scalarType) {
+    case pvByte: return &loadArray<int8>;
+    case pvShort: return &loadArray<int16>;
+    case pvInt: return &loadArray<int32>;
+    case pvLong: return &loadArray<int64>;
+    case pvUByte: return &loadArray<uint8>;
+    case pvUShort: return &loadArray<uint16>;
+    case pvUInt: return &loadArray<uint32>;
+    case pvULong: return &loadArray<uint64>;
+    case pvFloat: return &loadArray<float>;
+    case pvDouble: return &loadArray<double>;
+    default: return 0;
+    }
+}
+
+/*
+ * Parse type or type:window.
+ */
+static bool parseRequest(
+    const std::string & requestValue,
+    bool & power,
+    PVSpectrumFilter::Window & window)
+{
+    size_t ind = requestValue.find(':');
+    string type = requestValue.substr(0,ind);
+    if(type.compare("power")==0) {
+        power = true;
+    } else if(type.compare("magnitude")==0) {
+        power = false;
+    } else {
+        return false;
+    }
+    window = PVSpectrumFilter::none;
+    if(ind==string::npos) return true;
+    string windowName = requestValue.substr(ind+1);
+    if(windowName.compare("hann")==0) {
+        window = PVSpectrumFilter::hann;
+    } else if(windowName.compare("hamming")==0) {
+        window = PVSpectrumFilter::hamming;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+PVSpectrumPlugin::PVSpectrumPlugin()
+{
+}
+
+PVSpectrumPlugin::~PVSpectrumPlugin()
+{
+}
+
+void PVSpectrumPlugin::create()
+{
+     static bool firstTime = true;
+     if(firstTime) {
+         firstTime = false;
+         PVSpectrumPluginPtr pvPlugin = PVSpectrumPluginPtr(new PVSpectrumPlugin());
+         PVPluginRegistry::registerPlugin(name,pvPlugin);
+    }
+}
+
+PVFilterPtr PVSpectrumPlugin::create(
+     const std::string & requestValue,
+     const PVCopyPtr & pvCopy,
+     const PVFieldPtr & master)
+{
+    return PVSpectrumFilter::create(requestValue,master);
+}
+
+FieldConstPtr PVSpectrumPlugin::getCopyField(
+     const std::string & requestValue,
+     const PVFieldPtr & master)
+{
+    bool power = false;
+    PVSpectrumFilter::Window window = PVSpectrumFilter::none;
+    if(!findLoad(master)) return FieldConstPtr();
+    if(!parseRequest(requestValue,power,window)) return FieldConstPtr();
+    return getFieldCreate()->createScalarArray(pvDouble);
+}
+
+PVSpectrumFilter::~PVSpectrumFilter()
+{
+}
+
+PVSpectrumFilterPtr PVSpectrumFilter::create(
+     const std::string & requestValue,
+     const PVFieldPtr & master)
+{
+    LoadFunc load = findLoad(master);
+    if(!load) return PVSpectrumFilterPtr();
+    bool power = false;
+    Window window = none;
+    if(!parseRequest(requestValue,power,window)) return PVSpectrumFilterPtr();
+    PVSpectrumFilterPtr filter =
+         PVSpectrumFilterPtr(
+             new PVSpectrumFilter(master,load,power,window,
+                 PVSharedResult::find(master,name,requestValue)));
+    return filter;
+}
+
+PVSpectrumFilter::PVSpectrumFilter(
+    const PVFieldPtr & master,
+    LoadFunc load,
+    bool power,
+    Window window,
+    const PVSharedResultPtr & sharedResult)
+: PVFilterV2(master),
+  load(load),
+  power(power),
+  window(window),
+  sharedResult(sharedResult)
+{
+    makePlan(0);
+}
+
+/*
+ * The chirp is exp(-pi*i*k*k/nfft). k*k is reduced modulo 2*nfft,
+ * so that the phase stays accurate for a long array.
+ * The filter is the FFT of the conjugate chirp, divided by nchirp for the inverse FFT.
+ */
+static void makeChirp(PVSpectrumFilter::Plan & plan)
+{
+    size_t nfft = plan.nfft;
+    size_t nchirp = plan.nchirp;
+    factorize(nchirp,plan.chirpFactors);
+    plan.chirpTwiddles.resize(nchirp);
+    for(size_t k=0; k<nchirp; ++k) {
+        double phase = -twoPi*k/nchirp;
+        plan.chirpTwiddles[k] = Complex(cos(phase),sin(phase));
+    }
+    plan.chirp.resize(nchirp>0 ? nfft : 0);
+    for(size_t k=0; k<plan.chirp.size(); ++k) {
+        uint64 kk = (static_cast<uint64>(k)*k) % (2*static_cast<uint64>(nfft));
+        double phase = -0.5*twoPi*static_cast<double>(kk)/nfft;
+        plan.chirp[k] = Complex(cos(phase),sin(phase));
+    }
+    plan.chirpInput.resize(nchirp);
+    plan.chirpOutput.resize(nchirp);
+    plan.chirpFilter.resize(nchirp);
+    if(nchirp==0) return;
+    Complex * b = &plan.chirpInput[0];
+    for(size_t k=0; k<nchirp; ++k) b[k] = Complex(0.0,0.0);
+    b[0] = std::conj(plan.chirp[0]);
+    for(size_t k=1; k<nfft; ++k) {
+        b[k] = std::conj(plan.chirp[k]);
+        b[nchirp-k] = b[k];
+    }
+    fft(&plan.chirpFilter[0],b,1,&plan.chirpFactors[0],&plan.chirpTwiddles[0],nchirp,0);
+    for(size_t k=0; k<nchirp; ++k) plan.chirpFilter[k] /= static_cast<double>(nchirp);
+}
+
+void PVSpectrumFilter::makePlan(size_t length)
+{
+    bool even = (length>=2) && (length%2==0);
+    plan.length = length;
+    plan.nfft = even ? length/2 : length;
+    factorize(plan.nfft,plan.factors);
+    size_t maxFactor = 0;
+    for(size_t i=0; i<plan.factors.size(); i+=2) maxFactor = std::max(maxFactor,plan.factors[i]);
+    // the generic butterfly costs p*p for a factor p, so a large factor uses the chirp z-transform
+    plan.nchirp = 0;
+    if(maxFactor>maxGenericFactor) {
+        plan.nchirp = 1;
+        while(plan.nchirp<2*plan.nfft-1) plan.nchirp *= 2;
+        maxFactor = 0;
+    }
+    plan.twiddles.resize(plan.nchirp==0 ? plan.nfft : 0);
+    for(size_t k=0; k<plan.twiddles.size(); ++k) {
+        double phase = -twoPi*k/plan.nfft;
+        plan.twiddles[k] = Complex(cos(phase),sin(phase));
+    }
+    makeChirp(plan);
+    plan.realTwiddles.resize(even ? plan.nfft+1 : 0);
+    for(size_t k=0; k<plan.realTwiddles.size(); ++k) {
+        double phase = -twoPi*k/length;
+        plan.realTwiddles[k] = Complex(cos(phase),sin(phase));
+    }
+    plan.window.resize(length);
+    for(size_t i=0; i<length; ++i) {
+        double c = cos(twoPi*i/length);
+        switch(window) {
+        case hann: plan.window[i] = 0.5 - 0.5*c; break;
+        case hamming: plan.window[i] = 0.54 - 0.46*c; break;
+        default: plan.window[i] = 1.0; break;
+        }
+    }
+    plan.input.resize(plan.nfft);
+    plan.output.resize(plan.nfft);
+    plan.scratch.resize(maxFactor);
+}
+
+bool PVSpectrumFilter::filterView(View const & master,View const & copy,PVFilterContext & context,bool toCopy)
+{
+    if(!toCopy) return true;
+    if(sharedResult->getResult(*master.field,*copy.field)) {
+        context.getBitSet().set(copy.offset);
+        return true;
+    }
+    load(*master.field,plan.samples);
+    size_t length = plan.samples.size();
+    if(length!=plan.length) makePlan(length);
+    PVDoubleArray & copyArray = copy.as<PVDoubleArray>();
+    PVDoubleArray::svector to(copyArray.reuse());
+    to.resize((length>0) ? length/2 + 1 : 0);
+    if(length>0) {
+        size_t nfft = plan.nfft;
+        const double * samples = &plan.samples[0];
+        const double * weights = &plan.window[0];
+        Complex * input = &plan.input[0];
+        Complex * output = &plan.output[0];
+        bool even = !plan.realTwiddles.empty();
+        // an even length is packed as nfft complex values
+        if(even) {
+            for(size_t k=0; k<nfft; ++k) {
+                input[k] = Complex(samples[2*k]*weights[2*k],samples[2*k+1]*weights[2*k+1]);
+            }
+        } else {
+            for(size_t k=0; k<nfft; ++k) input[k] = Complex(samples[k]*weights[k],0.0);
+        }
+        if(nfft==1) {
+            output[0] = input[0];
+        } else if(plan.nchirp>0) {
+            chirpTransform(plan);
+        } else {
+            fft(output,input,1,&plan.factors[0],&plan.twiddles[0],nfft,
+                plan.scratch.empty() ? 0 : &plan.scratch[0]);
+        }
+        for(size_t k=0; k<to.size(); ++k) {
+            Complex value;
+            if(even) {
+                Complex z = output[k%nfft];
+                Complex zc = std::conj(output[(nfft-k)%nfft]);
+                Complex evenPart = (z + zc)*0.5;
+                Complex oddPart = (z - zc)*Complex(0.0,-0.5);
+                value = evenPart + plan.realTwiddles[k]*oddPart;
+            } else {
+                value = output[k];
+            }
+            double norm = std::norm(value);
+            to[k] = power ? norm : sqrt(norm);
+        }
+    }
+    copyArray.replace(freeze(to));
+    sharedResult->putResult(*master.field,copyArray);
+    context.getBitSet().set(copy.offset);
+    return true;
+}
+
+string PVSpectrumFilter::getName()
+{
+	return name;
+}
+
+}}
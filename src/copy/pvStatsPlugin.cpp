@@ -0,0 +1,276 @@
+/* pvStatsPlugin.cpp */
+/*
+ * The License for this software can be found in the file LICENSE that is included with the distribution.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <limits>
+
+#include <epicsTime.h>
+#include <pv/pvData.h>
+#include <pv/bitSet.h>
+#define epicsExportSharedSymbols
+#include <pv/pvStatsPlugin.h>
+
+using std::string;
+using std::size_t;
+using std::tr1::static_pointer_cast;
+using namespace epics::pvData;
+
+namespace epics { namespace pvCopy{
+
+static std::string name("stats");
+
+void PVStatsFilter::Accumulator::reset()
+{
+    count = 0;
+    sum = 0.0;
+    sumSquares = 0.0;
+    min = std::numeric_limits<double>::infinity();
+    max = -std::numeric_limits<double>::infinity();
+}
+
+template<typename T>
+static void accumulateScalar(PVField & master,PVStatsFilter::Accumulator & accumulator)
+{
+    double value = static_cast<double>(static_cast<PVScalarValue<T> &>(master).get());
+    accumulator.count += 1;
+    accumulator.sum += value;
+    accumulator.sumSquares += value*value;
+    if(value<accumulator.min) accumulator.min = value;
+    if(value>accumulator.max) accumulator.max = value;
+}
+
+/*
+ * min and max are found in the type of the array.
+ * The sums use four independent partial sums,
+ * so that the loop is not one long chain of dependent additions.
+ */
+template<typename T>
+static void accumulateArray(PVField & master,PVStatsFilter::Accumulator & accumulator)
+{
+    typedef PVValueArray<T> PVAT;
+    typename PVAT::const_svector const & values = static_cast<PVAT &>(master).view();
+    size_t length = values.size();
+    if(length==0) return;
+    const T * src = values.data();
+    T minValue = src[0];
+    T maxValue = src[0];
+    for(size_t i=1; i<length; ++i) {
+        minValue = (src[i]<minValue) ? src[i] : minValue;
+        maxValue = (src[i]>maxValue) ? src[i] : maxValue;
+    }
+    double sum[4] = {0.0,0.0,0.0,0.0};
+    double sumSquares[4] = {0.0,0.0,0.0,0.0};
+    size_t i = 0;
+    for(; i+4<=length; i+=4) {
+        for(size_t k=0; k<4; ++k) {
+            double value = static_cast<double>(src[i+k]);
+            sum[k] += value;
+            sumSquares[k] += value*value;
+        }
+    }
+    for(; i<length; ++i) {
+        double value = static_cast<double>(src[i]);
+        sum[0] += value;
+        sumSquares[0] += value*value;
+    }
+    accumulator.count += length;
+    accumulator.sum += (sum[0] + sum[1]) + (sum[2] + sum[3]);
+    accumulator.sumSquares += (sumSquares[0] + sumSquares[1]) + (sumSquares[2] + sumSquares[3]);
+    accumulator.min = std::min(accumulator.min,static_cast<double>(minValue));
+    accumulator.max = std::max(accumulator.max,static_cast<double>(maxValue));
+}
+
+template<typename T>
+static PVStatsFilter::AccumulateFunc getAccumulate(bool isArray)
+{
+    return isArray ? &accumulateArray<T> : &accumulateScalar<T>;
+}
+
+static PVStatsFilter::AccumulateFunc findAccumulate(const PVFieldPtr & master)
+{
+    FieldConstPtr field = master->getField();
+    ScalarType scalarType;
+    if(field->getType()==scalar) {
+        scalarType = static_pointer_cast<const Scalar>(field)->getScalarType();
+    } else if(field->getType()==scalarArray) {
+        scalarType = static_pointer_cast<const ScalarArray>(field)->getElementType();
+    } else {
+        return 0;
+    }
+    bool isArray = (field->getType()==scalarArray);
+    switch(scalarType) {
+    case pvByte: return getAccumulate<int8>(isArray);
+    case pvShort: return getAccumulate<int16>(isArray);
+    case pvInt: return getAccumulate<int32>(isArray);
+    case pvLong: return getAccumulate<int64>(isArray);
+    case pvUByte: return getAccumulate<uint8>(isArray);
+    case pvUShort: return getAccumulate<uint16>(isArray);
+    case pvUInt: return getAccumulate<uint32>(isArray);
+    case pvULong: return getAccumulate<uint64>(isArray);
+    case pvFloat: return getAccumulate<float>(isArray);
+    case pvDouble: return getAccumulate<double>(isArray);
+    default: return 0;
+    }
+}
+
+// longest window that can be given with seconds:T
+static const double maxWindowSeconds = 1e9;
+
+/*
+ * Parse samples:N or seconds:T.
+ */
+static bool parseRequest(
+    const std::string & requestValue,
+    size_t & windowUpdates,
+    uint64 & windowNanoseconds)
+{
+    size_t ind = requestValue.find(':');
+    if(ind==string::npos) return false;
+    string type = requestValue.substr(0,ind);
+    const char * value = requestValue.c_str() + ind + 1;
+    windowUpdates = 0;
+    windowNanoseconds = 0;
+    if(type.compare("samples")==0) {
+        char * end = 0;
+        long samples = strtol(value,&end,10);
+        if(end==value || *end!='\0' || samples<1) return false;
+        windowUpdates = samples;
+        return true;
+    }
+    if(type.compare("seconds")==0) {
+        char * end = 0;
+        double seconds = strtod(value,&end);
+        if(end==value || *end!='\0') return false;
+        // also rejects NaN
+        if(!(seconds>0.0 && seconds<=maxWindowSeconds)) return false;
+        windowNanoseconds = static_cast<uint64>(seconds*1e9);
+        return true;
+    }
+    return false;
+}
+
+PVStatsPlugin::PVStatsPlugin()
+{
+}
+
+PVStatsPlugin::~PVStatsPlugin()
+{
+}
+
+void PVStatsPlugin::create()
+{
+     static bool firstTime = true;
+     if(firstTime) {
+         firstTime = false;
+         PVStatsPluginPtr pvPlugin = PVStatsPluginPtr(new PVStatsPlugin());
+         PVPluginRegistry::registerPlugin(name,pvPlugin);
+    }
+}
+
+PVFilterPtr PVStatsPlugin::create(
+     const std::string & requestValue,
+     const PVCopyPtr & pvCopy,
+     const PVFieldPtr & master)
+{
+    return PVStatsFilter::create(requestValue,master);
+}
+
+FieldConstPtr PVStatsPlugin::getCopyField(
+     const std::string & requestValue,
+     const PVFieldPtr & master)
+{
+    size_t windowUpdates = 0;
+    uint64 windowNanoseconds = 0;
+    if(!findAccumulate(master)) return FieldConstPtr();
+    if(!parseRequest(requestValue,windowUpdates,windowNanoseconds)) return FieldConstPtr();
+    return PVStatsFilter::getStatsStructure();
+}
+
+PVStatsFilter::~PVStatsFilter()
+{
+}
+
+StructureConstPtr PVStatsFilter::getStatsStructure()
+{
+    static StructureConstPtr statsStructure(
+        getFieldCreate()->createFieldBuilder()->
+            add("mean",pvDouble)->
+            add("rms",pvDouble)->
+            add("min",pvDouble)->
+            add("max",pvDouble)->
+            add("count",pvLong)->
+            createStructure());
+    return statsStructure;
+}
+
+PVStatsFilterPtr PVStatsFilter::create(
+     const std::string & requestValue,
+     const PVFieldPtr & master)
+{
+    AccumulateFunc accumulate = findAccumulate(master);
+    if(!accumulate) return PVStatsFilterPtr();
+    size_t windowUpdates = 0;
+    uint64 windowNanoseconds = 0;
+    if(!parseRequest(requestValue,windowUpdates,windowNanoseconds)) return PVStatsFilterPtr();
+    PVStatsFilterPtr filter =
+         PVStatsFilterPtr(
+             new PVStatsFilter(master,accumulate,windowUpdates,windowNanoseconds));
+    return filter;
+}
+
+PVStatsFilter::PVStatsFilter(
+    const PVFieldPtr & master,
+    AccumulateFunc accumulate,
+    size_t windowUpdates,
+    uint64 windowNanoseconds)
+: master(master),
+  accumulate(accumulate),
+  windowUpdates(windowUpdates),
+  windowNanoseconds(windowNanoseconds),
+  nupdates(0),
+  windowStart(0)
+{
+}
+
+bool PVStatsFilter::filter(const PVFieldPtr & pvCopy,const BitSetPtr & bitSet,bool toCopy)
+{
+    if(!toCopy) return true;
+    bool complete = false;
+    if(windowUpdates>0) {
+        accumulate(*master,accumulator);
+        complete = (++nupdates>=windowUpdates);
+    } else {
+        epicsUInt64 now = epicsMonotonicGet();
+        if(nupdates++==0) windowStart = now;
+        accumulate(*master,accumulator);
+        complete = (now - windowStart>=windowNanoseconds);
+    }
+    if(!complete) {
+        bitSet->clear(pvCopy->getFieldOffset());
+        return true;
+    }
+    PVFieldPtrArray const & pvFields = static_pointer_cast<PVStructure>(pvCopy)->getPVFields();
+    int64 count = accumulator.count;
+    double mean = (count>0) ? accumulator.sum/count : 0.0;
+    double rms = (count>0) ? sqrt(accumulator.sumSquares/count) : 0.0;
+    static_cast<PVDouble &>(*pvFields[0]).put(mean);
+    static_cast<PVDouble &>(*pvFields[1]).put(rms);
+    static_cast<PVDouble &>(*pvFields[2]).put((count>0) ? accumulator.min : 0.0);
+    static_cast<PVDouble &>(*pvFields[3]).put((count>0) ? accumulator.max : 0.0);
+    static_cast<PVLong &>(*pvFields[4]).put(count);
+    bitSet->set(pvCopy->getFieldOffset());
+    accumulator.reset();
+    nupdates = 0;
+    return true;
+}
+
+string PVStatsFilter::getName()
+{
+	return name;
+}
+
+}}
@@ -25,6 +25,21 @@ namespace epics { namespace pvCopy{
 static ConvertPtr convert = getConvert();
 static std::string name("timestamp");
 
+/*
+ * Find the position of a field of pvStructure with name and scalar type,
+ * or npos if there is none.
+ */
+static size_t findField(PVStructure & pvStructure,const char * fieldName,ScalarType scalarType)
+{
+    PVScalarPtr pvScalar(pvStructure.getSubField<PVScalar>(fieldName));
+    if(!pvScalar || pvScalar->getScalar()->getScalarType()!=scalarType) return string::npos;
+    PVFieldPtrArray const & pvFields = pvStructure.getPVFields();
+    for(size_t i=0; i<pvFields.size(); ++i) {
+        if(pvFields[i]==pvScalar) return i;
+    }
+    return string::npos;
+}
+
 PVTimestampPlugin::PVTimestampPlugin()
 {
 }
@@ -62,6 +77,12 @@ PVTimestampFilterPtr PVTimestampFilter::create(
 {
     PVTimeStamp pvTimeStamp;
     if(!pvTimeStamp.attach(master)) return PVTimestampFilterPtr();
+    PVStructure & pvStructure(static_cast<PVStructure &>(*master));
+    if(findField(pvStructure,"secondsPastEpoch",pvLong)==string::npos
+    || findField(pvStructure,"nanoseconds",pvInt)==string::npos
+    || findField(pvStructure,"userTag",pvInt)==string::npos) {
+        return PVTimestampFilterPtr();
+    }
     bool current = false;
     bool copy = false;
     if(requestValue.compare("current")==0) {
@@ -77,42 +98,84 @@ PVTimestampFilterPtr PVTimestampFilter::create(
 }
 
 PVTimestampFilter::PVTimestampFilter(bool current,bool copy,PVFieldPtr const & master)
-: current(current),
+: PVFilterV2(master),
+  current(current),
   copy(copy),
-  master(master)
+  copyOffset(string::npos),
+  secondsIndex(string::npos),
+  nanosecondsIndex(string::npos),
+  userTagIndex(string::npos)
+{
+    pvTimeStamp.attach(master);
+}
+
+/*
+ * The copy can have a subset of the fields of master, in any order.
+ * Its fields are found once, since the copy structure does not change.
+ */
+void PVTimestampFilter::findCopyFields(View const & copyView)
+{
+    PVStructure & pvCopy = copyView.as<PVStructure>();
+    copyOffset = copyView.offset;
+    secondsIndex = findField(pvCopy,"secondsPastEpoch",pvLong);
+    nanosecondsIndex = findField(pvCopy,"nanoseconds",pvInt);
+    userTagIndex = findField(pvCopy,"userTag",pvInt);
+}
+
+void PVTimestampFilter::getTimeStamp(PVStructure & pvStructure,TimeStamp & timeStamp)
 {
+    PVFieldPtrArray const & pvFields = pvStructure.getPVFields();
+    int64 seconds = timeStamp.getSecondsPastEpoch();
+    int32 nanoseconds = timeStamp.getNanoseconds();
+    if(secondsIndex!=string::npos) seconds = static_cast<PVLong &>(*pvFields[secondsIndex]).get();
+    if(nanosecondsIndex!=string::npos) {
+        nanoseconds = static_cast<PVInt &>(*pvFields[nanosecondsIndex]).get();
+    }
+    timeStamp.put(seconds,nanoseconds);
+    if(userTagIndex!=string::npos) {
+        timeStamp.setUserTag(static_cast<PVInt &>(*pvFields[userTagIndex]).get());
+    }
 }
 
+void PVTimestampFilter::putTimeStamp(PVStructure & pvStructure,TimeStamp const & timeStamp)
+{
+    PVFieldPtrArray const & pvFields = pvStructure.getPVFields();
+    if(secondsIndex!=string::npos) {
+        static_cast<PVLong &>(*pvFields[secondsIndex]).put(timeStamp.getSecondsPastEpoch());
+    }
+    if(nanosecondsIndex!=string::npos) {
+        static_cast<PVInt &>(*pvFields[nanosecondsIndex]).put(timeStamp.getNanoseconds());
+    }
+    if(userTagIndex!=string::npos) {
+        static_cast<PVInt &>(*pvFields[userTagIndex]).put(timeStamp.getUserTag());
+    }
+}
 
-bool PVTimestampFilter::filter(const PVFieldPtr & pvCopy,const BitSetPtr & bitSet,bool toCopy)
+bool PVTimestampFilter::filterView(View const & master,View const & copyView,PVFilterContext & context,bool toCopy)
 {
-    if(current) {	
-        timeStamp.getCurrent();
+    PVStructure & pvCopy = copyView.as<PVStructure>();
+    if(copyView.offset!=copyOffset) findCopyFields(copyView);
+    if(current) {
         if(toCopy) {
-            if(!pvTimeStamp.attach(pvCopy)) return false;
+            putTimeStamp(pvCopy,context.getTimeStamp());
         } else {
-            if(!pvTimeStamp.attach(master)) return false;
+            pvTimeStamp.set(context.getTimeStamp());
         }
-        pvTimeStamp.set(timeStamp);
-        bitSet->set(pvCopy->getFieldOffset());
+        context.getBitSet().set(copyView.offset);
         return true;
-     }
-     if(copy) {	
+    }
+    if(copy) {
         if(toCopy) {
-            if(!pvTimeStamp.attach(master)) return false;
             pvTimeStamp.get(timeStamp);
-            if(!pvTimeStamp.attach(pvCopy)) return false;
-            pvTimeStamp.set(timeStamp);
-            bitSet->set(pvCopy->getFieldOffset());
+            putTimeStamp(pvCopy,timeStamp);
+            context.getBitSet().set(copyView.offset);
         } else {
-            if(!pvTimeStamp.attach(pvCopy)) return false;
-            pvTimeStamp.get(timeStamp);
-            if(!pvTimeStamp.attach(master)) return false;
+            getTimeStamp(pvCopy,timeStamp);
             pvTimeStamp.set(timeStamp);
         }
         return true;
-     }
-     return false;
+    }
+    return false;
 }
 
 string PVTimestampFilter::getName()
@@ -0,0 +1,160 @@
+/* pvClock.cpp */
+/**
+ * Copyright - See the COPYRIGHT that is included with this distribution.
+ * EPICS pvData is distributed subject to a Software License Agreement found
+ * in file LICENSE that is included with this distribution.
+ */
+
+#include <stdexcept>
+#include <vector>
+
+#include <epicsAtomic.h>
+#include <epicsExit.h>
+#include <epicsThread.h>
+#include <epicsTime.h>
+#include <pv/lock.h>
+
+#define epicsExportSharedSymbols
+
+#include <pv/pvClock.h>
+
+using std::vector;
+using namespace epics::pvData;
+
+namespace epics { namespace pvDatabase {
+
+static const uint64 nanoPerSec = 1000000000u;
+
+/*
+ * The cycle state of a thread.
+ * It is allocated the first time a thread begins a cycle
+ * and freed when the thread exits.
+ */
+struct CycleState {
+    CycleState() : depth(0), valid(false), secondsPastEpoch(0), nanoseconds(0) {}
+    int depth;
+    bool valid;
+    int64 secondsPastEpoch;
+    int32 nanoseconds;
+};
+
+static epicsThreadOnceId cycleOnce = EPICS_THREAD_ONCE_INIT;
+static epicsThreadPrivateId cycleId = 0;
+
+static void createCycleId(void *)
+{
+    cycleId = epicsThreadPrivateCreate();
+}
+
+static void freeCycleState(void * arg)
+{
+    epicsThreadPrivateSet(cycleId,0);
+    delete static_cast<CycleState *>(arg);
+}
+
+static CycleState * getCycleState(bool create)
+{
+    epicsThreadOnce(&cycleOnce,&createCycleId,0);
+    CycleState * state = static_cast<CycleState *>(epicsThreadPrivateGet(cycleId));
+    if(!state && create) {
+        state = new CycleState();
+        epicsThreadPrivateSet(cycleId,state);
+        epicsAtThreadExit(&freeCycleState,state);
+    }
+    return state;
+}
+
+/*
+ * The wall clock time at which monotonic mode was selected.
+ * Like the plugin registry it is published without a lock and never deleted.
+ */
+struct MonotonicBase {
+    int64 secondsPastEpoch;
+    int32 nanoseconds;
+    epicsUInt64 monotonic;
+};
+
+static EpicsAtomicPtrT currentBase = 0;
+static vector<MonotonicBase *> bases;
+static Mutex mutex;  // serializes setMonotonic
+
+static const MonotonicBase * getBase()
+{
+    const MonotonicBase * base =
+        static_cast<const MonotonicBase *>(epicsAtomicGetPtrT(&currentBase));
+    epicsAtomicReadMemoryBarrier();
+    return base;
+}
+
+static void readClock(TimeStamp & timeStamp)
+{
+    const MonotonicBase * base = getBase();
+    if(!base) {
+        timeStamp.getCurrent();
+        return;
+    }
+    epicsUInt64 delta = epicsMonotonicGet() - base->monotonic;
+    int64 secondsPastEpoch = base->secondsPastEpoch + static_cast<int64>(delta/nanoPerSec);
+    int32 nanoseconds = base->nanoseconds + static_cast<int32>(delta%nanoPerSec);
+    if(nanoseconds>=static_cast<int32>(nanoPerSec)) {
+        ++secondsPastEpoch;
+        nanoseconds -= static_cast<int32>(nanoPerSec);
+    }
+    timeStamp.put(secondsPastEpoch,nanoseconds);
+}
+
+void PVClock::getCurrent(TimeStamp & timeStamp)
+{
+    CycleState * state = getCycleState(false);
+    if(!state || state->depth==0) {
+        readClock(timeStamp);
+        return;
+    }
+    if(!state->valid) {
+        TimeStamp now;
+        readClock(now);
+        state->secondsPastEpoch = now.getSecondsPastEpoch();
+        state->nanoseconds = now.getNanoseconds();
+        state->valid = true;
+    }
+    timeStamp.put(state->secondsPastEpoch,state->nanoseconds);
+}
+
+void PVClock::beginCycle()
+{
+    CycleState * state = getCycleState(true);
+    if(state->depth++==0) state->valid = false;
+}
+
+void PVClock::endCycle()
+{
+    CycleState * state = getCycleState(false);
+    if(!state || state->depth==0) {
+        throw std::logic_error("PVClock::endCycle without beginCycle");
+    }
+    --state->depth;
+}
+
+void PVClock::setMonotonic(bool monotonic)
+{
+    Lock xx(mutex);
+    MonotonicBase * base = 0;
+    if(monotonic) {
+        TimeStamp now;
+        base = new MonotonicBase();
+        base->monotonic = epicsMonotonicGet();
+        now.getCurrent();
+        base->secondsPastEpoch = now.getSecondsPastEpoch();
+        base->nanoseconds = now.getNanoseconds();
+        bases.push_back(base);
+    }
+    epicsAtomicWriteMemoryBarrier();
+    epicsAtomicSetPtrT(&currentBase,base);
+}
+
+bool PVClock::isMonotonic()
+{
+    return getBase()!=0;
+}
+
+}}
@@ -17,6 +17,16 @@
 #include <pv/pvArrayPlugin.h>
 #include <pv/pvTimestampPlugin.h>
 #include <pv/pvDeadbandPlugin.h>
+#include <pv/pvDecimatePlugin.h>
+#include <pv/pvCompressPlugin.h>
+#include <pv/pvStatsPlugin.h>
+#include <pv/pvHistogramPlugin.h>
+#include <pv/pvQuantilePlugin.h>
+#include <pv/pvSpectrumPlugin.h>
+#include <pv/pvQuantizePlugin.h>
+#include <pv/pvSparsePlugin.h>
+#include <pv/pvPeaksPlugin.h>
+#include <pv/pvRoiPlugin.h>
 
 using std::tr1::static_pointer_cast;
 using namespace epics::pvData;
@@ -38,6 +48,16 @@ PVDatabasePtr PVDatabase::getMaster()
         PVArrayPlugin::create();
         PVTimestampPlugin::create();
         PVDeadbandPlugin::create();
+        PVDecimatePlugin::create();
+        PVCompressPlugin::create();
+        PVStatsPlugin::create();
+        PVHistogramPlugin::create();
+        PVQuantilePlugin::create();
+        PVSpectrumPlugin::create();
+        PVQuantizePlugin::create();
+        PVSparsePlugin::create();
+        PVPeaksPlugin::create();
+        PVRoiPlugin::create();
     }    
     return pvDatabaseMaster;
 }
@@ -10,9 +10,12 @@
  */
 #include <epicsGuard.h>
 #include <epicsThread.h>
+#include <epicsTime.h>
+#include <pv/pvSubArrayCopy.h>
 
 #define epicsExportSharedSymbols
 #include <pv/pvDatabase.h>
+#include <pv/pvClock.h>
 #include <pv/pvStructureCopy.h>
 
 
@@ -42,6 +45,10 @@ PVRecord::PVRecord(
   pvStructure(pvStructure),
   depthGroupPut(0),
   traceLevel(0),
+  skipUnchanged(false),
+  queuePuts(false),
+  processWindow(0),
+  lastProcessForGet(0),
   isAddListener(false)
 {
 }
@@ -116,11 +123,37 @@ void PVRecord::process()
     }
     if(pvTimeStamp.isAttached()) {
         pvTimeStamp.get(timeStamp);
-        timeStamp.getCurrent();
+        PVClock::getCurrent(timeStamp);
         pvTimeStamp.set(timeStamp);
     }
 }
 
+double PVRecord::getProcessWindow()
+{
+    return processWindow*1e-9;
+}
+
+void PVRecord::setProcessWindow(double seconds)
+{
+    // longest window, so that the conversion to nanoseconds can not overflow
+    static const double maxSeconds = 1e9;
+    if(!(seconds>0.0)) {
+        processWindow = 0;
+    } else if(seconds>maxSeconds) {
+        processWindow = static_cast<uint64>(maxSeconds*1e9);
+    } else {
+        processWindow = static_cast<uint64>(seconds*1e9);
+    }
+}
+
+bool PVRecord::isProcessForGetDue()
+{
+    if(processWindow==0) return true;
+    uint64 now = epicsMonotonicGet();
+    if(lastProcessForGet!=0 && now - lastProcessForGet < processWindow) return false;
+    lastProcessForGet = now;
+    return true;
+}
 
 PVRecordFieldPtr PVRecord::findPVRecordField(PVFieldPtr const & pvField)
 {
@@ -272,8 +305,33 @@ bool PVRecord::removeListener(
     return false;
 }
 
+void PVRecord::putArrayRange(
+    PVArrayPtr const & pvArray,
+    PVArrayPtr const & pvFrom,
+    size_t offset,
+    size_t count,
+    size_t stride)
+{
+    if(traceLevel>2) {
+        cout << "PVRecord::putArrayRange() " << recordName << endl;
+    }
+    PVRecordFieldPtr pvRecordField = findPVRecordField(pvArray);
+    pvRecordField->isRangePut = true;
+    pvRecordField->rangeFirst = offset;
+    pvRecordField->rangeCount = (count==0) ? 0 : (count-1)*stride + 1;
+    try {
+        copy(pvFrom,0,1,pvArray,offset,stride,count);
+    } catch(...) {
+        pvRecordField->isRangePut = false;
+        throw;
+    }
+    pvRecordField->isRangePut = false;
+}
+
 void PVRecord::beginGroupPut()
 {
+   // every process and timestamp filter in the group put uses the same time
+   PVClock::beginCycle();
    if(++depthGroupPut>1) return;
     if(traceLevel>2) {
         cout << "PVRecord::beginGroupPut() " << recordName << endl;
@@ -289,17 +347,26 @@ void PVRecord::beginGroupPut()
 
 void PVRecord::endGroupPut()
 {
-   if(--depthGroupPut>0) return;
+   if(--depthGroupPut>0) {
+       PVClock::endCycle();
+       return;
+   }
     if(traceLevel>2) {
         cout << "PVRecord::endGroupPut() " << recordName << endl;
     }
-   std::list<PVListenerWPtr>::iterator iter;
-   for (iter = pvListenerList.begin(); iter!=pvListenerList.end(); iter++)
-   {
-       PVListenerPtr listener = iter->lock();
-       if(!listener.get()) continue;
-       listener->endGroupPut(shared_from_this());
+   try {
+       std::list<PVListenerWPtr>::iterator iter;
+       for (iter = pvListenerList.begin(); iter!=pvListenerList.end(); iter++)
+       {
+           PVListenerPtr listener = iter->lock();
+           if(!listener.get()) continue;
+           listener->endGroupPut(shared_from_this());
+       }
+   } catch(...) {
+       PVClock::endCycle();
+       throw;
    }
+   PVClock::endCycle();
 }
 
 std::ostream& operator<<(std::ostream& o, const PVRecord& record)
@@ -316,7 +383,10 @@ PVRecordField::PVRecordField(
     PVFieldPtr const & pvField,
     PVRecordStructurePtr const &parent,
     PVRecordPtr const & pvRecord)
-:  pvField(pvField),
+:  isRangePut(false),
+   rangeFirst(0),
+   rangeCount(0),
+   pvField(pvField),
    isStructure(pvField->getField()->getType()==structure ? true : false),
    parent(parent),
    pvRecord(pvRecord)
@@ -427,7 +497,11 @@ void PVRecordField::callListener()
     for (iter = pvListenerList.begin(); iter!=pvListenerList.end(); iter++ ) {
         PVListenerPtr listener = iter->lock();
         if(!listener.get()) continue;
-        listener->dataPut(shared_from_this());
+        if(isRangePut) {
+            listener->dataPutRange(shared_from_this(),rangeFirst,rangeCount);
+        } else {
+            listener->dataPut(shared_from_this());
+        }
     }
 }
 
@@ -0,0 +1,87 @@
+/* pvClock.h */
+/**
+ * Copyright - See the COPYRIGHT that is included with this distribution.
+ * EPICS pvData is distributed subject to a Software License Agreement found
+ * in file LICENSE that is included with this distribution.
+ */
+#ifndef PVCLOCK_H
+#define PVCLOCK_H
+
+#ifdef epicsExportSharedSymbols
+#   define pvclockEpicsExportSharedSymbols
+#   undef epicsExportSharedSymbols
+#endif
+
+#include <pv/pvData.h>
+#include <pv/timeStamp.h>
+
+#ifdef pvclockEpicsExportSharedSymbols
+#   define epicsExportSharedSymbols
+#	undef pvclockEpicsExportSharedSymbols
+#endif
+
+#include <shareLib.h>
+
+namespace epics { namespace pvDatabase {
+
+/**
+ * @brief The time source for PVRecord::process and the timestamp plugin.
+ *
+ * A thread can begin a cycle, for example for a group put or a scan of many records.
+ * Within a cycle the clock is read once and every call to getCurrent returns the same time.
+ * PVRecord::beginGroupPut and PVRecord::endGroupPut begin and end a cycle.
+ * Cycles nest, only the outermost cycle of a thread reads the clock.
+ *
+ * In monotonic mode the time is computed from the monotonic clock and the wall clock time
+ * at which the mode was selected. This is cheaper than reading the wall clock on some targets,
+ * but it does not follow adjustments of the wall clock until setMonotonic(true) is called again.
+ */
+class epicsShareClass PVClock
+{
+public:
+    /**
+     * Set the seconds and nanoseconds of timeStamp to the current time.
+     * The userTag is not changed.
+     * @param timeStamp The timeStamp.
+     */
+    static void getCurrent(epics::pvData::TimeStamp & timeStamp);
+    /**
+     * Begin a cycle in the calling thread.
+     * Each call must be followed by a call to endCycle in the same thread.
+     */
+    static void beginCycle();
+    /**
+     * End a cycle in the calling thread.
+     */
+    static void endCycle();
+    /**
+     * Select monotonic mode.
+     * @param monotonic (false,true) means (read the wall clock, use the monotonic clock).
+     * If true the wall clock is read again to compute the offset of the monotonic clock.
+     */
+    static void setMonotonic(bool monotonic);
+    /**
+     * Is monotonic mode selected?
+     * @return (false,true) if it (is not, is) selected.
+     */
+    static bool isMonotonic();
+};
+
+/**
+ * @brief A cycle of PVClock for the lifetime of the object.
+ *
+ * Like Lock, this makes sure that the cycle ends if an exception is thrown.
+ */
+class epicsShareClass PVClockCycle
+{
+public:
+    PVClockCycle() { PVClock::beginCycle();}
+    ~PVClockCycle() { PVClock::endCycle();}
+private:
+    PVClockCycle(PVClockCycle const &);
+    PVClockCycle & operator=(PVClockCycle const &);
+};
+
+}}
+
+#endif  /* PVCLOCK_H */
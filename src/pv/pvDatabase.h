@@ -220,8 +220,29 @@ public:
         epics::pvCopy::PVCopyPtr const & pvCopy);
 
 
+    /**
+     * @brief Put elements into an array field of the record.
+     *
+     * The caller must have locked the record.
+     * Listeners of the field are called via PVListener::dataPutRange
+     * with the range of elements that was modified.
+     * @param pvArray An array field of the record.
+     * @param pvFrom The array with the new elements.
+     * @param offset The index in pvArray of the first element to put.
+     * @param count The number of elements to put.
+     * @param stride The distance in pvArray between elements to put.
+     */
+    void putArrayRange(
+        epics::pvData::PVArrayPtr const & pvArray,
+        epics::pvData::PVArrayPtr const & pvFrom,
+        std::size_t offset,
+        std::size_t count,
+        std::size_t stride);
     /**
      * @brief Begins a group of puts.
+     *
+     * Each call must be followed by a call to endGroupPut, also if an exception is thrown.
+     * PVGroupPut does this.
      */
     void beginGroupPut();
     /**
@@ -238,6 +259,62 @@ public:
      * @param level The level
      */
     void setTraceLevel(int level) {traceLevel = level;}
+    /**
+     * @brief Get the default for record._options.skipUnchanged of a put.
+     * @return (false,true) means a put (writes,skips) fields that already have the value.
+     */
+    bool getSkipUnchanged() {return skipUnchanged;}
+    /**
+     * @brief Set the default for record._options.skipUnchanged of a put.
+     *
+     * The default is false. It applies to a put that is created after it is set.
+     * A put that skips every field it has does not process the record.
+     * @param value (false,true) means a put (writes,skips) fields that already have the value.
+     */
+    void setSkipUnchanged(bool value) {skipUnchanged = value;}
+    /**
+     * @brief Get the process window for get with process.
+     * @return The window in seconds.
+     */
+    double getProcessWindow();
+    /**
+     * @brief Set the process window for get with process.
+     *
+     * If the window is not zero, all gets with process that arrive within the window
+     * share one call of process: the first get processes the record,
+     * the others copy the result of that process.
+     * The default is zero, which means that every get with process processes the record.
+     * @param seconds The window in seconds.
+     * A value that is not greater than zero, or NaN, sets zero.
+     * A value greater than 1e9 sets 1e9.
+     */
+    void setProcessWindow(double seconds);
+    /**
+     * @brief Must a get with process process the record?
+     *
+     * This must be called with the record locked.
+     * @return (false,true) if the caller (must not,must) call process.
+     */
+    bool isProcessForGetDue();
+    /**
+     * @brief Are puts queued?
+     * @return (false,true) if puts (are not,are) queued.
+     */
+    bool getQueuePuts() {return queuePuts;}
+    /**
+     * @brief Set if puts are queued.
+     *
+     * If puts are queued, a put or putGet of a channel of the local provider returns
+     * without writing the record. A pool of worker threads writes the record.
+     * All puts that are queued for the record when a worker gets to it are written
+     * under one lock of the record, in the order they arrived, and the record is processed once.
+     * Consecutive puts with the same request, from any channel, are merged while they wait,
+     * so that the last put of each field wins.
+     * Each put still gets its putDone.
+     * The default is false. It applies to a put that is created after it is set.
+     * @param value (false,true) means puts (are not,are) queued.
+     */
+    void setQueuePuts(bool value) {queuePuts = value;}
 protected:
     /**
      * @brief Constructor
@@ -267,6 +344,10 @@ private:
     epics::pvData::Mutex mutex;
     std::size_t depthGroupPut;
     int traceLevel;
+    bool skipUnchanged;
+    bool queuePuts;
+    epics::pvData::uint64 processWindow;    // nanoseconds
+    epics::pvData::uint64 lastProcessForGet;  // epicsMonotonicGet, 0 if none
     // following only valid while addListener or removeListener is active.
     bool isAddListener;
     PVListenerWPtr pvListener;
@@ -277,6 +358,47 @@ private:
 
 epicsShareFunc std::ostream& operator<<(std::ostream& o, const PVRecord& record);
 
+/**
+ * @brief A group put of a PVRecord for the lifetime of the object.
+ *
+ * Like PVClockCycle, this makes sure that the group put ends if an exception is thrown,
+ * so that neither the record nor the PVClock cycle of the thread stays in a group put.
+ * The record must be locked for the lifetime of the object.
+ */
+class epicsShareClass PVGroupPut
+{
+public:
+    explicit PVGroupPut(PVRecord & pvRecord)
+    : pvRecord(pvRecord),
+      active(true)
+    {
+        pvRecord.beginGroupPut();
+    }
+    ~PVGroupPut()
+    {
+        if(!active) return;
+        // an exception is already being handled
+        try {
+            pvRecord.endGroupPut();
+        } catch(...) {}
+    }
+    /**
+     * @brief Ends the group put before the object is destroyed.
+     *
+     * An exception thrown by a listener is passed to the caller.
+     */
+    void end()
+    {
+        active = false;
+        pvRecord.endGroupPut();
+    }
+private:
+    PVGroupPut(PVGroupPut const &);
+    PVGroupPut & operator=(PVGroupPut const &);
+    PVRecord & pvRecord;
+    bool active;
+};
+
 /**
  * @brief Interface for a field of a record.
  *
@@ -346,6 +468,10 @@ private:
     void callListener();
 
     std::list<PVListenerWPtr> pvListenerList;
+    // range of elements being put by PVRecord::putArrayRange
+    bool isRangePut;
+    std::size_t rangeFirst;
+    std::size_t rangeCount;
     epics::pvData::PVField::weak_pointer pvField;
     bool isStructure;
     PVRecordStructureWPtr parent;
@@ -450,6 +576,23 @@ public:
     virtual void dataPut(
         PVRecordStructurePtr const & requested,
         PVRecordFieldPtr const & pvRecordField) = 0;
+    /**
+     * @brief A range of elements of an array field has been modified.
+     *
+     * This is called instead of dataPut(pvRecordField) when the field
+     * is modified by PVRecord::putArrayRange.
+     * The default calls dataPut(pvRecordField).
+     * @param pvRecordField The modified field.
+     * @param first The index of the first modified element.
+     * @param count The number of elements from first that may have been modified.
+     */
+    virtual void dataPutRange(
+        PVRecordFieldPtr const & pvRecordField,
+        std::size_t first,
+        std::size_t count)
+    {
+        dataPut(pvRecordField);
+    }
     /**
      * @brief Begin a set of puts.
      * @param pvRecord The record.
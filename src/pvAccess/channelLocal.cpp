@@ -10,15 +10,20 @@
  */
 
 #include <sstream>
+#include <deque>
+#include <map>
 
 #include <epicsGuard.h>
 #include <epicsThread.h>
+#include <pv/thread.h>
+#include <pv/event.h>
 #include <pv/timeStamp.h>
 #include <pv/pvSubArrayCopy.h>
 
 #define epicsExportSharedSymbols
 
 #include <pv/channelProviderLocal.h>
+#include <pv/pvCompiledRequest.h>
 
 using namespace epics::pvData;
 using namespace epics::pvAccess;
@@ -48,20 +53,12 @@ typedef std::tr1::shared_ptr<ChannelArrayLocal> ChannelArrayLocalPtr;
 
 static bool getProcess(PVStructurePtr pvRequest,bool processDefault)
 {
-    PVFieldPtr pvField = pvRequest->getSubField("record._options.process");
-    if(!pvField || pvField->getField()->getType()!=scalar) {
-        return processDefault;
-    }
-    ScalarConstPtr scalar = static_pointer_cast<const Scalar>(
-        pvField->getField());
-    if(scalar->getScalarType()==pvString) {
-        PVStringPtr pvString = static_pointer_cast<PVString>(pvField);
-        return  pvString->get().compare("true")==0 ? true : false;
-    } else if(scalar->getScalarType()==pvBoolean) {
-        PVBooleanPtr pvBoolean = static_pointer_cast<PVBoolean>(pvField);
-       	return pvBoolean->get();
-    }
-    return processDefault;
+    return CompiledRequest::get(pvRequest)->getProcess(processDefault);
+}
+
+static bool getSkipUnchanged(PVStructurePtr pvRequest,PVRecordPtr const & pvRecord)
+{
+    return CompiledRequest::get(pvRequest)->getSkipUnchanged(pvRecord->getSkipUnchanged());
 }
 
 class ChannelProcessLocal :
@@ -113,24 +110,8 @@ ChannelProcessLocalPtr ChannelProcessLocal::create(
     PVStructurePtr const & pvRequest,
     PVRecordPtr const &pvRecord)
 {
-    PVFieldPtr pvField;
-    PVStructurePtr pvOptions;
     int nProcess = 1;
-    if(pvRequest) pvField = pvRequest->getSubField("record._options");
-    if(pvField) {
-        pvOptions = static_pointer_cast<PVStructure>(pvField);
-        pvField = pvOptions->getSubField("nProcess");
-        if(pvField) {
-            PVStringPtr pvString = pvOptions->getSubField<PVString>("nProcess");
-            if(pvString) {
-                int size;
-                std::stringstream ss;
-                ss << pvString->get();
-                ss >> size;
-                nProcess = size;
-            }
-        }
-    }
+    if(pvRequest) nProcess = CompiledRequest::get(pvRequest)->getNProcess();
     ChannelProcessLocalPtr process(new ChannelProcessLocal(
         channelLocal,
         channelProcessRequester,
@@ -186,9 +167,9 @@ void ChannelProcessLocal::process()
     try {
         for(int i=0; i< nProcess; i++) {
             epicsGuard <PVRecord> guard(*pvr);
-            pvr->beginGroupPut();
+            PVGroupPut groupPut(*pvr);
             pvr->process();
-            pvr->endGroupPut();
+            groupPut.end();
         }
         requester->processDone(Status::Ok,getPtrSelf());
     } catch(std::exception& ex) {
@@ -237,6 +218,7 @@ private:
       pvCopy(pvCopy),
       pvStructure(pvStructure),
       bitSet(bitSet),
+      snapshot(pvCopy->createPostCopySnapshot()),
       pvRecord(pvRecord)
     {
     }
@@ -247,6 +229,8 @@ private:
     PVCopyPtr pvCopy;
     PVStructurePtr pvStructure;
     BitSetPtr bitSet;
+    // for the post-copy filters, which are called after the record is unlocked
+    PostCopySnapshotPtr snapshot;
     PVRecordWPtr pvRecord;
     Mutex mutex;
 };
@@ -332,13 +316,14 @@ void ChannelGetLocal::get()
         bitSet->clear();
         {
             epicsGuard <PVRecord> guard(*pvr);
-            if(callProcess) {
-                pvr->beginGroupPut();
+            if(callProcess && pvr->isProcessForGetDue()) {
+                PVGroupPut groupPut(*pvr);
                 pvr->process();
-                pvr->endGroupPut();
+                groupPut.end();
             }
-            notifyClient = pvCopy->updateCopySetBitSet(pvStructure, bitSet);
+            notifyClient = pvCopy->updateCopySetBitSet(pvStructure, bitSet, snapshot);
         }
+        if(pvCopy->runPostCopyFilters(pvStructure, bitSet, snapshot)) notifyClient = true;
         if(firstTime) {
             bitSet->clear();
             bitSet->set(0);
@@ -371,8 +356,294 @@ void ChannelGetLocal::get()
 
 }
 
+class QueuedPut;
+typedef std::tr1::shared_ptr<QueuedPut> QueuedPutPtr;
+
+/*
+ * A put or putGet that is written by a worker of the PutQueue.
+ */
+class QueuedPut
+{
+public:
+    virtual ~QueuedPut() {}
+    /*
+     * Get a copy structure and bitSet for queued data.
+     * getData and releaseData are called with the PutQueue mutex held.
+     */
+    void getData(PVStructurePtr & pvStructure,BitSetPtr & bitSet);
+    void releaseData(PVStructurePtr const & pvStructure,BitSetPtr const & bitSet);
+    /*
+     * Write queued data. Called with the record locked.
+     * Returns false if skipUnchanged left every field of the record as it was.
+     */
+    virtual bool write(PVStructurePtr const & pvStructure,BitSetPtr const & bitSet) = 0;
+    virtual bool getCallProcess() = 0;
+    virtual bool getSkipUnchanged() = 0;
+    // Called with the record locked, after the record is processed.
+    virtual void written() {}
+    // Give each of nput requests the result.
+    virtual void done(Status const & status,size_t nput) = 0;
+    /*
+     * Can the data of other be merged into data of this put?
+     * This is true if both have the same request, copy structure, process and skipUnchanged,
+     * so that the fields, options and processing of the puts are the same.
+     * skipUnchanged is compared since its default can change between the creation of two puts.
+     */
+    bool canMerge(QueuedPut & other);
+protected:
+    QueuedPut(PVCopyPtr const & pvCopy,CompiledRequestPtr const & compiledRequest)
+    : pvCopy(pvCopy),
+      compiledRequest(compiledRequest)
+    {}
+private:
+    PVCopyPtr pvCopy;
+    CompiledRequestPtr compiledRequest;
+    std::vector<PVStructurePtr> freeStructures;
+    std::vector<BitSetPtr> freeBitSets;
+};
+
+void QueuedPut::getData(PVStructurePtr & pvStructure,BitSetPtr & bitSet)
+{
+    if(freeStructures.empty()) {
+        pvStructure = pvCopy->createPVStructure();
+        bitSet = BitSetPtr(new BitSet(pvStructure->getNumberFields()));
+        return;
+    }
+    pvStructure = freeStructures.back();
+    freeStructures.pop_back();
+    bitSet = freeBitSets.back();
+    freeBitSets.pop_back();
+    bitSet->clear();
+}
+
+bool QueuedPut::canMerge(QueuedPut & other)
+{
+    if(this==&other) return true;
+    if(compiledRequest!=other.compiledRequest) return false;
+    if(getCallProcess()!=other.getCallProcess()) return false;
+    if(getSkipUnchanged()!=other.getSkipUnchanged()) return false;
+    StructureConstPtr structure(pvCopy->getStructure());
+    StructureConstPtr otherStructure(other.pvCopy->getStructure());
+    return structure==otherStructure || *structure==*otherStructure;
+}
+
+void QueuedPut::releaseData(PVStructurePtr const & pvStructure,BitSetPtr const & bitSet)
+{
+    freeStructures.push_back(pvStructure);
+    freeBitSets.push_back(bitSet);
+}
+
+/*
+ * The puts of records for which PVRecord::setQueuePuts(true) was called.
+ * A record is written by one worker at a time, so its puts are written in the order they arrived.
+ * A put is merged into the put before it if both have the same request,
+ * which keeps the last value of each field. The puts can be from different channels,
+ * since each client of a channel waits for putDone before its next put.
+ */
+class PutQueue
+{
+public:
+    static PutQueue & get();
+    void add(
+        PVRecordPtr const & pvRecord,
+        QueuedPutPtr const & put,
+        PVStructure const & pvStructure,
+        BitSet const & bitSet);
+private:
+    class Worker : public Runnable
+    {
+    public:
+        explicit Worker(PutQueue & putQueue) : putQueue(putQueue) {}
+        virtual void run() { putQueue.run();}
+    private:
+        PutQueue & putQueue;
+    };
+    typedef std::tr1::shared_ptr<Worker> WorkerPtr;
+    struct Entry {
+        QueuedPutPtr put;       // the put that owns pvStructure and bitSet
+        PVStructurePtr pvStructure;
+        BitSetPtr bitSet;
+        std::vector<QueuedPutPtr> puts;  // the puts merged into this entry, in order
+    };
+    typedef std::vector<Entry> EntryVector;
+    struct RecordPuts {
+        RecordPuts() : scheduled(false) {}
+        EntryVector entries;
+        bool scheduled;         // the record is ready or is being written
+    };
+    typedef std::map<PVRecord *,RecordPuts> RecordPutsMap;
+
+    PutQueue();
+    static void create(void *);
+    static void merge(Entry & entry,PVStructure const & pvStructure,BitSet const & bitSet);
+    static void done(Entry const & entry,Status const & status);
+    void run();
+    bool next(PVRecordPtr & pvRecord,EntryVector & entries);
+    void write(PVRecord & pvRecord,EntryVector const & entries);
+    void finish(PVRecordPtr const & pvRecord,EntryVector & entries);
+
+    static PutQueue * putQueue;
+    static const int maxWorkers = 4;
+    Mutex mutex;
+    Event event;
+    std::deque<PVRecordPtr> ready;
+    RecordPutsMap recordPuts;
+    std::vector<WorkerPtr> workers;
+    std::vector<ThreadPtr> threads;
+};
+
+PutQueue * PutQueue::putQueue = 0;
+static epicsThreadOnceId putQueueOnce = EPICS_THREAD_ONCE_INIT;
+
+void PutQueue::create(void *)
+{
+    putQueue = new PutQueue();
+}
+
+PutQueue & PutQueue::get()
+{
+    epicsThreadOnce(&putQueueOnce,&PutQueue::create,0);
+    return *putQueue;
+}
+
+PutQueue::PutQueue()
+{
+    int nworker = epicsThreadGetCPUs();
+    if(nworker>maxWorkers) nworker = maxWorkers;
+    if(nworker<1) nworker = 1;
+    for(int i=0; i<nworker; ++i) {
+        WorkerPtr worker(new Worker(*this));
+        workers.push_back(worker);
+        Thread::Config config(worker.get());
+        config.name("pvDatabasePut").prio(middlePriority);
+        threads.push_back(ThreadPtr(new Thread(config)));
+    }
+}
+
+void PutQueue::merge(Entry & entry,PVStructure const & pvStructure,BitSet const & bitSet)
+{
+    int32 offset = bitSet.nextSetBit(0);
+    while(offset>=0) {
+        entry.bitSet->set(offset);
+        if(offset==0) {
+            entry.pvStructure->copyUnchecked(pvStructure);
+            break;
+        }
+        PVFieldPtr pvFrom(pvStructure.getSubField(offset));
+        entry.pvStructure->getSubField(offset)->copyUnchecked(*pvFrom);
+        offset = bitSet.nextSetBit(static_cast<uint32>(pvFrom->getNextFieldOffset()));
+    }
+}
+
+/*
+ * Give each put of entry the result, once for each of its merged puts.
+ */
+void PutQueue::done(Entry const & entry,Status const & status)
+{
+    std::vector<QueuedPutPtr> const & puts = entry.puts;
+    size_t i = 0;
+    while(i<puts.size()) {
+        size_t next = i + 1;
+        while(next<puts.size() && puts[next]==puts[i]) ++next;
+        puts[i]->done(status,next - i);
+        i = next;
+    }
+}
+
+void PutQueue::add(
+    PVRecordPtr const & pvRecord,
+    QueuedPutPtr const & put,
+    PVStructure const & pvStructure,
+    BitSet const & bitSet)
+{
+    Lock lock(mutex);
+    RecordPuts & record = recordPuts[pvRecord.get()];
+    EntryVector & entries = record.entries;
+    if(entries.empty() || !entries.back().put->canMerge(*put)) {
+        Entry entry;
+        entry.put = put;
+        put->getData(entry.pvStructure,entry.bitSet);
+        entries.push_back(entry);
+    }
+    merge(entries.back(),pvStructure,bitSet);
+    entries.back().puts.push_back(put);
+    if(record.scheduled) return;
+    record.scheduled = true;
+    ready.push_back(pvRecord);
+    event.signal();
+}
+
+void PutQueue::run()
+{
+    PVRecordPtr pvRecord;
+    EntryVector entries;
+    while(true) {
+        if(!next(pvRecord,entries)) {
+            event.wait();
+            continue;
+        }
+        write(*pvRecord,entries);
+        finish(pvRecord,entries);
+        pvRecord.reset();
+    }
+}
+
+bool PutQueue::next(PVRecordPtr & pvRecord,EntryVector & entries)
+{
+    Lock lock(mutex);
+    if(ready.empty()) return false;
+    pvRecord = ready.front();
+    ready.pop_front();
+    // event is binary, so another worker may not have seen all signals
+    if(!ready.empty()) event.signal();
+    entries.swap(recordPuts[pvRecord.get()].entries);
+    return true;
+}
+
+void PutQueue::write(PVRecord & pvRecord,EntryVector const & entries)
+{
+    Status status(Status::Ok);
+    try {
+        epicsGuard <PVRecord> guard(pvRecord);
+        PVGroupPut groupPut(pvRecord);
+        bool callProcess = false;
+        for(size_t i=0; i<entries.size(); ++i) {
+            bool written = entries[i].put->write(entries[i].pvStructure,entries[i].bitSet);
+            if(written && entries[i].put->getCallProcess()) callProcess = true;
+        }
+        if(callProcess) pvRecord.process();
+        for(size_t i=0; i<entries.size(); ++i) {
+            std::vector<QueuedPutPtr> const & puts = entries[i].puts;
+            for(size_t j=0; j<puts.size(); ++j) {
+                if(j==0 || puts[j]!=puts[j-1]) puts[j]->written();
+            }
+        }
+        groupPut.end();
+    } catch(std::exception& ex) {
+        status = Status(Status::STATUSTYPE_FATAL, ex.what());
+    }
+    for(size_t i=0; i<entries.size(); ++i) done(entries[i],status);
+}
+
+void PutQueue::finish(PVRecordPtr const & pvRecord,EntryVector & entries)
+{
+    Lock lock(mutex);
+    for(size_t i=0; i<entries.size(); ++i) {
+        entries[i].put->releaseData(entries[i].pvStructure,entries[i].bitSet);
+    }
+    entries.clear();
+    RecordPutsMap::iterator iter = recordPuts.find(pvRecord.get());
+    if(iter->second.entries.empty()) {
+        recordPuts.erase(iter);
+        return;
+    }
+    ready.push_back(pvRecord);
+    event.signal();
+}
+
 class ChannelPutLocal :
     public ChannelPut,
+    public QueuedPut,
     public std::tr1::enable_shared_from_this<ChannelPutLocal>
 {
 public:
@@ -391,6 +662,10 @@ public:
     virtual void lock();
     virtual void unlock();
     virtual void lastRequest() {}
+    virtual bool write(PVStructurePtr const &pvStructure,BitSetPtr const &bitSet);
+    virtual bool getCallProcess() { return callProcess;}
+    virtual bool getSkipUnchanged() { return skipUnchanged;}
+    virtual void done(Status const & status,size_t nput);
 private:
     shared_pointer getPtrSelf()
     {
@@ -398,12 +673,18 @@ private:
     }
     ChannelPutLocal(
         bool callProcess,
+        bool skipUnchanged,
+        bool queuePuts,
+        CompiledRequestPtr const &compiledRequest,
         ChannelLocalPtr const &channelLocal,
         ChannelPutRequester::shared_pointer const & channelPutRequester,
         PVCopyPtr const &pvCopy,
         PVRecordPtr const &pvRecord)
     :
+      QueuedPut(pvCopy,compiledRequest),
       callProcess(callProcess),
+      skipUnchanged(skipUnchanged),
+      queuePuts(queuePuts),
       channelLocal(channelLocal),
       channelPutRequester(channelPutRequester),
       pvCopy(pvCopy),
@@ -411,6 +692,8 @@ private:
     {
     }
     bool callProcess;
+    bool skipUnchanged;
+    bool queuePuts;
     ChannelLocalWPtr channelLocal;
     ChannelPutRequester::weak_pointer channelPutRequester;
     PVCopyPtr pvCopy;
@@ -444,6 +727,9 @@ ChannelPutLocalPtr ChannelPutLocal::create(
     }
     ChannelPutLocalPtr put(new ChannelPutLocal(
         getProcess(pvRequest,true),
+        epics::pvDatabase::getSkipUnchanged(pvRequest,pvRecord),
+        pvRecord->getQueuePuts(),
+        CompiledRequest::get(pvRequest),
         channelLocal,
         channelPutRequester,
         pvCopy,
@@ -522,15 +808,19 @@ void ChannelPutLocal::put(
     if(!requester) return;
     PVRecordPtr pvr(pvRecord.lock());
     if(!pvr) throw std::logic_error("pvRecord is deleted");
+    if(queuePuts) {
+        PutQueue::get().add(pvr,getPtrSelf(),*pvStructure,*bitSet);
+        return;
+    }
     try {
         {   
             epicsGuard <PVRecord> guard(*pvr);
-            pvr->beginGroupPut();
-            pvCopy->updateMaster(pvStructure, bitSet);
-            if(callProcess) {
+            PVGroupPut groupPut(*pvr);
+            bool written = pvCopy->updateMaster(pvStructure, bitSet, skipUnchanged);
+            if(callProcess && written) {
                  pvr->process();
             }
-            pvr->endGroupPut();
+            groupPut.end();
         }
         requester->putDone(Status::Ok,getPtrSelf());
         if(pvr->getTraceLevel()>1)
@@ -543,9 +833,22 @@ void ChannelPutLocal::put(
     }
 }
 
+bool ChannelPutLocal::write(PVStructurePtr const &pvStructure,BitSetPtr const &bitSet)
+{
+    return pvCopy->updateMaster(pvStructure, bitSet, skipUnchanged);
+}
+
+void ChannelPutLocal::done(Status const & status,size_t nput)
+{
+    ChannelPutRequester::shared_pointer requester = channelPutRequester.lock();
+    if(!requester) return;
+    for(size_t i=0; i<nput; ++i) requester->putDone(status,getPtrSelf());
+}
+
 
 class ChannelPutGetLocal :
     public ChannelPutGet,
+    public QueuedPut,
     public std::tr1::enable_shared_from_this<ChannelPutGetLocal>
 {
 public:
@@ -567,6 +870,11 @@ public:
     virtual void lock();
     virtual void unlock();
     virtual void lastRequest() {}
+    virtual bool write(PVStructurePtr const &pvStructure,BitSetPtr const &bitSet);
+    virtual bool getCallProcess() { return callProcess;}
+    virtual bool getSkipUnchanged() { return skipUnchanged;}
+    virtual void written();
+    virtual void done(Status const & status,size_t nput);
 private:
     shared_pointer getPtrSelf()
     {
@@ -574,6 +882,9 @@ private:
     }
     ChannelPutGetLocal(
         bool callProcess,
+        bool skipUnchanged,
+        bool queuePuts,
+        CompiledRequestPtr const &compiledRequest,
         ChannelLocalPtr const &channelLocal,
         ChannelPutGetRequester::weak_pointer const & channelPutGetRequester,
         PVCopyPtr const &pvPutCopy,
@@ -582,7 +893,10 @@ private:
         BitSetPtr const & getBitSet,
         PVRecordPtr const &pvRecord)
     : 
+      QueuedPut(pvPutCopy,compiledRequest),
       callProcess(callProcess),
+      skipUnchanged(skipUnchanged),
+      queuePuts(queuePuts),
       channelLocal(channelLocal),
       channelPutGetRequester(channelPutGetRequester),
       pvPutCopy(pvPutCopy),
@@ -593,6 +907,8 @@ private:
     {
     }
     bool callProcess;
+    bool skipUnchanged;
+    bool queuePuts;
     ChannelLocalWPtr channelLocal;
     ChannelPutGetRequester::weak_pointer channelPutGetRequester;
     PVCopyPtr pvPutCopy;
@@ -634,6 +950,9 @@ ChannelPutGetLocalPtr ChannelPutGetLocal::create(
     BitSetPtr   getBitSet(new BitSet(pvGetStructure->getNumberFields()));
     ChannelPutGetLocalPtr putGet(new ChannelPutGetLocal(
         getProcess(pvRequest,true),
+        epics::pvDatabase::getSkipUnchanged(pvRequest,pvRecord),
+        pvRecord->getQueuePuts(),
+        CompiledRequest::get(pvRequest),
         channelLocal,
         channelPutGetRequester,
         pvPutCopy,
@@ -686,15 +1005,19 @@ void ChannelPutGetLocal::putGet(
     if(!requester) return;
     PVRecordPtr pvr(pvRecord.lock());
     if(!pvr) throw std::logic_error("pvRecord is deleted");
+    if(queuePuts) {
+        PutQueue::get().add(pvr,getPtrSelf(),*pvPutStructure,*putBitSet);
+        return;
+    }
     try {
         {
             epicsGuard <PVRecord> guard(*pvr);
-            pvr->beginGroupPut();
-            pvPutCopy->updateMaster(pvPutStructure, putBitSet);
-            if(callProcess) pvr->process();
+            PVGroupPut groupPut(*pvr);
+            bool written = pvPutCopy->updateMaster(pvPutStructure, putBitSet, skipUnchanged);
+            if(callProcess && written) pvr->process();
             getBitSet->clear();
             pvGetCopy->updateCopySetBitSet(pvGetStructure, getBitSet);
-            pvr->endGroupPut();
+            groupPut.end();
         }
         requester->putGetDone(
             Status::Ok,getPtrSelf(),pvGetStructure,getBitSet);
@@ -708,6 +1031,26 @@ void ChannelPutGetLocal::putGet(
     }
 }
 
+bool ChannelPutGetLocal::write(PVStructurePtr const &pvPutStructure,BitSetPtr const &putBitSet)
+{
+    return pvPutCopy->updateMaster(pvPutStructure, putBitSet, skipUnchanged);
+}
+
+void ChannelPutGetLocal::written()
+{
+    getBitSet->clear();
+    pvGetCopy->updateCopySetBitSet(pvGetStructure, getBitSet);
+}
+
+void ChannelPutGetLocal::done(Status const & status,size_t nput)
+{
+    ChannelPutGetRequester::shared_pointer requester = channelPutGetRequester.lock();
+    if(!requester) return;
+    for(size_t i=0; i<nput; ++i) {
+        requester->putGetDone(status,getPtrSelf(),pvGetStructure,getBitSet);
+    }
+}
+
 void ChannelPutGetLocal::getPut()
 {
     ChannelPutGetRequester::shared_pointer requester = channelPutGetRequester.lock();
@@ -1177,7 +1520,7 @@ void ChannelArrayLocal::putArray(
     const char *exceptionMessage = NULL;
     try {
         epicsGuard <PVRecord> guard(*pvr);
-        copy(pvArray,0,1,this->pvArray,offset,stride,count);
+        pvr->putArrayRange(this->pvArray,pvArray,offset,count,stride);
     } catch(std::exception& e) {
         exceptionMessage = e.what();
     }
@@ -10,6 +10,7 @@
  */
 
 #include <sstream>
+#include <map>
 
 #include <epicsGuard.h>
 #include <pv/thread.h>
@@ -19,6 +20,7 @@
 #define epicsExportSharedSymbols
 
 #include <pv/channelProviderLocal.h>
+#include <pv/pvCompiledRequest.h>
 
 using namespace epics::pvData;
 using namespace epics::pvAccess;
@@ -145,6 +147,10 @@ public:
     virtual void dataPut(
         PVRecordStructurePtr const & requested,
         PVRecordFieldPtr const & pvRecordField);
+    virtual void dataPutRange(
+        PVRecordFieldPtr const & pvRecordField,
+        size_t first,
+        size_t count);
     virtual void beginGroupPut(PVRecordPtr const & pvRecord);
     virtual void endGroupPut(PVRecordPtr const & pvRecord);
     virtual void unlisten(PVRecordPtr const & pvRecord);
@@ -166,6 +172,14 @@ private:
     PVCopyPtr pvCopy;
     MonitorElementQueuePtr queue;
     MonitorElementPtr activeElement;
+    // changed array ranges for the pvStructure of each queue element
+    typedef std::map<MonitorElement *,ChangedArrayRangesPtr> ArrayRangesMap;
+    ArrayRangesMap arrayRanges;
+    // snapshots for the post-copy filters of each queue element, empty if there are none.
+    // The filters are called by poll, without the record locked.
+    typedef std::map<MonitorElement *,PostCopySnapshotPtr> SnapshotMap;
+    SnapshotMap snapshots;
+    void untrackArrayRange(size_t offset);
     bool isGroupPut;
     bool dataChanged;
     Mutex mutex;
@@ -208,6 +222,9 @@ Status MonitorLocal::start()
     Lock xx(mutex);
     state = active;
     queue->clear();
+    for(ArrayRangesMap::iterator iter = arrayRanges.begin(); iter!=arrayRanges.end(); ++iter) {
+        iter->second->untrackAll();
+    }
     isGroupPut = false;
     activeElement = queue->getFree();
     activeElement->changedBitSet->clear();
@@ -238,11 +255,18 @@ MonitorElementPtr MonitorLocal::poll()
     {
         cout << "MonitorLocal::poll state  " << state << endl;
     }
+    MonitorElementPtr monitorElement;
     {
         Lock xx(queueMutex);
         if(state!=active) return NULLMonitorElement;
-        return queue->getUsed();
-    }
+        monitorElement = queue->getUsed();
+    }
+    if(!monitorElement || snapshots.empty()) return monitorElement;
+    pvCopy->runPostCopyFilters(
+        monitorElement->pvStructurePtr,
+        monitorElement->changedBitSet,
+        snapshots[monitorElement.get()]);
+    return monitorElement;
 }
 
 void MonitorLocal::release(MonitorElementPtr const & monitorElement)
@@ -267,8 +291,16 @@ void MonitorLocal::releaseActiveElement()
     {
         Lock xx(queueMutex);
         if(state!=active) return;
-        bool result = pvCopy->updateCopyFromBitSet(activeElement->pvStructurePtr,activeElement->changedBitSet);
-        if(!result) return;
+        bool result = pvCopy->updateCopyFromBitSet(
+            activeElement->pvStructurePtr,
+            activeElement->changedBitSet,
+            arrayRanges[activeElement.get()],
+            snapshots.empty() ? PostCopySnapshotPtr() : snapshots[activeElement.get()]);
+        if(!result) {
+            // the filters removed every change, so the element is not released
+            activeElement->overrunBitSet->clear();
+            return;
+        }
         MonitorElementPtr newActive = queue->getFree();
         if(!newActive) return;
         BitSetUtil::compress(activeElement->changedBitSet,activeElement->pvStructurePtr);
@@ -299,6 +331,37 @@ void MonitorLocal::dataPut(PVRecordFieldPtr const & pvRecordField)
         bool isSet = changedBitSet->get(offset);
         changedBitSet->set(offset);
         if(isSet) overrunBitSet->set(offset);
+        untrackArrayRange(offset);
+        dataChanged = true;
+    }
+    if(!isGroupPut) {
+        releaseActiveElement();
+        dataChanged = false;
+    }
+}
+
+void MonitorLocal::dataPutRange(
+    PVRecordFieldPtr const & pvRecordField,
+    size_t first,
+    size_t count)
+{
+    if(pvRecord->getTraceLevel()>1)
+    {
+        cout << "PVCopyMonitor::dataPutRange(pvRecordField,first,count)" << endl;
+    }
+    if(state!=active) return;
+    {
+        Lock xx(mutex);
+        size_t offset = pvCopy->getCopyOffset(pvRecordField->getPVField());
+        BitSetPtr const &changedBitSet = activeElement->changedBitSet;
+        BitSetPtr const &overrunBitSet = activeElement->overrunBitSet;
+        bool isSet = changedBitSet->get(offset);
+        changedBitSet->set(offset);
+        if(isSet) overrunBitSet->set(offset);
+        // each element has to catch up with all changes since it was last updated
+        for(ArrayRangesMap::iterator iter = arrayRanges.begin(); iter!=arrayRanges.end(); ++iter) {
+            iter->second->add(offset,first,count);
+        }
         dataChanged = true;
     }
     if(!isGroupPut) {
@@ -307,6 +370,13 @@ void MonitorLocal::dataPut(PVRecordFieldPtr const & pvRecordField)
     }
 }
 
+void MonitorLocal::untrackArrayRange(size_t offset)
+{
+    for(ArrayRangesMap::iterator iter = arrayRanges.begin(); iter!=arrayRanges.end(); ++iter) {
+        iter->second->untrack(offset);
+    }
+}
+
 void MonitorLocal::dataPut(
         PVRecordStructurePtr const & requested,
         PVRecordFieldPtr const & pvRecordField)
@@ -328,6 +398,7 @@ void MonitorLocal::dataPut(
         bool isSet = changedBitSet->get(offset);
         changedBitSet->set(offset);
         if(isSet) overrunBitSet->set(offset);
+        untrackArrayRange(offset);
         dataChanged = true;
     }
     if(!isGroupPut) {
@@ -392,23 +463,17 @@ bool MonitorLocal::init(PVStructurePtr const & pvRequest)
 {
     PVFieldPtr pvField;
     size_t queueSize = 2;
-    PVStructurePtr pvOptions = pvRequest->getSubField<PVStructure>("record._options");
+    CompiledRequestPtr compiledRequest = CompiledRequest::get(pvRequest);
     MonitorRequesterPtr requester = monitorRequester.lock();
     if(!requester) return false;
-    if(pvOptions) {
-        PVStringPtr pvString  = pvOptions->getSubField<PVString>("queueSize");
-        if(pvString) {
-            try {
-                int32 size;
-                std::stringstream ss;
-                ss << pvString->get();
-                ss >> size;
-                queueSize = size;
-            } catch (...) {
-                 requester->message("queueSize " +pvString->get() + " illegal",errorMessage);
-                 return false;
-            }
+    if(compiledRequest->hasQueueSize()) {
+        if(!compiledRequest->isQueueSizeValid()) {
+            requester->message(
+                "queueSize " + compiledRequest->getQueueSizeString() + " illegal",
+                errorMessage);
+            return false;
         }
+        queueSize = compiledRequest->getQueueSize();
     }
     pvField = pvRequest->getSubField("field");
     if(!pvField) {
@@ -440,6 +505,10 @@ bool MonitorLocal::init(PVStructurePtr const & pvRequest)
          MonitorElementPtr monitorElement(
              new MonitorElement(pvStructure));
          monitorElementArray.push_back(monitorElement);
+         arrayRanges[monitorElement.get()] =
+             ChangedArrayRangesPtr(new ChangedArrayRanges());
+         PostCopySnapshotPtr snapshot(pvCopy->createPostCopySnapshot());
+         if(snapshot) snapshots[monitorElement.get()] = snapshot;
     }
     queue = MonitorElementQueuePtr(new MonitorElementQueue(monitorElementArray));
     requester->monitorConnect(
@@ -0,0 +1,319 @@
+/*perfPlugin.cpp */
+/**
+ * Copyright - See the COPYRIGHT that is included with this distribution.
+ * EPICS pvData is distributed subject to a Software License Agreement found
+ * in file LICENSE that is included with this distribution.
+ */
+/**
+ * Performance measurements for PVCopy and the plugins.
+ * This is not a regression test and is not part of runtests.
+ */
+#include <testMain.h>
+
+#include <cstddef>
+#include <cmath>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include <epicsTime.h>
+#include <epicsThread.h>
+
+#include <pv/standardField.h>
+#include <pv/standardPVField.h>
+#include <pv/channelProviderLocal.h>
+#include <pv/pvStructureCopy.h>
+#include <pv/pvDatabase.h>
+#include <pv/pvClock.h>
+#include "putRequester.h"
+
+using namespace std;
+using std::tr1::static_pointer_cast;
+using namespace epics::pvData;
+using namespace epics::pvAccess;
+using namespace epics::pvCopy;
+using namespace epics::pvDatabase;
+
+static double secondsSince(epicsTimeStamp const & start)
+{
+    epicsTimeStamp now;
+    epicsTimeGetCurrent(&now);
+    return epicsTimeDiffInSeconds(&now,&start);
+}
+
+static void report(string const & what,size_t ntimes,double seconds)
+{
+    cout << what << " " << (seconds/ntimes)*1e3 << " milliseconds per update" << endl;
+}
+
+static PVStructurePtr createDoubleArray(size_t n)
+{
+    PVStructurePtr pvStructure(getStandardPVField()->scalarArray(pvDouble,""));
+    shared_vector<double> values(n);
+    for(size_t i=0; i<n; ++i) values[i] = i;
+    pvStructure->getSubField<PVDoubleArray>("value")->replace(freeze(values));
+    return pvStructure;
+}
+
+static void arrayPerf(string const & request,size_t n,size_t ntimes)
+{
+    PVStructurePtr pvMaster(createDoubleArray(n));
+    PVStructurePtr pvRequest(CreateRequest::create()->createRequest(request));
+    PVCopyPtr pvCopy(PVCopy::create(pvMaster,pvRequest,""));
+    PVStructurePtr pvStructureCopy(pvCopy->createPVStructure());
+    BitSetPtr bitSet(new BitSet(pvStructureCopy->getNumberFields()));
+    epicsTimeStamp start;
+    epicsTimeGetCurrent(&start);
+    for(size_t i=0; i<ntimes; ++i) {
+        bitSet->clear();
+        pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    }
+    report(request + " toCopy",ntimes,secondsSince(start));
+    epicsTimeGetCurrent(&start);
+    for(size_t i=0; i<ntimes; ++i) {
+        bitSet->set(pvStructureCopy->getSubField("value")->getFieldOffset());
+        pvCopy->updateMaster(pvStructureCopy,bitSet);
+    }
+    report(request + " toMaster",ntimes,secondsSince(start));
+}
+
+// a slowly varying int32 array, like an ADC trace
+static void compressPerf(size_t n,size_t ntimes)
+{
+    PVStructurePtr pvMaster(getStandardPVField()->scalarArray(pvInt,""));
+    shared_vector<int32> values(n);
+    for(size_t i=0; i<n; ++i) values[i] = 1000 + static_cast<int32>((i/100)%50) + static_cast<int32>(i%3);
+    pvMaster->getSubField<PVIntArray>("value")->replace(freeze(values));
+    PVStructurePtr pvRequest(CreateRequest::create()->createRequest("value[compress=delta]"));
+    PVCopyPtr pvCopy(PVCopy::create(pvMaster,pvRequest,""));
+    PVStructurePtr pvStructureCopy(pvCopy->createPVStructure());
+    BitSetPtr bitSet(new BitSet(pvStructureCopy->getNumberFields()));
+    epicsTimeStamp start;
+    epicsTimeGetCurrent(&start);
+    for(size_t i=0; i<ntimes; ++i) {
+        bitSet->clear();
+        pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    }
+    double seconds = secondsSince(start);
+    report("compress=delta encode",ntimes,seconds);
+    cout << "    " << (n*sizeof(int32)*ntimes)/seconds/1e6 << " MB/s"
+         << " ratio " << double(n*sizeof(int32))
+             / pvStructureCopy->getSubField<PVUByteArray>("value")->getLength()
+         << endl;
+    epicsTimeGetCurrent(&start);
+    for(size_t i=0; i<ntimes; ++i) {
+        bitSet->set(pvStructureCopy->getSubField("value")->getFieldOffset());
+        pvCopy->updateMaster(pvStructureCopy,bitSet);
+    }
+    seconds = secondsSince(start);
+    report("compress=delta decode",ntimes,seconds);
+    cout << "    " << (n*sizeof(int32)*ntimes)/seconds/1e6 << " MB/s" << endl;
+}
+
+// ncopy deadbanded copies of one record, like ncopy monitors of the record
+static void deadbandPerf(string const & request,ScalarType scalarType,size_t ncopy,size_t ntimes)
+{
+    PVStructurePtr pvMaster(getStandardPVField()->scalar(scalarType,""));
+    PVScalarPtr pvValue(pvMaster->getSubField<PVScalar>("value"));
+    PVStructurePtr pvRequest(CreateRequest::create()->createRequest(request));
+    vector<PVCopyPtr> pvCopys(ncopy);
+    vector<PVStructurePtr> pvStructureCopys(ncopy);
+    vector<BitSetPtr> bitSets(ncopy);
+    for(size_t i=0; i<ncopy; ++i) {
+        pvCopys[i] = PVCopy::create(pvMaster,pvRequest,"");
+        pvStructureCopys[i] = pvCopys[i]->createPVStructure();
+        bitSets[i] = BitSetPtr(new BitSet(pvStructureCopys[i]->getNumberFields()));
+    }
+    size_t nreport = 0;
+    epicsTimeStamp start;
+    epicsTimeGetCurrent(&start);
+    for(size_t i=0; i<ntimes; ++i) {
+        pvValue->putFrom<double>(static_cast<double>(i%10));
+        for(size_t j=0; j<ncopy; ++j) {
+            if(pvCopys[j]->updateCopySetBitSet(pvStructureCopys[j],bitSets[j])) ++nreport;
+        }
+    }
+    double seconds = secondsSince(start);
+    report(request + " " + ScalarTypeFunc::name(scalarType),ntimes,seconds);
+    cout << "    " << (seconds/(ntimes*ncopy))*1e9 << " nanoseconds per copy"
+         << " reported " << nreport << endl;
+}
+
+// process a record with a timeStamp, ncycle processes per PVClock cycle
+static void processPerf(string const & what,size_t ncycle,size_t ntimes)
+{
+    PVStructurePtr pvStructure(getStandardPVField()->scalar(pvDouble,"timeStamp"));
+    PVRecordPtr pvRecord(PVRecord::create("processPerf",pvStructure));
+    epicsTimeStamp start;
+    epicsTimeGetCurrent(&start);
+    for(size_t i=0; i<ntimes; i+=ncycle) {
+        PVClockCycle cycle;
+        for(size_t j=0; j<ncycle; ++j) pvRecord->process();
+    }
+    double seconds = secondsSince(start);
+    cout << what << " " << (seconds/ntimes)*1e9 << " nanoseconds per process" << endl;
+}
+
+class CalcRecord;
+typedef std::tr1::shared_ptr<CalcRecord> CalcRecordPtr;
+
+// a record with a process that computes every element of its value, like a calculated record
+class CalcRecord : public PVRecord
+{
+public:
+    POINTER_DEFINITIONS(CalcRecord);
+    static CalcRecordPtr create(string const & recordName,PVStructurePtr const & pvStructure)
+    {
+        CalcRecordPtr pvRecord(new CalcRecord(recordName,pvStructure));
+        if(!pvRecord->init()) pvRecord.reset();
+        return pvRecord;
+    }
+    virtual void process()
+    {
+        PVDoubleArrayPtr pvValue(getPVStructure()->getSubField<PVDoubleArray>("value"));
+        shared_vector<double> values(pvValue->reuse());
+        for(size_t i=0; i<values.size(); ++i) values[i] = sin(values[i] + 1.0);
+        pvValue->replace(freeze(values));
+        PVRecord::process();
+    }
+private:
+    CalcRecord(string const & recordName,PVStructurePtr const & pvStructure)
+    : PVRecord(recordName,pvStructure)
+    {}
+};
+
+// nclient clients do a get with process of a calculated record once per poll cycle
+static void processWindowPerf(size_t nclient,double window,size_t ncycle)
+{
+    CalcRecordPtr pvRecord(CalcRecord::create("processWindowPerf",createDoubleArray(100000)));
+    pvRecord->setProcessWindow(window);
+    PVStructurePtr pvRequest(CreateRequest::create()->createRequest("value"));
+    vector<PVCopyPtr> pvCopys(nclient);
+    vector<PVStructurePtr> pvStructureCopys(nclient);
+    vector<BitSetPtr> bitSets(nclient);
+    for(size_t i=0; i<nclient; ++i) {
+        pvCopys[i] = PVCopy::create(pvRecord->getPVStructure(),pvRequest,"");
+        pvStructureCopys[i] = pvCopys[i]->createPVStructure();
+        bitSets[i] = BitSetPtr(new BitSet(pvStructureCopys[i]->getNumberFields()));
+    }
+    size_t nprocess = 0;
+    clock_t cpu = 0;
+    for(size_t i=0; i<ncycle; ++i) {
+        clock_t start = clock();
+        for(size_t j=0; j<nclient; ++j) {
+            pvRecord->lock();
+            if(pvRecord->isProcessForGetDue()) {
+                pvRecord->beginGroupPut();
+                pvRecord->process();
+                pvRecord->endGroupPut();
+                ++nprocess;
+            }
+            bitSets[j]->clear();
+            pvCopys[j]->updateCopySetBitSet(pvStructureCopys[j],bitSets[j]);
+            pvRecord->unlock();
+        }
+        cpu += clock() - start;
+        epicsThreadSleep(0.02);
+    }
+    cout << nclient << " clients, window " << window*1e3 << " ms: "
+         << (double(cpu)/CLOCKS_PER_SEC/ncycle)*1e3 << " milliseconds CPU per poll cycle, "
+         << double(nprocess)/ncycle << " process per poll cycle" << endl;
+}
+
+// bursts of puts from nchannel clients to a calculated record, with and without the put queue
+static void putQueuePerf(size_t nchannel,size_t burst,bool queuePuts,size_t nput)
+{
+    PVDatabasePtr master(PVDatabase::getMaster());
+    CalcRecordPtr pvRecord(CalcRecord::create("putQueuePerf",createDoubleArray(1000)));
+    pvRecord->setQueuePuts(queuePuts);
+    master->addRecord(pvRecord);
+    vector<PutRequesterPtr> requesters;
+    for(size_t k=0; k<nchannel; ++k) {
+        PutRequesterPtr requester(PutRequester::create("putQueuePerf","value"));
+        PVDoubleArrayPtr pvValue(requester->getPVStructure()->getSubField<PVDoubleArray>("value"));
+        shared_vector<double> values(1000,1.0);
+        pvValue->replace(freeze(values));
+        requester->getBitSet()->set(pvValue->getFieldOffset());
+        requesters.push_back(requester);
+    }
+    epicsTimeStamp start;
+    epicsTimeGetCurrent(&start);
+    for(size_t i=0; i<nput; i+=burst) {
+        for(size_t k=0; k<nchannel; ++k) {
+            for(size_t j=0; j<burst; ++j) requesters[k]->put();
+        }
+        for(size_t k=0; k<nchannel; ++k) requesters[k]->waitPutDone(i + burst);
+    }
+    double seconds = secondsSince(start);
+    cout << nchannel << " channels burst " << burst << (queuePuts ? " queued: " : " synchronous: ")
+         << nchannel*nput/seconds << " puts per second" << endl;
+    master->removeRecord(pvRecord);
+}
+
+MAIN(perfPlugin)
+{
+    PVDatabasePtr pvDatabase(PVDatabase::getMaster());
+    size_t n = 1000000;
+    size_t ntimes = 100;
+    cout << "array plugin, " << n << " doubles" << endl;
+    arrayPerf("value[array=0:1:999999]",n,ntimes);
+    arrayPerf("value[array=0:2:999999]",n,ntimes);
+    arrayPerf("value[array=0:10:999999]",n,ntimes);
+    arrayPerf("value[array=0:1000:999999]",n,ntimes);
+    cout << "decimate plugin, " << n << " doubles" << endl;
+    arrayPerf("value[decimate=minmax:2000]",n,ntimes);
+    arrayPerf("value[decimate=minmax:100000]",n,ntimes);
+    cout << "compress plugin, " << n << " ints" << endl;
+    compressPerf(n,ntimes);
+    cout << "stats plugin, " << n << " doubles" << endl;
+    arrayPerf("value[stats=samples:1]",n,ntimes);
+    cout << "histogram plugin, " << n << " doubles" << endl;
+    arrayPerf("value[histogram=0:1000000:100]",n,ntimes);
+    arrayPerf("value[histogram=0:1000000:10000]",n,ntimes);
+    cout << "quantile plugin, " << n << " doubles" << endl;
+    arrayPerf("value[quantile=0.5]",n,ntimes);
+    arrayPerf("value[quantile=0.5:0.99:0.999]",n,ntimes);
+    cout << "quantize plugin, " << n << " doubles" << endl;
+    arrayPerf("value[quantize=float]",n,ntimes);
+    arrayPerf("value[quantize=int16]",n,ntimes);
+    arrayPerf("value[quantize=int8:0:1000000]",n,ntimes);
+    cout << "peaks plugin, " << n << " doubles" << endl;
+    arrayPerf("value[peaks=0:10:100]",n,ntimes);
+    cout << "spectrum plugin" << endl;
+    for(size_t length=4096; length<=1048576; length*=4) {
+        cout << length << " doubles" << endl;
+        arrayPerf("value[spectrum=power:hann]",length,ntimes);
+    }
+    cout << "1000000 doubles" << endl;
+    arrayPerf("value[spectrum=power:hann]",1000000,ntimes);
+    size_t ncopy = 100000;
+    cout << "deadband plugin, " << ncopy << " copies of one record" << endl;
+    deadbandPerf("value[deadband=abs:5.0]",pvDouble,ncopy,ntimes);
+    deadbandPerf("value[deadband=rel:50.0]",pvDouble,ncopy,ntimes);
+    deadbandPerf("value[deadband=abs:5.0]",pvInt,ncopy,ntimes);
+    deadbandPerf("value[deadband=rel:50.0]",pvInt,ncopy,ntimes);
+    size_t nprocess = 1000000;
+    cout << "PVRecord::process with timeStamp" << endl;
+    processPerf("clock read each process",1,nprocess);
+    processPerf("clock read once per 100 processes",100,nprocess);
+    PVClock::setMonotonic(true);
+    processPerf("monotonic clock each process",1,nprocess);
+    PVClock::setMonotonic(false);
+    cout << "get with process of a calculated record, 100000 doubles, 20 ms poll cycle" << endl;
+    for(size_t nclient=1; nclient<=50; nclient = (nclient==1) ? 10 : nclient + 40) {
+        processWindowPerf(nclient,0.0,50);
+        processWindowPerf(nclient,0.01,50);
+    }
+    cout << "put of a calculated record, 1000 doubles" << endl;
+    for(size_t burst=1; burst<=1000; burst*=10) {
+        putQueuePerf(1,burst,false,10000);
+        putQueuePerf(1,burst,true,10000);
+    }
+    // like remote clients, each channel has one put at a time
+    for(size_t nchannel=10; nchannel<=1000; nchannel*=10) {
+        putQueuePerf(nchannel,1,false,10000/nchannel);
+        putQueuePerf(nchannel,1,true,10000/nchannel);
+    }
+    return 0;
+}
@@ -0,0 +1,153 @@
+/* putRequester.h */
+/**
+ * Copyright - See the COPYRIGHT that is included with this distribution.
+ * EPICS pvData is distributed subject to a Software License Agreement found
+ * in file LICENSE that is included with this distribution.
+ */
+#ifndef PUTREQUESTER_H
+#define PUTREQUESTER_H
+
+
+#ifdef epicsExportSharedSymbols
+#   define putRequesterEpicsExportSharedSymbols
+#   undef epicsExportSharedSymbols
+#endif
+
+#include <pv/pvData.h>
+#include <pv/lock.h>
+#include <pv/event.h>
+#include <pv/createRequest.h>
+#include <pv/pvAccess.h>
+#include <pv/channelProviderLocal.h>
+
+#ifdef putRequesterEpicsExportSharedSymbols
+#   define epicsExportSharedSymbols
+#	undef putRequesterEpicsExportSharedSymbols
+#endif
+
+#include <shareLib.h>
+
+namespace epics { namespace pvDatabase {
+
+class PutRequester;
+typedef std::tr1::shared_ptr<PutRequester> PutRequesterPtr;
+
+/*
+ * A channelPut of the local provider that counts the putDone calls.
+ */
+class PutRequester :
+    public epics::pvAccess::ChannelRequester,
+    public epics::pvAccess::ChannelPutRequester
+{
+public:
+    POINTER_DEFINITIONS(PutRequester);
+    static PutRequesterPtr create(
+        std::string const & recordName,
+        std::string const & request)
+    {
+        PutRequesterPtr requester(new PutRequester());
+        epics::pvAccess::ChannelRequester::shared_pointer channelRequester(requester);
+        epics::pvAccess::ChannelPutRequester::shared_pointer channelPutRequester(requester);
+        requester->channel = getChannelProviderLocal()->createChannel(recordName,channelRequester,0);
+        requester->channel->createChannelPut(
+            channelPutRequester,
+            epics::pvData::CreateRequest::create()->createRequest(request));
+        return requester;
+    }
+    virtual std::string getRequesterName() { return "putRequester";}
+    virtual void channelCreated(
+        epics::pvData::Status const & status,
+        epics::pvAccess::Channel::shared_pointer const & channel)
+    {}
+    virtual void channelStateChange(
+        epics::pvAccess::Channel::shared_pointer const & channel,
+        epics::pvAccess::Channel::ConnectionState connectionState)
+    {}
+    virtual void channelPutConnect(
+        epics::pvData::Status const & status,
+        epics::pvAccess::ChannelPut::shared_pointer const & channelPut,
+        epics::pvData::StructureConstPtr const & structure)
+    {
+        this->channelPut = channelPut;
+        pvStructure = epics::pvData::getPVDataCreate()->createPVStructure(structure);
+        bitSet = epics::pvData::BitSetPtr(new epics::pvData::BitSet(pvStructure->getNumberFields()));
+    }
+    virtual void putDone(
+        epics::pvData::Status const & status,
+        epics::pvAccess::ChannelPut::shared_pointer const & channelPut)
+    {
+        {
+            epics::pvData::Lock lock(mutex);
+            ++nputDone;
+            if(!status.isOK()) ++nerror;
+        }
+        event.signal();
+    }
+    virtual void getDone(
+        epics::pvData::Status const & status,
+        epics::pvAccess::ChannelPut::shared_pointer const & channelPut,
+        epics::pvData::PVStructurePtr const & pvStructure,
+        epics::pvData::BitSetPtr const & bitSet)
+    {}
+    /*
+     * Put a value into field value.
+     */
+    template<typename PVT>
+    void put(typename PVT::value_type value)
+    {
+        std::tr1::shared_ptr<PVT> pvValue(pvStructure->getSubField<PVT>("value"));
+        pvValue->put(value);
+        bitSet->clear();
+        bitSet->set(pvValue->getFieldOffset());
+        channelPut->put(pvStructure,bitSet);
+    }
+    /*
+     * Put the current pvStructure with the bitSet that the caller set.
+     */
+    void put()
+    {
+        channelPut->put(pvStructure,bitSet);
+    }
+    /*
+     * Wait until there have been nput calls of putDone.
+     */
+    void waitPutDone(std::size_t nput)
+    {
+        while(true) {
+            {
+                epics::pvData::Lock lock(mutex);
+                if(nputDone>=nput) return;
+            }
+            event.wait();
+        }
+    }
+    std::size_t getPutDone()
+    {
+        epics::pvData::Lock lock(mutex);
+        return nputDone;
+    }
+    std::size_t getErrors()
+    {
+        epics::pvData::Lock lock(mutex);
+        return nerror;
+    }
+    epics::pvData::PVStructurePtr getPVStructure() { return pvStructure;}
+    epics::pvData::BitSetPtr getBitSet() { return bitSet;}
+private:
+    PutRequester()
+    : nputDone(0),
+      nerror(0)
+    {}
+    epics::pvAccess::Channel::shared_pointer channel;
+    epics::pvAccess::ChannelPut::shared_pointer channelPut;
+    epics::pvData::PVStructurePtr pvStructure;
+    epics::pvData::BitSetPtr bitSet;
+    epics::pvData::Mutex mutex;
+    epics::pvData::Event event;
+    std::size_t nputDone;
+    std::size_t nerror;
+};
+
+}}
+
+#endif  /* PUTREQUESTER_H */
@@ -34,6 +34,7 @@
 #include <pv/serverContext.h>
 #include "recordClient.h"
 #include "listener.h"
+#include "putRequester.h"
 
 using namespace std;
 using std::tr1::static_pointer_cast;
@@ -43,6 +44,87 @@ using namespace epics::pvDatabase;
 
 static bool debug = false;
 
+class CountRecord;
+typedef std::tr1::shared_ptr<CountRecord> CountRecordPtr;
+
+/*
+ * A record that counts the calls of process.
+ */
+class CountRecord :
+    public PVRecord
+{
+public:
+    POINTER_DEFINITIONS(CountRecord);
+    static CountRecordPtr create(
+        string const & recordName,
+        PVStructurePtr const & pvStructure)
+    {
+        CountRecordPtr pvRecord(new CountRecord(recordName,pvStructure));
+        if(!pvRecord->init()) pvRecord.reset();
+        return pvRecord;
+    }
+    virtual void process()
+    {
+        ++nprocess;
+        PVRecord::process();
+    }
+    size_t getProcessCount()
+    {
+        lock();
+        size_t result = nprocess;
+        unlock();
+        return result;
+    }
+private:
+    CountRecord(
+        string const & recordName,
+        PVStructurePtr const & pvStructure)
+    : PVRecord(recordName,pvStructure),
+      nprocess(0)
+    {}
+    size_t nprocess;
+};
+
+class CountListener;
+typedef std::tr1::shared_ptr<CountListener> CountListenerPtr;
+
+/*
+ * A listener that counts the puts of one field of a record.
+ */
+class CountListener :
+    public PVListener
+{
+public:
+    POINTER_DEFINITIONS(CountListener);
+    static CountListenerPtr create(
+        PVRecordPtr const & pvRecord,
+        string const & fieldName)
+    {
+        PVStructurePtr pvStructure(pvRecord->getPVRecordStructure()->getPVStructure());
+        CountListenerPtr listener(new CountListener());
+        epics::pvCopy::PVCopyPtr pvCopy(epics::pvCopy::PVCopy::create(
+            pvStructure,
+            CreateRequest::create()->createRequest(fieldName),
+            ""));
+        pvRecord->addListener(listener,pvCopy);
+        return listener;
+    }
+    virtual void detach(PVRecordPtr const & pvRecord) {}
+    virtual void dataPut(PVRecordFieldPtr const & pvRecordField) { ++nput;}
+    virtual void dataPut(
+        PVRecordStructurePtr const & requested,
+        PVRecordFieldPtr const & pvRecordField) {}
+    virtual void beginGroupPut(PVRecordPtr const & pvRecord) {}
+    virtual void endGroupPut(PVRecordPtr const & pvRecord) {}
+    virtual void unlisten(PVRecordPtr const & pvRecord) {}
+    // Called with the record locked.
+    size_t getPutCount() { return nput;}
+private:
+    CountListener()
+    : nput(0)
+    {}
+    size_t nput;
+};
 
 static void test()
 {
@@ -73,10 +155,111 @@ static void test()
     if(debug) {cout << "processed exampleDouble "  << endl; }
 }
 
+static void queuePutsTest()
+{
+    PVDatabasePtr master = PVDatabase::getMaster();
+    PVStructurePtr pvStructure(getStandardPVField()->scalar(pvDouble,"timeStamp"));
+    PVRecordPtr pvRecord(PVRecord::create("queuedDouble",pvStructure));
+    pvRecord->setQueuePuts(true);
+    master->addRecord(pvRecord);
+    PutRequesterPtr first(PutRequester::create("queuedDouble","value"));
+    PutRequesterPtr second(PutRequester::create("queuedDouble","value"));
+    size_t nput = 100;
+    for(size_t i=1; i<=nput; ++i) {
+        first->put<PVDouble>(i);
+        second->put<PVDouble>(nput + i);
+    }
+    first->waitPutDone(nput);
+    second->waitPutDone(nput);
+    testOk1(first->getPutDone()==nput && second->getPutDone()==nput);
+    testOk1(first->getErrors()==0 && second->getErrors()==0);
+    pvRecord->lock();
+    double value = pvStructure->getSubField<PVDouble>("value")->get();
+    pvRecord->unlock();
+    testOk1(value==2.0*nput);
+    master->removeRecord(pvRecord);
+}
+
+static void mergePutsTest()
+{
+    PVDatabasePtr master = PVDatabase::getMaster();
+    PVStructurePtr pvStructure(getStandardPVField()->scalar(pvDouble,""));
+    CountRecordPtr pvRecord(CountRecord::create("mergedDouble",pvStructure));
+    pvRecord->setQueuePuts(true);
+    master->addRecord(pvRecord);
+    CountListenerPtr listener(CountListener::create(pvRecord,"value"));
+    PutRequesterPtr first(PutRequester::create("mergedDouble","value"));
+    PutRequesterPtr second(PutRequester::create("mergedDouble","value"));
+    // the puts of both channels wait while the record is locked
+    size_t nput = 100;
+    pvRecord->lock();
+    for(size_t i=1; i<=nput; ++i) {
+        first->put<PVDouble>(i);
+        second->put<PVDouble>(nput + i);
+    }
+    pvRecord->unlock();
+    first->waitPutDone(nput);
+    second->waitPutDone(nput);
+    testOk1(first->getPutDone()==nput && second->getPutDone()==nput
+        && first->getErrors()==0 && second->getErrors()==0);
+    // a worker may take the first puts before the others arrive,
+    // but each process writes one merged entry for both channels
+    pvRecord->lock();
+    size_t nwrite = listener->getPutCount();
+    double value = pvStructure->getSubField<PVDouble>("value")->get();
+    pvRecord->unlock();
+    size_t nprocess = pvRecord->getProcessCount();
+    if(debug) {cout << "mergePuts nwrite " << nwrite << " nprocess " << nprocess << endl;}
+    testOk1(nwrite==nprocess && nprocess>=1 && nprocess<=2 && value==2.0*nput);
+    // puts with a different skipUnchanged are not merged
+    PutRequesterPtr writing(PutRequester::create("mergedDouble","value"));
+    pvRecord->setSkipUnchanged(true);
+    PutRequesterPtr skipping(PutRequester::create("mergedDouble","value"));
+    pvRecord->lock();
+    skipping->put<PVDouble>(value);
+    writing->put<PVDouble>(value);
+    pvRecord->unlock();
+    skipping->waitPutDone(1);
+    writing->waitPutDone(1);
+    pvRecord->lock();
+    size_t nwriteAfter = listener->getPutCount();
+    pvRecord->unlock();
+    testOk1(nwriteAfter==nwrite + 1 && pvRecord->getProcessCount()==nprocess + 1);
+    master->removeRecord(pvRecord);
+}
+
+static void skipUnchangedPutTest()
+{
+    PVDatabasePtr master = PVDatabase::getMaster();
+    PVStructurePtr pvStructure(getStandardPVField()->scalar(pvDouble,"timeStamp"));
+    CountRecordPtr pvRecord(CountRecord::create("skipDouble",pvStructure));
+    pvRecord->setSkipUnchanged(true);
+    master->addRecord(pvRecord);
+    // a put that writes no field does not process the record
+    PutRequesterPtr requester(PutRequester::create("skipDouble","value"));
+    requester->put<PVDouble>(1.0);
+    requester->waitPutDone(1);
+    requester->put<PVDouble>(1.0);
+    requester->waitPutDone(2);
+    testOk1(requester->getErrors()==0 && pvRecord->getProcessCount()==1);
+    // also when the put is queued
+    pvRecord->setQueuePuts(true);
+    requester = PutRequester::create("skipDouble","value");
+    requester->put<PVDouble>(1.0);
+    requester->waitPutDone(1);
+    requester->put<PVDouble>(2.0);
+    requester->waitPutDone(2);
+    testOk1(requester->getErrors()==0 && pvRecord->getProcessCount()==2);
+    master->removeRecord(pvRecord);
+}
+
 MAIN(testLocalProvider)
 {
-    testPlan(3);
+    testPlan(11);
     test();
+    queuePutsTest();
+    mergePutsTest();
+    skipUnchangedPutTest();
     return 0;
 }
 
@@ -29,6 +29,7 @@
 #include <pv/standardPVField.h>
 #include <pv/channelProviderLocal.h>
 #include <pv/convert.h>
+#include <pv/pvCompiledRequest.h>
 #define epicsExportSharedSymbols
 #include "powerSupply.h"
 
@@ -350,6 +351,119 @@ static void arrayTest()
     testPVScalarArray(valueNameRecord,valueNameCopy,pvRecord,pvCopy);
 }
 
+static void arrayRangeTest()
+{
+    if(debug) {cout << endl << endl << "****arrayRangeTest****" << endl;}
+    size_t n = 10;
+    PVRecordPtr pvRecord = createScalarArray("doubleArrayRecord",pvDouble,"alarm,timeStamp");
+    PVStructurePtr pvStructureRecord = pvRecord->getPVRecordStructure()->getPVStructure();
+    PVDoubleArrayPtr pvValueRecord = pvStructureRecord->getSubField<PVDoubleArray>("value");
+    shared_vector<double> values(n);
+    for(size_t i=0; i<n; i++) values[i] = i;
+    pvValueRecord->replace(freeze(values));
+    PVStructurePtr pvRequest = CreateRequest::create()->createRequest("value");
+    PVCopyPtr pvCopy = PVCopy::create(pvStructureRecord,pvRequest,"");
+    PVStructurePtr pvStructureCopy = pvCopy->createPVStructure();
+    PVDoubleArrayPtr pvValueCopy = pvStructureCopy->getSubField<PVDoubleArray>("value");
+    size_t offset = pvValueCopy->getFieldOffset();
+    BitSetPtr bitSet(new BitSet(pvStructureCopy->getNumberFields()));
+    ChangedArrayRangesPtr arrayRanges(new ChangedArrayRanges());
+    arrayRanges->add(offset,0,1);
+    testOk1(arrayRanges->getRanges(offset)==0);
+    bitSet->set(0);
+    pvCopy->updateCopyFromBitSet(pvStructureCopy,bitSet,arrayRanges);
+    testOk1(pvValueCopy->view()[9]==9.0);
+    testOk1(arrayRanges->getRanges(offset)!=0 && arrayRanges->getRanges(offset)->size()==0);
+    arrayRanges->add(offset,2,2);
+    arrayRanges->add(offset,4,1);
+    arrayRanges->add(offset,7,1);
+    const ChangedArrayRanges::RangeArray * ranges = arrayRanges->getRanges(offset);
+    testOk1(ranges->size()==2);
+    testOk1((*ranges)[0].first==2 && (*ranges)[0].count==3);
+    arrayRanges->untrack(offset);
+    arrayRanges->track(offset);
+    // put 100,101 at elements 2,3 and modify element 5 without reporting it
+    shared_vector<double> put(2);
+    put[0] = 100.0; put[1] = 101.0;
+    PVDoubleArrayPtr pvPut = getPVDataCreate()->createPVScalarArray<PVDoubleArray>();
+    pvPut->replace(freeze(put));
+    pvRecord->lock();
+    pvRecord->putArrayRange(pvValueRecord,pvPut,2,2,1);
+    pvRecord->unlock();
+    values = pvValueRecord->reuse();
+    values[5] = 55.0;
+    pvValueRecord->replace(freeze(values));
+    arrayRanges->add(offset,2,2);
+    bitSet->clear();
+    bitSet->set(offset);
+    pvCopy->updateCopyFromBitSet(pvStructureCopy,bitSet,arrayRanges);
+    testOk1(pvValueCopy->view()[2]==100.0 && pvValueCopy->view()[3]==101.0);
+    testOk1(pvValueCopy->view()[5]==5.0);
+    testOk1(arrayRanges->getRanges(offset)->size()==0);
+    arrayRanges->untrack(offset);
+    pvCopy->updateCopyFromBitSet(pvStructureCopy,bitSet,arrayRanges);
+    testOk1(pvValueCopy->view()[5]==55.0);
+}
+
+static void compiledRequestTest()
+{
+    if(debug) {cout << endl << endl << "****compiledRequestTest****" << endl;}
+    CreateRequest::shared_pointer createRequest = CreateRequest::create();
+    string request("record[process=true,queueSize=5,nProcess=3]field(value[array=1:3],alarm)");
+    CompiledRequestPtr compiled = CompiledRequest::get(createRequest->createRequest(request));
+    testOk1(compiled->getProcess(false));
+    testOk1(compiled->getNProcess()==3);
+    testOk1(compiled->hasQueueSize() && compiled->getQueueSize()==5);
+    testOk1(CompiledRequest::get(createRequest->createRequest(request))==compiled);
+    request = "record[queueSize=abc]field(value)";
+    compiled = CompiledRequest::get(createRequest->createRequest(request));
+    testOk1(!compiled->getProcess(false) && compiled->getProcess(true));
+    testOk1(compiled->hasQueueSize() && !compiled->isQueueSizeValid());
+    PVStructurePtr pvRequest = createRequest->createRequest("value[array=1:3,ignore=true]");
+    compiled = CompiledRequest::get(pvRequest);
+    const CompiledRequest::FieldOptionArray * options =
+        compiled->getFieldOptions(pvRequest->getSubField<PVStructure>("field.value._options"));
+    testOk1(options && options->size()==2);
+    testOk1(options && (*options)[0].pvPlugin && !(*options)[1].pvPlugin);
+}
+
+static void skipUnchangedTest()
+{
+    if(debug) {cout << endl << endl << "****skipUnchangedTest****" << endl;}
+    CreateRequest::shared_pointer createRequest = CreateRequest::create();
+    CompiledRequestPtr compiled = CompiledRequest::get(
+        createRequest->createRequest("record[skipUnchanged=true]field(value)"));
+    CompiledRequestPtr compiledDefault = CompiledRequest::get(
+        createRequest->createRequest("field(value)"));
+    testOk1(compiled->getSkipUnchanged(false)
+        && !compiledDefault->getSkipUnchanged(false) && compiledDefault->getSkipUnchanged(true));
+    size_t n = 1000;
+    PVRecordPtr pvRecord = createScalarArray("skipUnchangedRecord",pvDouble,"alarm,timeStamp");
+    PVStructurePtr pvStructureRecord = pvRecord->getPVRecordStructure()->getPVStructure();
+    PVDoubleArrayPtr pvValueRecord = pvStructureRecord->getSubField<PVDoubleArray>("value");
+    shared_vector<double> values(n);
+    for(size_t i=0; i<n; i++) values[i] = i;
+    pvValueRecord->replace(freeze(values));
+    const double * data = pvValueRecord->view().data();
+    PVCopyPtr pvCopy = PVCopy::create(pvStructureRecord,createRequest->createRequest("value"),"");
+    PVStructurePtr pvStructureCopy = pvCopy->createPVStructure();
+    PVDoubleArrayPtr pvValueCopy = pvStructureCopy->getSubField<PVDoubleArray>("value");
+    BitSetPtr bitSet(new BitSet(pvStructureCopy->getNumberFields()));
+    // the same values in another array are not written
+    values = shared_vector<double>(n);
+    for(size_t i=0; i<n; i++) values[i] = i;
+    pvValueCopy->replace(freeze(values));
+    bitSet->set(pvValueCopy->getFieldOffset());
+    bool written = pvCopy->updateMaster(pvStructureCopy,bitSet,true);
+    testOk1(!written && pvValueRecord->view().data()==data);
+    // a changed element is
+    values = pvValueCopy->reuse();
+    values[n-1] = -1.0;
+    pvValueCopy->replace(freeze(values));
+    written = pvCopy->updateMaster(pvStructureCopy,bitSet,true);
+    testOk1(written && pvValueRecord->view().data()!=data && pvValueRecord->view()[n-1]==-1.0);
+}
+
 static void powerSupplyTest()
 {
     if(debug) {cout << endl << endl << "****powerSupplyTest****" << endl;}
@@ -395,9 +509,13 @@ static void powerSupplyTest()
 
 MAIN(testPVCopy)
 {
-    testPlan(67);
+    testPlan(87);
+    PVDatabase::getMaster();
     scalarTest();
     arrayTest();
+    arrayRangeTest();
+    compiledRequestTest();
+    skipUnchangedTest();
     powerSupplyTest();
     return 0;
 }
@@ -19,8 +19,10 @@
 #include <cstdio>
 #include <memory>
 #include <iostream>
+#include <stdexcept>
 
 #include <epicsStdio.h>
+#include <epicsGuard.h>
 #include <epicsMutex.h>
 #include <epicsEvent.h>
 #include <epicsThread.h>
@@ -29,6 +31,7 @@
 #include <pv/standardPVField.h>
 #include <pv/pvData.h>
 #include <pv/pvStructureCopy.h>
+#include <pv/pvClock.h>
 #define epicsExportSharedSymbols
 #include "powerSupply.h"
 
@@ -95,12 +98,51 @@ static void powerSupplyTest()
     }
 }
 
+static void processWindowTest()
+{
+    if(debug) {cout << endl << endl << "****processWindowTest****" << endl; }
+    PVRecordPtr pvRecord = createScalar("processWindowRecord",pvDouble,"timeStamp");
+    bool first = pvRecord->isProcessForGetDue();
+    bool second = pvRecord->isProcessForGetDue();
+    testOk1(first && second);
+    pvRecord->setProcessWindow(100.0);
+    first = pvRecord->isProcessForGetDue();
+    second = pvRecord->isProcessForGetDue();
+    testOk1(first && !second && pvRecord->getProcessWindow()==100.0);
+    pvRecord->setProcessWindow(1e300);
+    double window = pvRecord->getProcessWindow();
+    testOk1(window>1e9-1.0 && window<1e9+1.0);
+    pvRecord->setProcessWindow(-1.0);
+    testOk1(pvRecord->getProcessWindow()==0.0 && pvRecord->isProcessForGetDue());
+}
+
+static void groupPutTest()
+{
+    if(debug) {cout << endl << endl << "****groupPutTest****" << endl; }
+    PVRecordPtr pvRecord = createScalar("groupPutRecord",pvDouble,"timeStamp");
+    try {
+        epicsGuard<PVRecord> guard(*pvRecord);
+        PVGroupPut groupPut(*pvRecord);
+        pvRecord->process();
+        throw std::runtime_error("process failed");
+    } catch(std::exception &) {}
+    // the group put ended, so the clock of this thread is not frozen
+    TimeStamp first;
+    TimeStamp second;
+    PVClock::getCurrent(first);
+    epicsThreadSleep(0.01);
+    PVClock::getCurrent(second);
+    testOk1(second>first);
+}
+
 MAIN(testPVRecord)
 {
-    testPlan(3);
+    testPlan(8);
     scalarTest();
     arrayTest();
     powerSupplyTest();
+    processWindowTest();
+    groupPutTest();
     return 0;
 }
 
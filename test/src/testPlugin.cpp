@@ -17,8 +17,10 @@
 #include <cstddef>
 #include <string>
 #include <cstdio>
+#include <cmath>
 #include <memory>
 #include <iostream>
+#include <stdexcept>
 
 #include <epicsStdio.h>
 #include <epicsMutex.h>
@@ -30,9 +32,13 @@
 #include <pv/channelProviderLocal.h>
 #include <pv/convert.h>
 #include <pv/pvStructureCopy.h>
+#include <pv/pvPlugin.h>
+#include <pv/pvTimestampPlugin.h>
 #include <pv/pvDatabase.h>
+#include <pv/pvClock.h>
 #define epicsExportSharedSymbols
 #include "powerSupply.h"
+#include "putRequester.h"
 
 
 using namespace std;
@@ -98,6 +104,139 @@ static void deadbandTest()
     }
     testOk1(result==true);
     testOk1(nset==1);
+    // integer fields are compared in integer arithmetic
+    pvRecordStructure = getStandardPVField()->scalar(pvInt,"");
+    PVIntPtr pvIntValue(pvRecordStructure->getSubField<PVInt>("value"));
+    pvRequest = CreateRequest::create()->createRequest("value[deadband=abs:2.5]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    pvStructureCopy = pvCopy->createPVStructure();
+    bitSet = BitSetPtr(new BitSet(pvStructureCopy->getNumberFields()));
+    pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    pvIntValue->put(2);
+    testOk1(pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet)==false);
+    pvIntValue->put(-3);
+    testOk1(pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet)==true);
+    pvRequest = CreateRequest::create()->createRequest("value[deadband=rel:10]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    pvStructureCopy = pvCopy->createPVStructure();
+    bitSet = BitSetPtr(new BitSet(pvStructureCopy->getNumberFields()));
+    pvIntValue->put(100);
+    pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    pvIntValue->put(109);
+    testOk1(pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet)==false);
+    testOk1(pvStructureCopy->getSubField<PVInt>("value")->get()==109);
+    pvIntValue->put(90);
+    testOk1(pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet)==true);
+}
+
+static void arrayDeadbandTest()
+{
+    if(debug) {cout << endl << endl << "****arrayDeadbandTest****" << endl;}
+    size_t n = 100;
+    shared_vector<double> values(n);
+    for(size_t i=0; i<n; i++) values[i] = 10.0 + i;
+    PVStructurePtr pvRecordStructure(getStandardPVField()->scalarArray(pvDouble,""));
+    PVDoubleArrayPtr pvValue(pvRecordStructure->getSubField<PVDoubleArray>("value"));
+    pvValue->replace(freeze(values));
+    PVStructurePtr pvRequest(CreateRequest::create()->createRequest("value[deadband=abs:1.0]"));
+    PVCopyPtr pvCopy(PVCopy::create(pvRecordStructure,pvRequest,""));
+    PVStructurePtr pvStructureCopy(pvCopy->createPVStructure());
+    BitSetPtr bitSet(new BitSet(pvStructureCopy->getNumberFields()));
+    bool result = pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    testOk1(result==true);
+    // every element moves, but less than the deadband
+    values = shared_vector<double>(n);
+    for(size_t i=0; i<n; i++) values[i] = 10.5 + i;
+    pvValue->replace(freeze(values));
+    bitSet->clear();
+    result = pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    if(debug) {
+        cout << "after small change"
+             << " result " << (result ? "true" : "false")
+             << " bitSet " << *bitSet
+             << "\n";
+    }
+    testOk1(result==false);
+    // one element moves beyond the deadband of the last reported value
+    values = shared_vector<double>(n);
+    for(size_t i=0; i<n; i++) values[i] = 10.5 + i;
+    values[n-1] = 10.0 + n;
+    pvValue->replace(freeze(values));
+    bitSet->clear();
+    result = pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    testOk1(result==true);
+    // relative deadband of 10 percent
+    pvRequest = CreateRequest::create()->createRequest("value[deadband=rel:10.0]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    pvStructureCopy = pvCopy->createPVStructure();
+    bitSet = BitSetPtr(new BitSet(pvStructureCopy->getNumberFields()));
+    pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    values = shared_vector<double>(n);
+    for(size_t i=0; i<n; i++) values[i] = (10.5 + i)*1.05;
+    pvValue->replace(freeze(values));
+    bitSet->clear();
+    result = pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    testOk1(result==false);
+    // an element that is 0 does not report when nothing changed, and reports when it changes
+    values = shared_vector<double>(n,0.0);
+    values[0] = 10.0;
+    pvValue->replace(freeze(values));
+    pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    values = shared_vector<double>(n,0.0);
+    values[0] = 10.0;
+    pvValue->replace(freeze(values));
+    bitSet->clear();
+    result = pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    testOk1(result==false);
+    values = shared_vector<double>(n,0.0);
+    values[0] = 10.0;
+    values[n-1] = 0.001;
+    pvValue->replace(freeze(values));
+    bitSet->clear();
+    result = pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    testOk1(result==true);
+    // a change of length is always reported
+    values = shared_vector<double>(n+1);
+    for(size_t i=0; i<=n; i++) values[i] = 10.5 + i;
+    pvValue->replace(freeze(values));
+    bitSet->clear();
+    result = pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    testOk1(result==true);
+    testOk1(pvStructureCopy->getSubField<PVDoubleArray>("value")->getLength()==n+1);
+}
+
+static void sampleTest()
+{
+    if(debug) {cout << endl << endl << "****sampleTest****" << endl;}
+    PVStructurePtr pvRecordStructure(getStandardPVField()->scalar(pvDouble,""));
+    PVDoublePtr pvValue(pvRecordStructure->getSubField<PVDouble>("value"));
+    PVStructurePtr pvRequest(CreateRequest::create()->createRequest("value[decimate=3]"));
+    PVCopyPtr pvCopy(PVCopy::create(pvRecordStructure,pvRequest,""));
+    PVStructurePtr pvStructureCopy(pvCopy->createPVStructure());
+    BitSetPtr bitSet(new BitSet(pvStructureCopy->getNumberFields()));
+    PVDoublePtr pvCopyValue(pvStructureCopy->getSubField<PVDouble>("value"));
+    string reported;
+    bool copyHeld = true;
+    for(int i=0; i<7; i++) {
+        pvValue->put(i + 1.0);
+        bitSet->clear();
+        bool result = pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+        reported += result ? "1" : "0";
+        if(!result && pvCopyValue->get()==i + 1.0) copyHeld = false;
+    }
+    if(debug) {cout << "sample reported " << reported << endl;}
+    testOk1(reported.compare("1001001")==0);
+    testOk1(copyHeld && pvCopyValue->get()==7.0);
+    // illegal requests give no filter
+    pvRequest = CreateRequest::create()->createRequest("value[decimate=0]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    pvStructureCopy = pvCopy->createPVStructure();
+    bitSet = BitSetPtr(new BitSet(pvStructureCopy->getNumberFields()));
+    pvValue->put(1.0);
+    pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    pvValue->put(2.0);
+    bitSet->clear();
+    testOk1(pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet));
 }
 
 static void arrayTest()
@@ -143,6 +282,487 @@ static void arrayTest()
     }
     testOk1(result==true);
     testOk1(nset==1);
+    // every third element, both directions
+    pvRequest = CreateRequest::create()->createRequest("value[array=1:3:9]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    pvStructureCopy = pvCopy->createPVStructure();
+    bitSet = BitSetPtr(new BitSet(pvStructureCopy->getNumberFields()));
+    pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    PVDoubleArrayPtr pvCopyValue(pvStructureCopy->getSubField<PVDoubleArray>("value"));
+    shared_vector<const double> copyValues(pvCopyValue->view());
+    testOk1(copyValues.size()==3);
+    testOk1(copyValues.size()==3 && copyValues[0]==1.06 && copyValues[1]==4.06 && copyValues[2]==7.06);
+    values = shared_vector<double>(3);
+    values[0] = 100.0; values[1] = 200.0; values[2] = 300.0;
+    pvCopyValue->replace(freeze(values));
+    bitSet->clear();
+    bitSet->set(pvCopyValue->getFieldOffset());
+    pvCopy->updateMaster(pvStructureCopy,bitSet);
+    shared_vector<const double> masterValues(pvValue->view());
+    testOk1(masterValues.size()==n);
+    testOk1(masterValues[1]==100.0 && masterValues[4]==200.0 && masterValues[7]==300.0);
+    testOk1(masterValues[2]==2.06 && masterValues[3]==3.06);
+}
+
+static void sparseTest()
+{
+    if(debug) {cout << endl << endl << "****sparseTest****" << endl;}
+    shared_vector<int32> values(1000);
+    for(size_t i=0; i<values.size(); i++) values[i] = static_cast<int32>(i);
+    PVStructurePtr pvRecordStructure(getStandardPVField()->scalarArray(pvInt,""));
+    PVIntArrayPtr pvValue(pvRecordStructure->getSubField<PVIntArray>("value"));
+    pvValue->replace(freeze(values));
+    PVStructurePtr pvRequest(CreateRequest::create()->createRequest("value[sparse=0.01]"));
+    PVCopyPtr pvCopy(PVCopy::create(pvRecordStructure,pvRequest,""));
+    PVStructurePtr pvStructureCopy(pvCopy->createPVStructure());
+    BitSetPtr bitSet(new BitSet(pvStructureCopy->getNumberFields()));
+    bool result = pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    PVIntArrayPtr pvFull(pvStructureCopy->getSubField<PVIntArray>("value.full"));
+    PVIntArrayPtr pvIndex(pvStructureCopy->getSubField<PVIntArray>("value.index"));
+    PVIntArrayPtr pvChanged(pvStructureCopy->getSubField<PVIntArray>("value.value"));
+    if(debug) {
+        cout << "sparse"
+             << " result " << (result ? "true" : "false")
+             << " pvStructureCopy\n" << pvStructureCopy
+             << "\n";
+    }
+    testOk1(result==true && pvFull && pvIndex && pvChanged
+        && pvFull->getLength()==1000 && pvIndex->getLength()==0);
+    // a few changes are delivered as index and value
+    values = pvValue->reuse();
+    values[7] = -7;
+    values[500] = -500;
+    pvValue->replace(freeze(values));
+    bitSet->clear();
+    result = pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    testOk1(result==true && pvFull->getLength()==0 && pvIndex->getLength()==2
+        && pvIndex->view()[0]==7 && pvIndex->view()[1]==500
+        && pvChanged->view()[0]==-7 && pvChanged->view()[1]==-500);
+    // no change is not delivered
+    bitSet->clear();
+    result = pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    testOk1(result==false);
+    // a monitor element that is updated again before it is released keeps its changes
+    size_t valueOffset = pvStructureCopy->getSubField("value")->getFieldOffset();
+    values = pvValue->reuse();
+    values[3] = -3;
+    pvValue->replace(freeze(values));
+    bitSet->clear();
+    bitSet->set(valueOffset);
+    result = pvCopy->updateCopyFromBitSet(pvStructureCopy,bitSet);
+    values = pvValue->reuse();
+    values[3] = -33;
+    values[9] = -9;
+    pvValue->replace(freeze(values));
+    bitSet->set(valueOffset);
+    result = pvCopy->updateCopyFromBitSet(pvStructureCopy,bitSet) && result;
+    testOk1(result==true && bitSet->get(valueOffset) && pvIndex->getLength()==2
+        && pvIndex->view()[0]==3 && pvIndex->view()[1]==9
+        && pvChanged->view()[0]==-33 && pvChanged->view()[1]==-9);
+    values = pvValue->reuse();
+    values[500] = 500;
+    pvValue->replace(freeze(values));
+    result = pvCopy->updateCopyFromBitSet(pvStructureCopy,bitSet);
+    testOk1(result==true && pvIndex->getLength()==3
+        && pvIndex->view()[0]==3 && pvIndex->view()[1]==9 && pvIndex->view()[2]==500
+        && pvChanged->view()[2]==500);
+    // many changes are delivered as the full array
+    values = pvValue->reuse();
+    for(size_t i=0; i<100; i++) values[i] = 0;
+    pvValue->replace(freeze(values));
+    bitSet->clear();
+    result = pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    testOk1(result==true && pvFull->getLength()==1000 && pvIndex->getLength()==0
+        && pvFull->view()[500]==500);
+    // illegal requests give no filter
+    pvRequest = CreateRequest::create()->createRequest("value[sparse=2.0]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    testOk1(pvCopy->createPVStructure()->getSubField<PVIntArray>("value").get()!=0);
+}
+
+static void peaksTest()
+{
+    if(debug) {cout << endl << endl << "****peaksTest****" << endl;}
+    shared_vector<double> values(100,0.0);
+    values[9] = 2.0;
+    values[10] = 5.0;
+    values[11] = 2.0;
+    values[12] = 4.0;
+    values[49] = 1.0;
+    values[50] = 3.0;
+    values[51] = 3.0;
+    values[80] = 1.0;
+    PVStructurePtr pvRecordStructure(getStandardPVField()->scalarArray(pvDouble,""));
+    pvRecordStructure->getSubField<PVDoubleArray>("value")->replace(freeze(values));
+    PVStructurePtr pvRequest(CreateRequest::create()->createRequest("value[peaks=1.5:2:5:centroid]"));
+    PVCopyPtr pvCopy(PVCopy::create(pvRecordStructure,pvRequest,""));
+    PVStructurePtr pvStructureCopy(pvCopy->createPVStructure());
+    BitSetPtr bitSet(new BitSet(pvStructureCopy->getNumberFields()));
+    bool result = pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    PVIntArrayPtr pvIndex(pvStructureCopy->getSubField<PVIntArray>("value.index"));
+    PVDoubleArrayPtr pvHeight(pvStructureCopy->getSubField<PVDoubleArray>("value.height"));
+    PVDoubleArrayPtr pvCentroid(pvStructureCopy->getSubField<PVDoubleArray>("value.centroid"));
+    if(debug) {
+        cout << "peaks"
+             << " result " << (result ? "true" : "false")
+             << " pvStructureCopy\n" << pvStructureCopy
+             << "\n";
+    }
+    testOk1(result==true && pvIndex && pvHeight && pvCentroid
+        && pvIndex->getLength()==2 && pvHeight->getLength()==2 && pvCentroid->getLength()==2);
+    // 12 is too close to 10 and the plateau at 50,51 peaks at 51
+    testOk1(pvIndex && pvIndex->getLength()==2
+        && pvIndex->view()[0]==10 && pvIndex->view()[1]==51
+        && pvHeight->view()[0]==5.0 && pvHeight->view()[1]==3.0);
+    testOk1(pvCentroid && pvCentroid->getLength()==2
+        && fabs(pvCentroid->view()[0] - 75.0/7.0)<1e-12
+        && fabs(pvCentroid->view()[1] - 50.5)<1e-12);
+    pvRequest = CreateRequest::create()->createRequest("value[peaks=1.5:10:0]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    pvStructureCopy = pvCopy->createPVStructure();
+    bitSet = BitSetPtr(new BitSet(pvStructureCopy->getNumberFields()));
+    pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    pvIndex = pvStructureCopy->getSubField<PVIntArray>("value.index");
+    pvCentroid = pvStructureCopy->getSubField<PVDoubleArray>("value.centroid");
+    testOk1(pvIndex && pvIndex->getLength()==3 && pvIndex->view()[1]==12
+        && pvCentroid && pvCentroid->getLength()==0);
+    // illegal requests give no filter
+    pvRequest = CreateRequest::create()->createRequest("value[peaks=1.5:0:5]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    testOk1(pvCopy->createPVStructure()->getSubField<PVDoubleArray>("value").get()!=0);
+}
+
+static void roiTest()
+{
+    if(debug) {cout << endl << endl << "****roiTest****" << endl;}
+    StructureConstPtr structure(getFieldCreate()->createFieldBuilder()->
+        addArray("value",pvDouble)->
+        add("width",pvInt)->
+        add("height",pvInt)->
+        createStructure());
+    PVStructurePtr pvRecordStructure(getPVDataCreate()->createPVStructure(structure));
+    // a 6 by 4 image with pixel 10*row + column
+    shared_vector<double> values(24);
+    for(size_t i=0; i<values.size(); i++) values[i] = 10.0*(i/6) + i%6;
+    pvRecordStructure->getSubField<PVDoubleArray>("value")->replace(freeze(values));
+    pvRecordStructure->getSubField<PVInt>("width")->put(6);
+    pvRecordStructure->getSubField<PVInt>("height")->put(4);
+    PVStructurePtr pvRequest(CreateRequest::create()->createRequest("value[roi=1:1:4:2]"));
+    PVCopyPtr pvCopy(PVCopy::create(pvRecordStructure,pvRequest,""));
+    PVStructurePtr pvStructureCopy(pvCopy->createPVStructure());
+    BitSetPtr bitSet(new BitSet(pvStructureCopy->getNumberFields()));
+    bool result = pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    PVDoubleArrayPtr pvImage(pvStructureCopy->getSubField<PVDoubleArray>("value"));
+    if(debug) {
+        cout << "roi"
+             << " result " << (result ? "true" : "false")
+             << " pvStructureCopy\n" << pvStructureCopy
+             << "\n";
+    }
+    double crop[] = {11,12,13,14,21,22,23,24};
+    bool ok = result && pvImage && pvImage->getLength()==8;
+    for(size_t i=0; ok && i<8; i++) ok = (pvImage->view()[i]==crop[i]);
+    testOk1(ok);
+    pvRequest = CreateRequest::create()->createRequest("value[roi=0:0:6:4:2]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    pvStructureCopy = pvCopy->createPVStructure();
+    bitSet = BitSetPtr(new BitSet(pvStructureCopy->getNumberFields()));
+    pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    pvImage = pvStructureCopy->getSubField<PVDoubleArray>("value");
+    double binned[] = {5.5,7.5,9.5,25.5,27.5,29.5};
+    ok = pvImage && pvImage->getLength()==6;
+    for(size_t i=0; ok && i<6; i++) ok = (pvImage->view()[i]==binned[i]);
+    testOk1(ok);
+    // the region is clipped to the image
+    pvRequest = CreateRequest::create()->createRequest("value[roi=4:2:10:10]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    pvStructureCopy = pvCopy->createPVStructure();
+    bitSet = BitSetPtr(new BitSet(pvStructureCopy->getNumberFields()));
+    pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    pvImage = pvStructureCopy->getSubField<PVDoubleArray>("value");
+    testOk1(pvImage && pvImage->getLength()==4
+        && pvImage->view()[0]==24.0 && pvImage->view()[3]==35.0);
+    // illegal requests give no filter
+    pvRequest = CreateRequest::create()->createRequest("value[roi=0:0:6:4:0]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    pvStructureCopy = pvCopy->createPVStructure();
+    bitSet = BitSetPtr(new BitSet(pvStructureCopy->getNumberFields()));
+    pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    testOk1(pvStructureCopy->getSubField<PVDoubleArray>("value")->getLength()==24);
+    // without width and height there is no filter
+    pvRecordStructure = getStandardPVField()->scalarArray(pvDouble,"");
+    values = shared_vector<double>(24,1.0);
+    pvRecordStructure->getSubField<PVDoubleArray>("value")->replace(freeze(values));
+    pvRequest = CreateRequest::create()->createRequest("value[roi=1:1:4:2]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    pvStructureCopy = pvCopy->createPVStructure();
+    bitSet = BitSetPtr(new BitSet(pvStructureCopy->getNumberFields()));
+    pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    testOk1(pvStructureCopy->getSubField<PVDoubleArray>("value")->getLength()==24);
+}
+
+static void decimateTest()
+{
+    if(debug) {cout << endl << endl << "****decimateTest****" << endl;}
+    size_t n = 10;
+    shared_vector<int32> values(n);
+    for(size_t i=0; i<n; i++) {
+        int32 value = static_cast<int32>(i);
+        values[i] = (i%2==0) ? value : -value;
+    }
+    PVStructurePtr pvRecordStructure(getStandardPVField()->scalarArray(pvInt,""));
+    PVIntArrayPtr pvValue(pvRecordStructure->getSubField<PVIntArray>("value"));
+    pvValue->replace(freeze(values));
+    PVStructurePtr pvRequest(CreateRequest::create()->createRequest("value[decimate=minmax:2]"));
+    PVCopyPtr pvCopy(PVCopy::create(pvRecordStructure,pvRequest,""));
+    PVStructurePtr pvStructureCopy(pvCopy->createPVStructure());
+    BitSetPtr bitSet(new BitSet(pvStructureCopy->getNumberFields()));
+    bool result = pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    PVIntArrayPtr pvCopyValue(pvStructureCopy->getSubField<PVIntArray>("value"));
+    shared_vector<const int32> copyValues(pvCopyValue->view());
+    if(debug) {
+        cout << "decimate"
+             << " result " << (result ? "true" : "false")
+             << " bitSet " << *bitSet
+             << " pvStructureCopy\n" << pvStructureCopy
+             << "\n";
+    }
+    // bins are 0,-1,2,-3,4 and -5,6,-7,8,-9
+    testOk1(result==true);
+    testOk1(bitSet->get(pvCopyValue->getFieldOffset()));
+    testOk1(copyValues.size()==6);
+    testOk1(copyValues.size()==6
+        && copyValues[0]==-3 && copyValues[1]==4 && copyValues[2]==0
+        && copyValues[3]==-9 && copyValues[4]==8 && copyValues[5]==-1);
+    // fewer elements than bins
+    pvRequest = CreateRequest::create()->createRequest("value[decimate=minmax:100]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    pvStructureCopy = pvCopy->createPVStructure();
+    bitSet = BitSetPtr(new BitSet(pvStructureCopy->getNumberFields()));
+    pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    testOk1(pvStructureCopy->getSubField<PVIntArray>("value")->getLength()==3*n);
+    // the copy is never written to master
+    bitSet->set(pvStructureCopy->getSubField("value")->getFieldOffset());
+    pvCopy->updateMaster(pvStructureCopy,bitSet);
+    testOk1(pvValue->getLength()==n);
+    // a second copy with the same request shares the result
+    PVCopyPtr pvCopyOther(PVCopy::create(pvRecordStructure,pvRequest,""));
+    PVStructurePtr pvStructureOther(pvCopyOther->createPVStructure());
+    BitSetPtr bitSetOther(new BitSet(pvStructureOther->getNumberFields()));
+    pvCopyOther->updateCopySetBitSet(pvStructureOther,bitSetOther);
+    testOk1(pvStructureOther->getSubField<PVIntArray>("value")->view().data()
+        ==pvStructureCopy->getSubField<PVIntArray>("value")->view().data());
+    // a new value of master is reduced again
+    values = shared_vector<int32>(n,5);
+    pvValue->replace(freeze(values));
+    pvCopyOther->updateCopySetBitSet(pvStructureOther,bitSetOther);
+    pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    copyValues = pvStructureCopy->getSubField<PVIntArray>("value")->view();
+    testOk1(copyValues.size()==3*n && copyValues[0]==5 && copyValues[3*n-1]==5
+        && copyValues.data()==pvStructureOther->getSubField<PVIntArray>("value")->view().data());
+    // a request with trailing characters gives no filter, so the copy is master
+    pvRequest = CreateRequest::create()->createRequest("value[decimate=minmax:1abc]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    pvStructureCopy = pvCopy->createPVStructure();
+    bitSet = BitSetPtr(new BitSet(pvStructureCopy->getNumberFields()));
+    pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    testOk1(pvStructureCopy->getSubField<PVIntArray>("value")->getLength()==n);
+}
+
+static void compressTest()
+{
+    if(debug) {cout << endl << endl << "****compressTest****" << endl;}
+    size_t n = 1000;
+    shared_vector<int32> values(n);
+    for(size_t i=0; i<n; i++) values[i] = 100000 + static_cast<int32>(i%7) - 3;
+    values[500] = -2000000000;
+    shared_vector<const int32> original(freeze(values));
+    PVStructurePtr pvRecordStructure(getStandardPVField()->scalarArray(pvInt,""));
+    PVIntArrayPtr pvValue(pvRecordStructure->getSubField<PVIntArray>("value"));
+    pvValue->replace(original);
+    PVStructurePtr pvRequest(CreateRequest::create()->createRequest("value[compress=delta]"));
+    PVCopyPtr pvCopy(PVCopy::create(pvRecordStructure,pvRequest,""));
+    PVStructurePtr pvStructureCopy(pvCopy->createPVStructure());
+    BitSetPtr bitSet(new BitSet(pvStructureCopy->getNumberFields()));
+    bool result = pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    PVUByteArrayPtr pvCopyValue(pvStructureCopy->getSubField<PVUByteArray>("value"));
+    if(debug) {
+        cout << "compress"
+             << " result " << (result ? "true" : "false")
+             << " bitSet " << *bitSet
+             << " length " << (pvCopyValue ? pvCopyValue->getLength() : 0)
+             << "\n";
+    }
+    testOk1(result==true);
+    testOk1(pvCopyValue.get()!=0);
+    testOk1(pvCopyValue && pvCopyValue->getLength()<n);
+    // decode back into master
+    pvValue->replace(shared_vector<const int32>());
+    bitSet->set(pvCopyValue->getFieldOffset());
+    pvCopy->updateMaster(pvStructureCopy,bitSet);
+    testOk1(pvValue->view()==original);
+    // a bad encoding throws and does not modify master
+    shared_vector<uint8> bad(6,0);
+    bad[0] = 10;
+    bad[4] = 8;
+    shared_vector<const uint8> badEncoding(freeze(bad));
+    pvCopyValue->replace(badEncoding);
+    bool thrown = false;
+    try {
+        pvCopy->updateMaster(pvStructureCopy,bitSet);
+    } catch(std::runtime_error &) {
+        thrown = true;
+    }
+    testOk1(thrown && pvValue->view()==original);
+    // a length that the bytes can not hold is refused before it is allocated
+    shared_vector<uint8> huge(6,0);
+    huge[0] = huge[1] = huge[2] = huge[3] = 0xff;
+    pvCopyValue->replace(freeze(huge));
+    thrown = false;
+    try {
+        pvCopy->updateMaster(pvStructureCopy,bitSet);
+    } catch(std::runtime_error &) {
+        thrown = true;
+    }
+    testOk1(thrown && pvValue->view()==original);
+    // a put of a bad encoding gets an error
+    PVDatabasePtr master(PVDatabase::getMaster());
+    PVRecordPtr pvRecord(PVRecord::create("compressRecord",pvRecordStructure));
+    master->addRecord(pvRecord);
+    PutRequesterPtr requester(PutRequester::create("compressRecord","value[compress=delta]"));
+    PVUByteArrayPtr pvPutValue(requester->getPVStructure()->getSubField<PVUByteArray>("value"));
+    pvPutValue->replace(badEncoding);
+    requester->getBitSet()->set(pvPutValue->getFieldOffset());
+    requester->put();
+    requester->waitPutDone(1);
+    testOk1(requester->getErrors()==1 && pvValue->view()==original);
+    master->removeRecord(pvRecord);
+    // a plugin that changes the type of the copy is the only filter of the field
+    pvRequest = CreateRequest::create()->createRequest("value[compress=delta,array=0:10]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    pvStructureCopy = pvCopy->createPVStructure();
+    bitSet = BitSetPtr(new BitSet(pvStructureCopy->getNumberFields()));
+    pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    pvCopyValue = pvStructureCopy->getSubField<PVUByteArray>("value");
+    pvValue->replace(shared_vector<const int32>());
+    pvCopy->updateMaster(pvStructureCopy,bitSet);
+    testOk1(pvValue->view()==original);
+    pvRequest = CreateRequest::create()->createRequest("value[compress=delta]");
+    // extreme values of a 64 bit type
+    shared_vector<int64> longValues(3);
+    longValues[0] = -9223372036854775807LL - 1;
+    longValues[1] = 9223372036854775807LL;
+    longValues[2] = 0;
+    shared_vector<const int64> longOriginal(freeze(longValues));
+    pvRecordStructure = getStandardPVField()->scalarArray(pvLong,"");
+    PVLongArrayPtr pvLongValue(pvRecordStructure->getSubField<PVLongArray>("value"));
+    pvLongValue->replace(longOriginal);
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    pvStructureCopy = pvCopy->createPVStructure();
+    bitSet = BitSetPtr(new BitSet(pvStructureCopy->getNumberFields()));
+    pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    pvLongValue->replace(shared_vector<const int64>());
+    pvCopy->updateMaster(pvStructureCopy,bitSet);
+    testOk1(pvLongValue->view()==longOriginal);
+}
+
+static void filterV2Test()
+{
+    if(debug) {cout << endl << endl << "****filterV2Test****" << endl;}
+    // all filters of one update get the same time
+    StructureConstPtr structure(getFieldCreate()->createFieldBuilder()->
+        add("first",getStandardField()->timeStamp())->
+        add("second",getStandardField()->timeStamp())->
+        createStructure());
+    PVStructurePtr pvRecordStructure(getPVDataCreate()->createPVStructure(structure));
+    PVStructurePtr pvRequest(CreateRequest::create()->createRequest(
+        "first[timestamp=current],second[timestamp=current]"));
+    PVCopyPtr pvCopy(PVCopy::create(pvRecordStructure,pvRequest,""));
+    PVStructurePtr pvStructureCopy(pvCopy->createPVStructure());
+    BitSetPtr bitSet(new BitSet(pvStructureCopy->getNumberFields()));
+    pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    PVTimeStamp pvTimeStamp;
+    TimeStamp first;
+    TimeStamp second;
+    pvTimeStamp.attach(pvStructureCopy->getSubField("first"));
+    pvTimeStamp.get(first);
+    pvTimeStamp.attach(pvStructureCopy->getSubField("second"));
+    pvTimeStamp.get(second);
+    testOk1(first==second && first.getSecondsPastEpoch()!=0);
+    // a PVFilterV2 can still be called as a PVFilter
+    PVFieldPtr pvMaster(pvRecordStructure->getSubField("first"));
+    pvTimeStamp.attach(pvMaster);
+    pvTimeStamp.set(TimeStamp(1000,5,7));
+    PVStructurePtr pvTimeStampCopy(getPVDataCreate()->createPVStructure(getStandardField()->timeStamp()));
+    bitSet = BitSetPtr(new BitSet(pvTimeStampCopy->getNumberFields()));
+    PVFilterPtr pvFilter(PVTimestampFilter::create("copy",pvMaster));
+    bool result = pvFilter && pvFilter->filter(pvTimeStampCopy,bitSet,true);
+    pvTimeStamp.attach(pvTimeStampCopy);
+    pvTimeStamp.get(first);
+    testOk1(result && bitSet->get(0) && first==TimeStamp(1000,5,7));
+    // the fields are found by name and a field with the wrong type gives no filter
+    StructureConstPtr reordered(getFieldCreate()->createFieldBuilder()->
+        add("userTag",pvInt)->
+        add("nanoseconds",pvInt)->
+        add("secondsPastEpoch",pvLong)->
+        createStructure());
+    pvMaster = getPVDataCreate()->createPVStructure(reordered);
+    pvTimeStamp.attach(pvMaster);
+    pvTimeStamp.set(TimeStamp(2000,6,8));
+    pvTimeStampCopy = getPVDataCreate()->createPVStructure(reordered);
+    pvFilter = PVTimestampFilter::create("copy",pvMaster);
+    result = pvFilter && pvFilter->filter(pvTimeStampCopy,bitSet,true);
+    pvTimeStamp.attach(pvTimeStampCopy);
+    pvTimeStamp.get(first);
+    testOk1(result && first==TimeStamp(2000,6,8));
+    StructureConstPtr wrongType(getFieldCreate()->createFieldBuilder()->
+        add("secondsPastEpoch",pvInt)->
+        add("nanoseconds",pvInt)->
+        add("userTag",pvInt)->
+        createStructure());
+    pvMaster = getPVDataCreate()->createPVStructure(wrongType);
+    testOk1(!PVTimestampFilter::create("copy",pvMaster));
+}
+
+static void postCopyTest()
+{
+    if(debug) {cout << endl << endl << "****postCopyTest****" << endl;}
+    PVStructurePtr pvRecordStructure(getStandardPVField()->scalar(pvInt,""));
+    PVStructurePtr pvRequest(CreateRequest::create()->createRequest("value[deadband=abs:1.0]"));
+    PVCopyPtr pvCopy(PVCopy::create(pvRecordStructure,pvRequest,""));
+    PostCopySnapshotPtr snapshot(pvCopy->createPostCopySnapshot());
+    // quantile keeps state, so it must see every update and is not post-copy
+    pvRequest = CreateRequest::create()->createRequest("value[quantile=0.5]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    bool noSnapshot = !snapshot && !pvCopy->createPostCopySnapshot();
+    pvRecordStructure = getStandardPVField()->scalarArray(pvDouble,"");
+    PVDoubleArrayPtr pvValue(pvRecordStructure->getSubField<PVDoubleArray>("value"));
+    pvRequest = CreateRequest::create()->createRequest("value[spectrum=magnitude]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    testOk1(noSnapshot && pvCopy->createPostCopySnapshot());
+    // the filter runs later, with the value master had when the snapshot was taken
+    snapshot = pvCopy->createPostCopySnapshot();
+    PVStructurePtr pvStructureCopy(pvCopy->createPVStructure());
+    BitSetPtr bitSet(new BitSet(pvStructureCopy->getNumberFields()));
+    PVDoubleArrayPtr pvSpectrum(pvStructureCopy->getSubField<PVDoubleArray>("value"));
+    shared_vector<double> values(4,3.0);
+    pvValue->replace(freeze(values));
+    pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet,snapshot);
+    bool before = (pvSpectrum->getLength()==0);
+    values = shared_vector<double>(4,7.0);
+    pvValue->replace(freeze(values));
+    bool result = pvCopy->runPostCopyFilters(pvStructureCopy,bitSet,snapshot);
+    if(debug) {
+        cout << "postCopy"
+             << " result " << (result ? "true" : "false")
+             << " pvStructureCopy\n" << pvStructureCopy
+             << "\n";
+    }
+    testOk1(before && result && bitSet->get(pvSpectrum->getFieldOffset())
+        && pvSpectrum->getLength()==3 && pvSpectrum->view()[0]==12.0);
+    // nothing is pending
+    bitSet->clear();
+    testOk1(!pvCopy->runPostCopyFilters(pvStructureCopy,bitSet,snapshot) && bitSet->isEmpty());
 }
 
 static void timeStampTest()
@@ -197,6 +817,331 @@ static void timeStampTest()
     testOk1(nset==2);
 }
 
+static void statsTest()
+{
+    if(debug) {cout << endl << endl << "****statsTest****" << endl;}
+    PVStructurePtr pvRecordStructure(getStandardPVField()->scalar(pvDouble,""));
+    PVDoublePtr pvValue(pvRecordStructure->getSubField<PVDouble>("value"));
+    PVStructurePtr pvRequest(CreateRequest::create()->createRequest("value[stats=samples:3]"));
+    PVCopyPtr pvCopy(PVCopy::create(pvRecordStructure,pvRequest,""));
+    PVStructurePtr pvStructureCopy(pvCopy->createPVStructure());
+    BitSetPtr bitSet(new BitSet(pvStructureCopy->getNumberFields()));
+    PVStructurePtr pvStats(pvStructureCopy->getSubField<PVStructure>("value"));
+    testOk1(pvStats.get()!=0);
+    pvValue->put(1.0);
+    bool result = pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    pvValue->put(2.0);
+    result = pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet) || result;
+    testOk1(result==false);
+    pvValue->put(3.0);
+    result = pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    if(debug) {
+        cout << "stats"
+             << " result " << (result ? "true" : "false")
+             << " bitSet " << *bitSet
+             << " pvStructureCopy\n" << pvStructureCopy
+             << "\n";
+    }
+    testOk1(result==true);
+    testOk1(pvStats && pvStats->getSubField<PVDouble>("mean")->get()==2.0
+        && pvStats->getSubField<PVDouble>("min")->get()==1.0
+        && pvStats->getSubField<PVDouble>("max")->get()==3.0
+        && pvStats->getSubField<PVLong>("count")->get()==3);
+    testOk1(pvStats && fabs(pvStats->getSubField<PVDouble>("rms")->get() - sqrt(14.0/3.0))<1e-12);
+    // each element of an array is a value
+    shared_vector<int32> values(7);
+    for(size_t i=0; i<values.size(); i++) values[i] = static_cast<int32>(i) - 2;
+    pvRecordStructure = getStandardPVField()->scalarArray(pvInt,"");
+    pvRecordStructure->getSubField<PVIntArray>("value")->replace(freeze(values));
+    pvRequest = CreateRequest::create()->createRequest("value[stats=samples:1]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    pvStructureCopy = pvCopy->createPVStructure();
+    bitSet = BitSetPtr(new BitSet(pvStructureCopy->getNumberFields()));
+    result = pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    pvStats = pvStructureCopy->getSubField<PVStructure>("value");
+    testOk1(result==true);
+    testOk1(pvStats && pvStats->getSubField<PVDouble>("mean")->get()==1.0
+        && pvStats->getSubField<PVDouble>("min")->get()==-2.0
+        && pvStats->getSubField<PVDouble>("max")->get()==4.0
+        && pvStats->getSubField<PVLong>("count")->get()==7);
+    // a deadband on the same field is not applied to the stats structure
+    pvRecordStructure = getStandardPVField()->scalar(pvDouble,"");
+    pvRecordStructure->getSubField<PVDouble>("value")->put(5.0);
+    pvRequest = CreateRequest::create()->createRequest("value[stats=samples:1,deadband=abs:1]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    pvStructureCopy = pvCopy->createPVStructure();
+    bitSet = BitSetPtr(new BitSet(pvStructureCopy->getNumberFields()));
+    result = pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    pvStats = pvStructureCopy->getSubField<PVStructure>("value");
+    testOk1(result==true && pvStats && pvStats->getSubField<PVDouble>("mean")->get()==5.0);
+    // a window with trailing characters or that is too long gives no filter
+    pvRequest = CreateRequest::create()->createRequest("value[stats=samples:3x]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    testOk1(pvCopy->createPVStructure()->getSubField<PVDouble>("value").get()!=0);
+    pvRequest = CreateRequest::create()->createRequest("value[stats=seconds:1e300]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    testOk1(pvCopy->createPVStructure()->getSubField<PVDouble>("value").get()!=0);
+}
+
+static void histogramTest()
+{
+    if(debug) {cout << endl << endl << "****histogramTest****" << endl;}
+    shared_vector<double> values(12);
+    for(size_t i=0; i<10; i++) values[i] = i + .5;
+    values[10] = -1.0;
+    values[11] = 10.0;
+    PVStructurePtr pvRecordStructure(getStandardPVField()->scalarArray(pvDouble,""));
+    pvRecordStructure->getSubField<PVDoubleArray>("value")->replace(freeze(values));
+    PVStructurePtr pvRequest(CreateRequest::create()->createRequest("value[histogram=0:10:5]"));
+    PVCopyPtr pvCopy(PVCopy::create(pvRecordStructure,pvRequest,""));
+    PVStructurePtr pvStructureCopy(pvCopy->createPVStructure());
+    BitSetPtr bitSet(new BitSet(pvStructureCopy->getNumberFields()));
+    bool result = pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    PVIntArrayPtr pvCounts(pvStructureCopy->getSubField<PVIntArray>("value"));
+    if(debug) {
+        cout << "histogram"
+             << " result " << (result ? "true" : "false")
+             << " pvStructureCopy\n" << pvStructureCopy
+             << "\n";
+    }
+    testOk1(result==true);
+    testOk1(pvCounts && pvCounts->getLength()==5);
+    bool allTwo = pvCounts && pvCounts->getLength()==5;
+    for(size_t i=0; allTwo && i<5; i++) allTwo = (pvCounts->view()[i]==2);
+    testOk1(allTwo);
+    // a scalar is accumulated over updates
+    pvRecordStructure = getStandardPVField()->scalar(pvInt,"");
+    PVIntPtr pvValue(pvRecordStructure->getSubField<PVInt>("value"));
+    pvRequest = CreateRequest::create()->createRequest("value[histogram=0:10:2]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    pvStructureCopy = pvCopy->createPVStructure();
+    bitSet = BitSetPtr(new BitSet(pvStructureCopy->getNumberFields()));
+    pvValue->put(1);
+    pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    pvValue->put(7);
+    pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    pvCounts = pvStructureCopy->getSubField<PVIntArray>("value");
+    testOk1(pvCounts && pvCounts->getLength()==2
+        && pvCounts->view()[0]==2 && pvCounts->view()[1]==1);
+    // illegal requests give no filter
+    pvRequest = CreateRequest::create()->createRequest("value[histogram=10:0:2]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    testOk1(pvCopy->createPVStructure()->getSubField<PVInt>("value").get()!=0);
+    pvRequest = CreateRequest::create()->createRequest("value[histogram=0:1e-310:1000]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    testOk1(pvCopy->createPVStructure()->getSubField<PVInt>("value").get()!=0);
+}
+
+static void quantileTest()
+{
+    if(debug) {cout << endl << endl << "****quantileTest****" << endl;}
+    // a permutation of 0,...,999
+    shared_vector<double> values(1000);
+    for(size_t i=0; i<values.size(); i++) values[i] = static_cast<double>((i*377)%1000);
+    PVStructurePtr pvRecordStructure(getStandardPVField()->scalarArray(pvDouble,""));
+    pvRecordStructure->getSubField<PVDoubleArray>("value")->replace(freeze(values));
+    PVStructurePtr pvRequest(CreateRequest::create()->createRequest("value[quantile=0.5:0.9]"));
+    PVCopyPtr pvCopy(PVCopy::create(pvRecordStructure,pvRequest,""));
+    PVStructurePtr pvStructureCopy(pvCopy->createPVStructure());
+    BitSetPtr bitSet(new BitSet(pvStructureCopy->getNumberFields()));
+    bool result = pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    PVDoubleArrayPtr pvQuantiles(pvStructureCopy->getSubField<PVDoubleArray>("value"));
+    if(debug) {
+        cout << "quantile"
+             << " result " << (result ? "true" : "false")
+             << " pvStructureCopy\n" << pvStructureCopy
+             << "\n";
+    }
+    testOk1(result==true);
+    testOk1(pvQuantiles && pvQuantiles->getLength()==2
+        && fabs(pvQuantiles->view()[0] - 500.0)<20.0
+        && fabs(pvQuantiles->view()[1] - 900.0)<20.0);
+    // with fewer than five samples a scalar gives an exact quantile
+    pvRecordStructure = getStandardPVField()->scalar(pvInt,"");
+    PVIntPtr pvValue(pvRecordStructure->getSubField<PVInt>("value"));
+    pvRequest = CreateRequest::create()->createRequest("value[quantile=0.5]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    pvStructureCopy = pvCopy->createPVStructure();
+    bitSet = BitSetPtr(new BitSet(pvStructureCopy->getNumberFields()));
+    pvValue->put(3);
+    pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    pvValue->put(1);
+    pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    pvValue->put(2);
+    pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    pvQuantiles = pvStructureCopy->getSubField<PVDoubleArray>("value");
+    testOk1(pvQuantiles && pvQuantiles->getLength()==1 && pvQuantiles->view()[0]==2.0);
+    // illegal requests give no filter
+    pvRequest = CreateRequest::create()->createRequest("value[quantile=0.5:1.5]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    testOk1(pvCopy->createPVStructure()->getSubField<PVInt>("value").get()!=0);
+}
+
+static void spectrumTest()
+{
+    if(debug) {cout << endl << endl << "****spectrumTest****" << endl;}
+    const double pi = 3.14159265358979323846;
+    // a cosine with 4 periods in 64 samples
+    shared_vector<double> values(64);
+    for(size_t i=0; i<values.size(); i++) values[i] = cos(2.0*pi*4.0*i/64.0);
+    PVStructurePtr pvRecordStructure(getStandardPVField()->scalarArray(pvDouble,""));
+    pvRecordStructure->getSubField<PVDoubleArray>("value")->replace(freeze(values));
+    PVStructurePtr pvRequest(CreateRequest::create()->createRequest("value[spectrum=magnitude]"));
+    PVCopyPtr pvCopy(PVCopy::create(pvRecordStructure,pvRequest,""));
+    PVStructurePtr pvStructureCopy(pvCopy->createPVStructure());
+    BitSetPtr bitSet(new BitSet(pvStructureCopy->getNumberFields()));
+    bool result = pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    PVDoubleArrayPtr pvSpectrum(pvStructureCopy->getSubField<PVDoubleArray>("value"));
+    if(debug) {
+        cout << "spectrum"
+             << " result " << (result ? "true" : "false")
+             << " pvStructureCopy\n" << pvStructureCopy
+             << "\n";
+    }
+    testOk1(result==true);
+    testOk1(pvSpectrum && pvSpectrum->getLength()==33);
+    bool ok = pvSpectrum && pvSpectrum->getLength()==33;
+    for(size_t k=0; ok && k<33; k++) {
+        double expected = (k==4) ? 32.0 : 0.0;
+        ok = fabs(pvSpectrum->view()[k] - expected)<1e-9;
+    }
+    testOk1(ok);
+    // odd and mixed radix lengths are compared with a direct transform,
+    // and so are a prime length and twice a prime, which use the chirp z-transform
+    size_t lengths[] = {15,24,2062,4099};
+    for(size_t j=0; j<4; j++) {
+        size_t n = lengths[j];
+        shared_vector<int16> samples(n);
+        for(size_t i=0; i<n; i++) samples[i] = static_cast<int16>((i*7)%11) - 5;
+        pvRecordStructure = getStandardPVField()->scalarArray(pvShort,"");
+        pvRecordStructure->getSubField<PVShortArray>("value")->replace(freeze(samples));
+        pvRequest = CreateRequest::create()->createRequest("value[spectrum=power]");
+        pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+        pvStructureCopy = pvCopy->createPVStructure();
+        bitSet = BitSetPtr(new BitSet(pvStructureCopy->getNumberFields()));
+        pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+        pvSpectrum = pvStructureCopy->getSubField<PVDoubleArray>("value");
+        PVShortArray::const_svector data(pvRecordStructure->getSubField<PVShortArray>("value")->view());
+        ok = pvSpectrum && pvSpectrum->getLength()==n/2+1;
+        for(size_t k=0; ok && k<=n/2; k++) {
+            double re = 0.0;
+            double im = 0.0;
+            for(size_t i=0; i<n; i++) {
+                double phase = 2.0*pi*((k*i)%n)/n;
+                re += data[i]*cos(phase);
+                im -= data[i]*sin(phase);
+            }
+            double expected = re*re + im*im;
+            ok = fabs(pvSpectrum->view()[k] - expected)<1e-6*(1.0 + expected);
+        }
+        testOk1(ok);
+    }
+    // illegal requests give no filter
+    pvRequest = CreateRequest::create()->createRequest("value[spectrum=power:square]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    testOk1(pvCopy->createPVStructure()->getSubField<PVShortArray>("value").get()!=0);
+}
+
+static void quantizeTest()
+{
+    if(debug) {cout << endl << endl << "****quantizeTest****" << endl;}
+    shared_vector<double> values(11);
+    for(size_t i=0; i<values.size(); i++) values[i] = i*0.1;
+    PVStructurePtr pvRecordStructure(getStandardPVField()->scalarArray(pvDouble,""));
+    pvRecordStructure->getSubField<PVDoubleArray>("value")->replace(freeze(values));
+    PVStructurePtr pvRequest(CreateRequest::create()->createRequest("value[quantize=int8]"));
+    PVCopyPtr pvCopy(PVCopy::create(pvRecordStructure,pvRequest,""));
+    PVStructurePtr pvStructureCopy(pvCopy->createPVStructure());
+    BitSetPtr bitSet(new BitSet(pvStructureCopy->getNumberFields()));
+    bool result = pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    PVByteArrayPtr pvCodes(pvStructureCopy->getSubField<PVByteArray>("value.value"));
+    PVDoublePtr pvScale(pvStructureCopy->getSubField<PVDouble>("value.scale"));
+    PVDoublePtr pvOffset(pvStructureCopy->getSubField<PVDouble>("value.offset"));
+    if(debug) {
+        cout << "quantize"
+             << " result " << (result ? "true" : "false")
+             << " pvStructureCopy\n" << pvStructureCopy
+             << "\n";
+    }
+    testOk1(result==true);
+    testOk1(pvCodes && pvScale && pvOffset && pvCodes->getLength()==11);
+    bool ok = pvCodes && pvScale && pvOffset && pvCodes->getLength()==11;
+    for(size_t i=0; ok && i<11; i++) {
+        double value = pvCodes->view()[i]*pvScale->get() + pvOffset->get();
+        ok = fabs(value - i*0.1)<=pvScale->get()/2.0;
+    }
+    testOk1(ok);
+    pvRequest = CreateRequest::create()->createRequest("value[quantize=float]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    pvStructureCopy = pvCopy->createPVStructure();
+    bitSet = BitSetPtr(new BitSet(pvStructureCopy->getNumberFields()));
+    pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    PVFloatArrayPtr pvFloats(pvStructureCopy->getSubField<PVFloatArray>("value"));
+    testOk1(pvFloats && pvFloats->getLength()==11 && pvFloats->view()[3]==static_cast<float>(0.3));
+    // a fixed range for a scalar
+    pvRecordStructure = getStandardPVField()->scalar(pvDouble,"");
+    pvRecordStructure->getSubField<PVDouble>("value")->put(50.0);
+    pvRequest = CreateRequest::create()->createRequest("value[quantize=int16:-100:100]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    pvStructureCopy = pvCopy->createPVStructure();
+    bitSet = BitSetPtr(new BitSet(pvStructureCopy->getNumberFields()));
+    pvCopy->updateCopySetBitSet(pvStructureCopy,bitSet);
+    PVShortPtr pvCode(pvStructureCopy->getSubField<PVShort>("value.value"));
+    pvScale = pvStructureCopy->getSubField<PVDouble>("value.scale");
+    pvOffset = pvStructureCopy->getSubField<PVDouble>("value.offset");
+    testOk1(pvCode && pvScale && pvOffset && pvScale->get()==100.0/32767.0
+        && fabs(pvCode->get()*pvScale->get() + pvOffset->get() - 50.0)<=pvScale->get()/2.0);
+    // illegal requests give no filter
+    pvRequest = CreateRequest::create()->createRequest("value[quantize=int32]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    testOk1(pvCopy->createPVStructure()->getSubField<PVDouble>("value").get()!=0);
+    pvRequest = CreateRequest::create()->createRequest("value[quantize=int16]");
+    pvCopy = PVCopy::create(pvRecordStructure,pvRequest,"");
+    testOk1(pvCopy->createPVStructure()->getSubField<PVDouble>("value").get()!=0);
+}
+
+static void clockTest()
+{
+    if(debug) {cout << endl << endl << "****clockTest****" << endl;}
+    TimeStamp first;
+    TimeStamp second;
+    PVClock::beginCycle();
+    PVClock::getCurrent(first);
+    epicsThreadSleep(.01);
+    PVClock::getCurrent(second);
+    PVClock::endCycle();
+    testOk1(first==second);
+    PVClock::getCurrent(second);
+    testOk1(second>first);
+    // all processing in a group put has the same time
+    PVStructurePtr pvStructure(getStandardPVField()->scalar(pvDouble,"timeStamp"));
+    PVRecordPtr pvRecord(PVRecord::create("clockRecord",pvStructure));
+    PVTimeStamp pvTimeStamp;
+    pvTimeStamp.attach(pvStructure->getSubField("timeStamp"));
+    pvRecord->lock();
+    pvRecord->beginGroupPut();
+    pvRecord->process();
+    pvTimeStamp.get(first);
+    epicsThreadSleep(.01);
+    pvRecord->process();
+    pvTimeStamp.get(second);
+    pvRecord->endGroupPut();
+    pvRecord->unlock();
+    testOk1(first==second);
+    PVClock::setMonotonic(true);
+    PVClock::getCurrent(first);
+    second.getCurrent();
+    if(debug) {
+        cout << "monotonic " << first.getSecondsPastEpoch() << " " << first.getNanoseconds()
+             << " wall " << second.getSecondsPastEpoch() << " " << second.getNanoseconds()
+             << endl;
+    }
+    testOk1(PVClock::isMonotonic() && TimeStamp::diff(second,first)<1.0 && TimeStamp::diff(first,second)<1.0);
+    PVClock::setMonotonic(false);
+    testOk1(!PVClock::isMonotonic());
+}
+
 static void ignoreTest()
 {
     if(debug) {cout << endl << endl << "****ignoreTest****" << endl;}
@@ -265,14 +1210,51 @@ static void ignoreTest()
     testOk1(nset==3);
 }
 
+static void registryTest()
+{
+    if(debug) {cout << endl << endl << "****registryTest****" << endl;}
+    PVPluginPtr pvPlugin(PVPluginRegistry::find("array"));
+    testOk1(pvPlugin.get()!=NULL);
+    testOk1(!PVPluginRegistry::find("noSuchPlugin"));
+    size_t generation = PVPluginRegistry::getGeneration();
+    bool threw = false;
+    try {
+        PVPluginRegistry::registerPlugin("array",pvPlugin);
+    } catch(std::logic_error & e) {
+        threw = true;
+    }
+    testOk1(threw);
+    testOk1(PVPluginRegistry::getGeneration()==generation);
+    PVPluginRegistry::registerPlugin("testPluginArray",pvPlugin);
+    testOk1(PVPluginRegistry::getGeneration()!=generation);
+    testOk1(PVPluginRegistry::find("testPluginArray")==pvPlugin);
+    testOk1(PVPluginRegistry::find("array")==pvPlugin);
+}
+
 MAIN(testPlugin)
 {
-    testPlan(22);
+    testPlan(132);
     PVDatabasePtr pvDatabase(PVDatabase::getMaster());
     deadbandTest();
+    arrayDeadbandTest();
+    sampleTest();
     arrayTest();
+    sparseTest();
+    peaksTest();
+    roiTest();
+    decimateTest();
+    compressTest();
+    statsTest();
+    histogramTest();
+    quantileTest();
+    spectrumTest();
+    quantizeTest();
     timeStampTest();
+    filterV2Test();
+    postCopyTest();
+    clockTest();
     ignoreTest();
+    registryTest();
     return 0;
 }
 